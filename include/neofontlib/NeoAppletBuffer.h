@@ -0,0 +1,70 @@
+/** @file       NeoAppletBuffer.h
+ *  @brief      Reusable storage for encoded applets.
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstdint>
+#include <vector>
+
+class NeoFont;
+struct NeoFontChanges;
+
+/** Scratch buffer holding one encoded applet. The storage only grows, so once
+ * it has seen the largest applet of a workload, loading, encoding and
+ * decoding do not touch the heap.
+ */
+class NeoAppletBuffer {
+public:
+    NeoAppletBuffer() = default;
+    explicit NeoAppletBuffer(size_t capacity);
+
+    /// Make sure at least this many bytes can be held without reallocation.
+    void reserve(size_t capacity);
+
+    /// Encode a font in to the buffer.
+    /// @return The encoded bytes, empty on failure.
+    NeoSpan<const uint8_t> encode(const NeoFont &font);
+
+    /** Update the buffer, holding the applet of a font, after the font was
+     * changed. Patched in place with NeoFont::patchApplet() when possible,
+     * encoded again otherwise.
+     *
+     *  @param  patched Set to whether the applet was patched, if not null.
+     *  @return The encoded bytes, empty on failure.
+     */
+    NeoSpan<const uint8_t> update(const NeoFont &font,
+                                  const NeoFontChanges &changes,
+                                  bool *patched = nullptr);
+
+    /// Decode the current contents in to a font.
+    bool decode(NeoFont &font) const;
+
+    /// Read a whole file in to the buffer.
+    bool load(const char *path);
+
+    /// Write the current contents to a file.
+    bool save(const char *path) const;
+
+    /// Replace the contents with a copy of other data.
+    void assign(NeoSpan<const uint8_t> data);
+
+    NeoSpan<const uint8_t> bytes() const {
+        return {m_data.data(), m_size};
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    size_t capacity() const {
+        return m_data.size();
+    }
+
+private:
+    uint8_t *prepare(size_t size);
+
+    std::vector<uint8_t> m_data;
+    size_t m_size = 0;
+};
@@ -0,0 +1,52 @@
+/** @file       NeoAppletCache.h
+ *  @brief      Directory of encoded applets keyed by font fingerprint.
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstdint>
+#include <string>
+
+class NeoAppletBuffer;
+class NeoFont;
+
+/** Maps neoFontHash() values to encoded applets stored as files in one
+ * directory, so fonts that did not change are not encoded again. Entries are
+ * written to a temporary file and renamed, so concurrent builds sharing the
+ * directory never see a partial applet.
+ */
+class NeoAppletCache {
+public:
+    explicit NeoAppletCache(std::string directory);
+
+    [[nodiscard]] const std::string &directory() const {
+        return m_directory;
+    }
+
+    /// Path of the entry for a fingerprint.
+    [[nodiscard]] std::string path(uint64_t fingerprint) const;
+
+    /// Load an entry. @return false if there is none.
+    bool lookup(uint64_t fingerprint, NeoAppletBuffer &out) const;
+
+    /// Add an entry, creating the directory if needed.
+    bool store(uint64_t fingerprint, const NeoAppletBuffer &applet) const;
+
+    /** Encode a font through the cache. On a hit the stored applet is loaded
+     * and encodeApplet() is skipped; on a miss the font is encoded and
+     * stored.
+     *
+     *  @param  fingerprint neoFontHash() of the font, or the value from a
+     * NeoFontHasher.
+     *  @param  hit         Set to whether the entry was found, if not null.
+     *  @return The applet, empty if encoding failed.
+     */
+    NeoSpan<const uint8_t> encode(const NeoFont &font,
+                                  uint64_t fingerprint,
+                                  NeoAppletBuffer &out,
+                                  bool *hit = nullptr) const;
+
+private:
+    std::string m_directory;
+};
@@ -0,0 +1,52 @@
+/** @file       NeoBdf.h
+ *  @brief      Import and export of X11 BDF fonts.
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstdint>
+#include <iosfwd>
+
+class NeoFont;
+
+/** Details of an imported BDF font.
+ */
+struct NeoBdfInfo {
+    int glyphCount = 0;       /**< Glyphs seen in the file. */
+    int mappedCharacters = 0; /**< Neo characters that received a glyph. */
+    int ascent = 0;
+    int descent = 0;
+};
+
+/// True if the data starts with the STARTFONT line of a BDF font.
+bool isBdfData(NeoSpan<const uint8_t> data);
+
+/** Replace the glyphs of a font with those of a BDF font. The stream is read
+ * a line at a time, so the file is never held in memory, and only glyphs
+ * whose ENCODING is in the Neo character set, or that give a Neo code after
+ * ENCODING -1, are decoded. The character width is taken from DWIDTH, the
+ * font height from FONT_ASCENT and FONT_DESCENT (or the font bounding box).
+ * Neo characters without a glyph are left blank.
+ *
+ *  @param  in      The BDF text.
+ *  @param  font    The font to fill.
+ *  @param  info    Optional, receives details about the BDF font.
+ *  @return         Logical true if the data was parsed correctly.
+ */
+bool importBdf(std::istream &in, NeoFont &font, NeoBdfInfo *info = nullptr);
+bool importBdf(NeoSpan<const uint8_t> data,
+               NeoFont &font,
+               NeoBdfInfo *info = nullptr);
+bool importBdfFile(const char *path, NeoFont &font, NeoBdfInfo *info = nullptr);
+
+/** Write a font as BDF. The baseline is put at the bottom of the character
+ * cell, and each character is written with its Unicode value as ENCODING.
+ * Neo characters sharing a Unicode value with a lower code are written with
+ * ENCODING -1 followed by their Neo code, which importBdf() reads back in to
+ * that code.
+ *
+ *  @return         Logical true if the stream is good afterwards.
+ */
+bool exportBdf(const NeoFont &font, std::ostream &out);
+bool exportBdfFile(const NeoFont &font, const char *path);
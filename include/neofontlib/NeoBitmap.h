@@ -0,0 +1,83 @@
+/** @file       NeoBitmap.h
+ *  @brief      Packed one bit per pixel image.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class NeoCharacter;
+
+/** A monochrome image stored a row at a time, eight pixels per byte with the
+ * leftmost pixel in the most significant bit. This is the layout of raw PBM
+ * files and of most 1-bpp framebuffers. Note that NeoCharacter rows use the
+ * opposite bit order. Padding bits right of width() are always kept clear.
+ */
+class NeoBitmap {
+public:
+    NeoBitmap() = default;
+    NeoBitmap(int width, int height);
+
+    [[nodiscard]] int width() const {
+        return m_width;
+    }
+
+    [[nodiscard]] int height() const {
+        return m_height;
+    }
+
+    /// Bytes per row.
+    [[nodiscard]] size_t stride() const {
+        return m_stride;
+    }
+
+    [[nodiscard]] const uint8_t *row(int y) const {
+        return m_data.data() + static_cast<size_t>(y) * m_stride;
+    }
+
+    uint8_t *row(int y) {
+        return m_data.data() + static_cast<size_t>(y) * m_stride;
+    }
+
+    [[nodiscard]] const std::vector<uint8_t> &data() const {
+        return m_data;
+    }
+
+    void resize(int width, int height);
+    void clear();
+
+    [[nodiscard]] int getPixel(int x, int y) const;
+    void setPixel(int x, int y);
+
+    /// Set every pixel of a rectangle, clipped to the image.
+    void fillRect(int x, int y, int w, int h);
+
+    /// Clear every pixel of a rectangle, clipped to the image.
+    void clearRect(int x, int y, int w, int h);
+
+    /** OR the pixels of a character in to the image with its top left corner
+     * at (x, y), one row at a time. Pixels outside the image are clipped.
+     */
+    void drawCharacter(const NeoCharacter &c, int x, int y);
+
+    /** Copy the pixels of a w by h rectangle in to the top left corner of a
+     * character, replacing its rows. The character width and height are not
+     * changed, columns and rows outside it are ignored.
+     */
+    void extractCharacter(int x, int y, int w, int h, NeoCharacter &c) const;
+
+    /// Mask of the pixels in the last byte of a row.
+    [[nodiscard]] uint8_t paddingMask() const {
+        return static_cast<uint8_t>(0xff << ((8 - m_width % 8) % 8));
+    }
+
+private:
+    void paintRect(int x, int y, int w, int h, bool set);
+
+    int m_width = 0;
+    int m_height = 0;
+    size_t m_stride = 0;
+    std::vector<uint8_t> m_data;
+};
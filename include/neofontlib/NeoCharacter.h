@@ -8,6 +8,32 @@
 #include <cstddef>
 #include <cstdint>
 
+/** Rows changed by a drawing operation, from up to but not including to, for
+ * redrawing only part of a character.
+ */
+struct NeoRowRange {
+    int from = 0;
+    int to = 0;
+
+    bool empty() const {
+        return from >= to;
+    }
+
+    /// Grow the range to include row y.
+    void include(int y) {
+        if (empty()) {
+            from = y;
+            to = y + 1;
+        }
+        else if (y < from) {
+            from = y;
+        }
+        else if (y >= to) {
+            to = y + 1;
+        }
+    }
+};
+
 /** Class used to code a single character.
  */
 class NeoCharacter {
@@ -18,6 +44,11 @@ public:
     static constexpr size_t minHeight = 1;
     static constexpr size_t maxHexght = 66;
 
+    /// Bytes used to store one row of pixels. Pixel x of a row is bit (x & 7)
+    /// of byte (x / 8).
+    static constexpr size_t rowBytes = maxWidth / 8;
+    static_assert(maxWidth % 8 == 0, "rows must be whole bytes");
+
     NeoCharacter();
     NeoCharacter(const NeoCharacter &) = default;
     NeoCharacter(NeoCharacter &&) = default;
@@ -39,6 +70,23 @@ public:
     void flipPixel(int x, int y);
     void changePixel(int x, int y, int v);
 
+    NeoRowRange drawLine(int x0, int y0, int x1, int y1, int v = 1);
+    NeoRowRange drawRect(int x, int y, int w, int h, int v = 1);
+    NeoRowRange fillRect(int x, int y, int w, int h, int v = 1);
+    NeoRowRange floodFill(int x, int y, int v = 1);
+    NeoRowRange paste(const NeoCharacter &source,
+                      int sx,
+                      int sy,
+                      int w,
+                      int h,
+                      int x,
+                      int y);
+
+    [[nodiscard]] const uint8_t *row(int y) const;
+    uint8_t *row(int y);
+
+    [[nodiscard]] int inkWidth() const;
+
     void transformTranslate(int dx, int dy);
     void transformFlipV();
     void transformFlipH();
@@ -55,6 +103,8 @@ private:
      * pointers are used.
      */
 
+    void paintSpan(int y, int x0, int x1, int v, NeoRowRange &dirty);
+
     // In pixels:
     int m_width = 8;
     int m_height = 8;
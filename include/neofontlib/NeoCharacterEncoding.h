@@ -7,4 +7,125 @@
 
 #include <stdint.h>
 
+#include <array>
+#include <iosfwd>
+#include <stddef.h>
+
+/** Identifies a code page. The built in pages have fixed ids, pages
+ * registered at run time get ids from neoCodePageUserMin up in the order they
+ * are registered, so those ids are only meaningful within one process.
+ */
+using NeoCodePageId = uint16_t;
+
+/// The Neo mapping, with symbols for codes 1-31. This is the default.
+constexpr NeoCodePageId neoCodePageNeo = 0;
+/// The Neo mapping with codes 1-31 as the standard control codes.
+constexpr NeoCodePageId neoCodePageControl = 1;
+/// First id given to a registered page.
+constexpr NeoCodePageId neoCodePageUserMin = 16;
+
+/** A mapping between the 256 Neo character codes and UTF16. The reverse map
+ * is built by the constructor, so a page declared constexpr has both
+ * directions generated at compile time.
+ */
+class NeoCodePage {
+public:
+    using Table = std::array<uint16_t, 256>;
+
+    /// The longest name kept, including the terminator.
+    static constexpr size_t maxNameLength = 32;
+
+    constexpr NeoCodePage(const char *name, const Table &toUnicode)
+        : m_toUnicode(toUnicode) {
+        for (size_t i = 0; name[i] && i + 1 < maxNameLength; ++i) {
+            m_name[i] = name[i];
+        }
+        for (size_t i = 0; i < 256; ++i) {
+            m_fromUnicode[i] = {toUnicode[i], static_cast<uint8_t>(i)};
+        }
+        // Insertion sort, since std::sort is not constexpr in C++17. Equal
+        // UTF16 codes stay in Neo code order.
+        for (size_t i = 1; i < 256; ++i) {
+            auto entry = m_fromUnicode[i];
+            size_t j = i;
+            for (; j > 0 && m_fromUnicode[j - 1].utf16 > entry.utf16; --j) {
+                m_fromUnicode[j] = m_fromUnicode[j - 1];
+            }
+            m_fromUnicode[j] = entry;
+        }
+    }
+
+    const char *name() const {
+        return m_name.data();
+    }
+
+    const Table &table() const {
+        return m_toUnicode;
+    }
+
+    /// The UTF16 code of a Neo character, or that of code 0 if it is out of
+    /// range.
+    constexpr uint16_t toUTF16(int neoCharacter) const {
+        return m_toUnicode[neoCharacter >= 0 && neoCharacter <= 255
+                               ? neoCharacter
+                               : 0];
+    }
+
+    int fromUTF16(uint16_t utf16) const;
+    size_t fromUTF16(uint16_t utf16, int *codes, size_t maxCodes) const;
+
+private:
+    struct Reverse {
+        uint16_t utf16;
+        uint8_t neo;
+    };
+
+    std::array<char, maxNameLength> m_name = {};
+    Table m_toUnicode = {};
+    /// The inverse of m_toUnicode, sorted by UTF16 code.
+    std::array<Reverse, 256> m_fromUnicode = {};
+};
+
+/** Look up a code page. Unknown ids give the default page, so this never
+ * fails.
+ */
+const NeoCodePage &neoCodePage(NeoCodePageId id);
+
+/** Check whether a code page id is built in or registered.
+ */
+bool isNeoCodePage(NeoCodePageId id);
+
+/** Find a code page by name.
+ *
+ *  @return         The id, or -1 if there is no page with that name.
+ */
+int findNeoCodePage(const char *name);
+
+/** Add a code page. Registered pages live until the program exits, so the
+ * references returned by neoCodePage() stay valid.
+ *
+ *  @return         The new id, or -1 if the name is taken or the registry is
+ * full.
+ */
+int registerNeoCodePage(const NeoCodePage &page);
+
+/** Read a code page in the format of the Unicode mapping files: one
+ * "0xNN 0xUUUU" pair per line, with '#' starting a comment. Codes that are
+ * not listed keep the mapping of the default page.
+ *
+ *  @param  in      The mapping text.
+ *  @param  table   Receives the Neo to UTF16 table.
+ *  @return         Logical true if every line was understood.
+ */
+bool parseNeoCodePage(std::istream &in, NeoCodePage::Table &table);
+
+/** Read a mapping file and register it under a name.
+ *
+ *  @return         The new id, or -1 on failure.
+ */
+int loadNeoCodePage(const char *path, const char *name);
+
+/// Conversions using the default code page.
 uint16_t NeoCharacterToUTF16(int neoCharacter);
+int UTF16ToNeoCharacter(uint16_t utf16);
+size_t UTF16ToNeoCharacters(uint16_t utf16, int *codes, size_t maxCodes);
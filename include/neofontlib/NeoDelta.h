@@ -0,0 +1,50 @@
+/** @file       NeoDelta.h
+ *  @brief      Comparison of fonts and binary patches between versions.
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstdint>
+#include <vector>
+
+class NeoAppletBuffer;
+class NeoFont;
+
+/** Differences between two fonts. Pixels right of a character's width are
+ * ignored, as they are never encoded.
+ */
+struct NeoFontDiff {
+    std::vector<int> changedGlyphs; /**< Codes with different pixels. */
+    std::vector<int> changedWidths; /**< Codes with a different width. */
+    uint64_t pixelsChanged = 0;
+    bool heightChanged = false;
+    bool metadataChanged = false; /**< Names, version or ident. */
+
+    [[nodiscard]] bool empty() const {
+        return changedGlyphs.empty() && changedWidths.empty() &&
+               !heightChanged && !metadataChanged;
+    }
+};
+
+NeoFontDiff diffFonts(const NeoFont &from, const NeoFont &to);
+
+/** Make a patch that turns from in to to. Only changed characters are
+ * stored, as the XOR of their rows, run length encoded. The patch records a
+ * fingerprint of both fonts, so it is only applied to the font it was made
+ * from and the result is checked.
+ */
+std::vector<uint8_t> makeFontDelta(const NeoFont &from, const NeoFont &to);
+
+/** Apply a patch made by makeFontDelta().
+ *
+ *  @return         Logical true on success. On failure the font is left
+ * unchanged.
+ */
+bool applyFontDelta(NeoFont &font, NeoSpan<const uint8_t> delta);
+
+/** Apply a patch to an encoded applet and encode the result in to out.
+ */
+bool applyAppletDelta(NeoSpan<const uint8_t> applet,
+                      NeoSpan<const uint8_t> delta,
+                      NeoAppletBuffer &out);
@@ -0,0 +1,30 @@
+/** @file       NeoFitWidths.h
+ *  @brief      Trimming of blank columns right of the ink in every character.
+ */
+
+#pragma once
+
+class NeoFont;
+
+struct NeoFitWidthsOptions {
+    int rightBearing = 1; /**< Blank columns kept right of the ink. */
+    int blankWidth = 0;   /**< New width of blank characters, zero keeps. */
+};
+
+struct NeoFitWidthsReport {
+    unsigned int sizeBefore = 0; /**< appletSize() before fitting. */
+    unsigned int sizeAfter = 0;  /**< appletSize() after fitting. */
+    int narrowed = 0;            /**< Characters whose width was reduced. */
+    int columnsRemoved = 0;      /**< Total columns removed. */
+
+    [[nodiscard]] unsigned int bytesSaved() const {
+        return sizeBefore - sizeAfter;
+    }
+};
+
+/** Narrow every character to its ink extent plus the right bearing. Widths
+ * are only ever reduced, so hand tuned spacing narrower than that is kept.
+ * Blank characters (such as space) keep their width unless blankWidth is set.
+ */
+NeoFitWidthsReport fitWidths(NeoFont &font,
+                             const NeoFitWidthsOptions &options = {});
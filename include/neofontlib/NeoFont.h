@@ -6,8 +6,24 @@
 #pragma once
 
 #include "NeoCharacter.h"
+#include "NeoCharacterEncoding.h"
+#include "NeoSpan.h"
+#include <bitset>
 #include <vector>
 
+struct NeoFontChanges;
+class NeoFontTransaction;
+
+/** Tuning for encodeApplet(). The output is the same for any settings.
+ */
+struct NeoEncodeOptions {
+    /// Threads used to pack the glyph bitmaps, zero for one per core.
+    int threads = 0;
+    /// Bitmaps smaller than this many bytes are always packed serially,
+    /// since starting threads costs more than the packing itself.
+    size_t parallelThreshold = 64 * 1024;
+};
+
 /** Class describing a complete font.
  */
 class NeoFont {
@@ -28,6 +44,8 @@ public:
     const char *version() const;
     int ident() const;
     int height() const;
+    NeoCodePageId codePageId() const;
+    const NeoCodePage &codePage() const;
 
     const char *setAppletInfo(const char *n);
     const char *setFontName(const char *n);
@@ -35,6 +53,7 @@ public:
     const char *setVersion(const char *v);
     int setIdent(int i);
     int setHeight(int h);
+    NeoCodePageId setCodePage(NeoCodePageId id);
 
     void clear();
 
@@ -51,15 +70,28 @@ public:
     NeoCharacter *end();
 
     unsigned int appletSize() const;
-    unsigned int encodeApplet(uint8_t *data, unsigned int length) const;
-    [[nodiscard]] std::vector<char> encodeApplet() const;
+    unsigned int encodeApplet(uint8_t *data,
+                              unsigned int length,
+                              const NeoEncodeOptions &options = {}) const;
+    unsigned int encodeApplet(NeoSpan<uint8_t> data,
+                              const NeoEncodeOptions &options = {}) const;
+    [[nodiscard]] std::vector<char> encodeApplet(
+        const NeoEncodeOptions &options = {}) const;
+    bool patchApplet(NeoSpan<uint8_t> applet,
+                     const NeoFontChanges &changes) const;
     bool decodeApplet(const uint8_t *data, unsigned int length);
+    bool decodeApplet(NeoSpan<const uint8_t> data);
     template <typename Container>
     bool decodeApplet(const Container &data);
 
     unsigned int archiveSize() const;
 
+    template <typename Function>
+    NeoFontChanges batch(Function fn);
+
 private:
+    friend class NeoFontTransaction;
+
     /* Do not use pointer member variables here. The loadArchive() and
      * saveArchive() methods both in this class and in NeoFont have a trivial
      * implementation that will need to be significantly more complex if
@@ -74,6 +106,7 @@ private:
     std::array<char, 16> m_versionString; /**< Cached version string. */
     int m_ident;                          /**< 16 bit Unique ID code. */
     int m_height;                         /**< Font height (pixels) */
+    NeoCodePageId m_codePage;             /**< Code to Unicode mapping. */
     std::array<NeoCharacter, charCount> m_characters;
 
     void remakeVersionString();
@@ -82,6 +115,88 @@ private:
 
 template <typename Container>
 inline bool NeoFont::decodeApplet(const Container &data) {
-    return decodeApplet(reinterpret_cast<const uint8_t *>(data.data()),
-                        data.size());
+    return decodeApplet(NeoSpan<const uint8_t>{data});
+}
+
+/** What a transaction changed, for invalidating caches of the font once.
+ */
+struct NeoFontChanges {
+    /// Characters whose width or pixels may have changed.
+    std::bitset<NeoFont::charCount> characters;
+    bool height = false;
+    bool metadata = false;
+
+    bool empty() const {
+        return characters.none() && !height && !metadata;
+    }
+};
+
+/** A group of edits to a font that defers the work that touches every
+ * character. Height, width and clear() are recorded and each character is
+ * brought up to date once, at commit or when character() first returns it,
+ * so chained calls do not pass over all 256 bitmaps for every call.
+ * Metadata setters are cheap and apply at once.
+ *
+ * There is no rollback: metadata and the pixels of characters returned by
+ * character() are changed in the font itself. The destructor commits, even
+ * when it runs because an exception is thrown, so that the font is left
+ * consistent, with every character at the font height.
+ *
+ * Usually used through NeoFont::batch().
+ */
+class NeoFontTransaction {
+public:
+    explicit NeoFontTransaction(NeoFont &font);
+    NeoFontTransaction(const NeoFontTransaction &) = delete;
+    NeoFontTransaction &operator=(const NeoFontTransaction &) = delete;
+    ~NeoFontTransaction();
+
+    /// The height the font will have.
+    int height() const {
+        return m_height;
+    }
+
+    int setHeight(int h);
+    int setWidth(int code, int w);
+    void clear();
+
+    void setAppletName(const char *n);
+    void setAppletInfo(const char *n);
+    void setFontName(const char *n);
+    void setVersion(const char *v);
+    void setIdent(int i);
+    void setCodePage(NeoCodePageId id);
+
+    /// The character, with the pending changes applied, for pixel edits.
+    NeoCharacter &character(int index);
+
+    /// Apply everything. Later calls, and the destructor, do nothing.
+    NeoFontChanges commit();
+
+private:
+    void update(int index);
+
+    NeoFont &m_font;
+    int m_height;
+    std::bitset<NeoFont::charCount> m_clear;
+    std::array<uint8_t, NeoFont::charCount> m_widths = {}; /**< 0 to keep. */
+    /// Lowest height set since each character was updated, as rows below it
+    /// must be cleared if the height grows again.
+    std::array<uint8_t, NeoFont::charCount> m_lowest;
+    NeoFontChanges m_changes;
+    bool m_committed = false;
+};
+
+/** Run fn with a transaction on the font and commit it. If fn throws, the
+ * edits it made before are committed and the exception is passed on.
+ *
+ *  @param  fn      Called as fn(NeoFontTransaction &).
+ *  @return         What changed, to pass on to caches such as
+ * NeoFontHasher::invalidate().
+ */
+template <typename Function>
+NeoFontChanges NeoFont::batch(Function fn) {
+    auto tx = NeoFontTransaction{*this};
+    fn(tx);
+    return tx.commit();
 }
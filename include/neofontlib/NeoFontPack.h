@@ -0,0 +1,104 @@
+/** @file       NeoFontPack.h
+ *  @brief      Container file holding many encoded font applets.
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class NeoFont;
+
+/** One font in a pack. The data points in to the mapped file.
+ */
+struct NeoFontPackEntry {
+    int ident = 0;
+    char name[24] = {};
+    uint32_t checksum = 0; /**< CRC-32 of the applet. */
+    NeoSpan<const uint8_t> applet;
+};
+
+/** Read only view of a font pack, mapped in to memory. Opening only reads
+ * the header and the index; an applet is paged in when it is used. Entries
+ * are sorted by ident and then name.
+ */
+class NeoFontPack {
+public:
+    NeoFontPack() = default;
+    NeoFontPack(const NeoFontPack &) = delete;
+    NeoFontPack &operator=(const NeoFontPack &) = delete;
+    ~NeoFontPack();
+
+    bool open(const char *path);
+    void close();
+
+    [[nodiscard]] size_t size() const {
+        return m_entries.size();
+    }
+
+    [[nodiscard]] const NeoFontPackEntry &entry(size_t index) const {
+        return m_entries.at(index);
+    }
+
+    /// First entry with an ident, or null.
+    [[nodiscard]] const NeoFontPackEntry *findIdent(int ident) const;
+
+    /// Entry with a font name, or null.
+    [[nodiscard]] const NeoFontPackEntry *findName(const char *name) const;
+
+    /// Check the checksum of an entry.
+    [[nodiscard]] bool verify(const NeoFontPackEntry &entry) const;
+
+    /// Decode an entry straight from the mapping.
+    bool load(const NeoFontPackEntry &entry, NeoFont &font) const;
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    std::vector<NeoFontPackEntry> m_entries;
+    std::vector<uint32_t> m_byName; /**< Entry indices sorted by name. */
+};
+
+/** Creates a pack or appends to an existing one. Applets are written after
+ * the existing data, and commit() writes a new index after them and then
+ * points the header at it. Existing applets are never rewritten, and a pack
+ * that is not committed still reads as it was before.
+ */
+class NeoFontPackWriter {
+public:
+    NeoFontPackWriter() = default;
+    NeoFontPackWriter(const NeoFontPackWriter &) = delete;
+    NeoFontPackWriter &operator=(const NeoFontPackWriter &) = delete;
+    ~NeoFontPackWriter();
+
+    /// Open a pack for appending, creating it if it does not exist.
+    bool open(const char *path);
+
+    /// Encode and add a font.
+    bool add(const NeoFont &font);
+
+    /// Add an encoded applet. It is decoded to find its ident and name.
+    bool addApplet(NeoSpan<const uint8_t> applet);
+
+    /// Write the index and make the added fonts visible.
+    bool commit();
+
+    void close();
+
+private:
+    struct Record {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t checksum;
+        int ident;
+        char name[24];
+    };
+
+    bool append(NeoSpan<const uint8_t> applet, const NeoFont &font);
+
+    int m_fd = -1;
+    uint64_t m_end = 0; /**< Where the next applet is written. */
+    std::vector<Record> m_records;
+};
@@ -0,0 +1,81 @@
+/** @file       NeoGlyphCache.h
+ *  @brief      Pre-shifted glyph rows for drawing text in to a NeoBitmap.
+ */
+
+#pragma once
+
+#include "NeoFont.h"
+#include "NeoMemory.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+
+class NeoBitmap;
+
+struct NeoGlyphCacheStats {
+    uint64_t hits = 0;      /**< Draws from an existing entry. */
+    uint64_t misses = 0;    /**< Draws that had to build an entry first. */
+    uint64_t evictions = 0; /**< Entries dropped because the atlas was full. */
+    uint64_t releases = 0;  /**< Atlas freed to stay within the memory cap. */
+    size_t bytesUsed = 0;   /**< Atlas bytes holding entries. */
+    size_t capacity = 0;    /**< Atlas size. */
+};
+
+/** Draws the characters of a font in to a NeoBitmap from rows that are
+ * already converted to the bitmap's MSB first order and shifted for the bit
+ * position of x within a byte. A glyph drawn at x then only needs its bytes
+ * ORed in to the row from byte x / 8, with no shifting or bit reversal.
+ *
+ * An entry is built the first time a character is drawn at a given x % 8,
+ * and holds only the rows between the first and last set pixel. Entries are
+ * packed in one 64 byte aligned atlas of a fixed size; when it is full, all
+ * entries are dropped and the atlas is refilled from the start.
+ *
+ * The atlas is allocated on the first miss and counted as a "glyph_cache"
+ * NeoMemoryConsumer. When the memory cap asks for it back, it is freed at the
+ * start of the next draw and the cache starts over empty.
+ *
+ * The font must outlive the cache, and invalidate() must be called when its
+ * characters change.
+ */
+class NeoGlyphCache : public NeoMemoryConsumer {
+public:
+    static constexpr size_t defaultCapacity = 256 * 1024;
+
+    explicit NeoGlyphCache(const NeoFont &font,
+                           size_t capacity = defaultCapacity);
+
+    /// OR a character in to a bitmap, as NeoBitmap::drawCharacter().
+    void draw(NeoBitmap &target, int code, int x, int y);
+
+    void invalidate();
+    void invalidate(int code);
+    void invalidate(const NeoFontChanges &changes);
+
+    [[nodiscard]] NeoGlyphCacheStats stats() const;
+    void resetStats();
+
+private:
+    /// Bit positions of x within a byte.
+    static constexpr int phases = 8;
+
+    struct Entry {
+        uint32_t offset = 0; /**< In the atlas. */
+        uint8_t top = 0;     /**< First row with ink. */
+        uint8_t rows = 0;    /**< Zero for a blank character. */
+        uint8_t bytes = 0;   /**< Per row. */
+        bool valid = false;
+    };
+
+    bool build(int code, int phase, Entry &entry);
+    void release();
+
+    const NeoFont &m_font;
+    std::unique_ptr<uint8_t[]> m_storage;
+    uint8_t *m_atlas = nullptr; /**< m_storage aligned to 64 bytes. */
+    size_t m_capacity = 0;
+    size_t m_used = 0;
+    size_t m_entries = 0;
+    std::array<Entry, NeoFont::charCount * phases> m_table = {};
+    NeoGlyphCacheStats m_stats;
+};
@@ -0,0 +1,53 @@
+/** @file       NeoGlyphCodec.h
+ *  @brief      Compact storage of character bitmaps.
+ *
+ *  A character is stored as its width and height, followed by its rows cut
+ *  to the bytes its width needs. Each row is XORed with the row above, which
+ *  turns the repeated rows of a glyph in to zero rows. Zero rows are dropped
+ *  and listed in a bit mask; of the remaining rows, only the non-zero bytes
+ *  are kept, also listed in a bit mask:
+ *
+ *      u8      width - 1
+ *      u8      height - 1
+ *      (height + 7) / 8 bytes: bit y set if delta row y is stored
+ *      for each stored row:
+ *          if the row is more than one byte: (bytes + 7) / 8 byte mask
+ *          the non-zero bytes
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class NeoCharacter;
+class NeoFont;
+
+/// Largest possible encoded character, for sizing output buffers.
+constexpr size_t neoGlyphMaxEncodedSize = 2 + (66 + 7) / 8 + 66 * (2 + 16);
+
+/** Encode one character.
+ *
+ *  @param  out     At least neoGlyphMaxEncodedSize bytes.
+ *  @return         The number of bytes written.
+ */
+size_t encodeGlyph(const NeoCharacter &c, uint8_t *out);
+
+/** Decode one character, writing its rows directly. Rows below the height
+ * are left as they were.
+ *
+ *  @return         The number of bytes used, or zero if data is invalid.
+ */
+size_t decodeGlyph(NeoSpan<const uint8_t> data, NeoCharacter &c);
+
+/// Encode the height and all characters of a font, appending to out.
+void encodeFontGlyphs(const NeoFont &font, std::vector<uint8_t> &out);
+
+/** Decode what encodeFontGlyphs() wrote. Names and other metadata are not
+ * stored and are left unchanged.
+ *
+ *  @return         The number of bytes used, or zero if data is invalid.
+ */
+size_t decodeFontGlyphs(NeoSpan<const uint8_t> data, NeoFont &font);
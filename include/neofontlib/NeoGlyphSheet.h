@@ -0,0 +1,43 @@
+/** @file       NeoGlyphSheet.h
+ *  @brief      Conversion between fonts and grid images of their glyphs.
+ */
+
+#pragma once
+
+#include "NeoBitmap.h"
+
+class NeoFont;
+
+/** Layout of a glyph sheet: a grid of equally sized cells, one per character,
+ * in character code order from left to right and top to bottom.
+ */
+struct NeoGlyphSheetOptions {
+    int columns = 16;
+    int rows = 16;
+    int cellWidth = 0;    /**< Zero divides the sheet width by columns. */
+    int cellHeight = 0;   /**< Zero divides the sheet height by rows. */
+    int firstCode = 0;    /**< Character code of the top left cell. */
+    int rightBearing = 1; /**< Blank columns kept right of the ink. */
+    int blankWidth = 0;   /**< Width of empty cells, zero for half a cell. */
+};
+
+/** Slice a sheet in to characters. The font height is set to the cell
+ * height, and each character width to its ink extent plus the right bearing.
+ *
+ *  @return         Logical true if the sheet held at least one cell.
+ */
+bool importGlyphSheet(const NeoBitmap &sheet,
+                      NeoFont &font,
+                      const NeoGlyphSheetOptions &options = {});
+
+struct NeoSpecimenOptions {
+    int columns = 16;
+    bool title = true; /**< Draw the font name and version at the top. */
+};
+
+/** Render all characters of a font in a labelled grid. Each cell shows the
+ * character code in hex, the glyph, and a line under the glyph showing its
+ * advance width.
+ */
+NeoBitmap renderSpecimen(const NeoFont &font,
+                         const NeoSpecimenOptions &options = {});
@@ -0,0 +1,56 @@
+/** @file       NeoHash.h
+ *  @brief      Content fingerprints of fonts.
+ *
+ *  The hashes only depend on what is encoded in an applet: names, version,
+ *  ident, height, widths and the pixels inside each character. They do not
+ *  depend on padding, on bits right of a character's width or on the host,
+ *  so they can be stored and compared between builds.
+ */
+
+#pragma once
+
+#include "NeoFont.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+/// Hash of the width and the pixels of the first height rows.
+uint64_t neoCharacterHash(const NeoCharacter &c, int height);
+
+/// Hash of the applet name, applet info, font name, version and ident.
+uint64_t neoMetadataHash(const NeoFont &font);
+
+/// Fingerprint of everything stored in the applet of a font.
+uint64_t neoFontHash(const NeoFont &font);
+
+/** Hash of a block of bytes, for keying caches by the content of a file
+ * before it is decoded. Different seeds give unrelated hashes of the same
+ * bytes.
+ */
+uint64_t neoDataHash(NeoSpan<const uint8_t> data, uint64_t seed = 0);
+
+/** Computes neoFontHash() incrementally by caching the hash of every
+ * character. The hasher can not see edits, so characters that are changed
+ * must be invalidated before the next fingerprint. A height change is
+ * detected and rehashes everything.
+ */
+class NeoFontHasher {
+public:
+    /// Same value as neoFontHash(), for the font the cache was built from.
+    uint64_t fingerprint(const NeoFont &font);
+
+    void invalidate(int code);
+    void invalidate(const NeoFontChanges &changes);
+    void invalidateAll();
+
+    /// Characters hashed since construction, to check the cache is working.
+    [[nodiscard]] uint64_t charactersHashed() const {
+        return m_hashed;
+    }
+
+private:
+    std::array<uint64_t, NeoFont::charCount> m_hashes = {};
+    std::bitset<NeoFont::charCount> m_valid;
+    int m_height = 0;
+    uint64_t m_hashed = 0;
+};
@@ -0,0 +1,35 @@
+/** @file       NeoImport.h
+ *  @brief      Reading fonts in any of the supported source formats.
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstdint>
+
+class NeoFont;
+
+enum class NeoFontFormat {
+    Applet,
+    Psf,
+    Bdf,
+};
+
+/** Format of font data, from its contents. Data that is neither a PSF nor
+ * a BDF font is taken to be an applet.
+ */
+NeoFontFormat detectFontFormat(NeoSpan<const uint8_t> data);
+
+/// Name of a format for messages, such as "BDF font".
+const char *fontFormatName(NeoFontFormat format);
+
+/** Read font data of a format given by detectFontFormat(). An applet
+ * replaces the whole font. PSF and BDF fonts replace the glyphs and the
+ * height, and leave the name, code page and other metadata alone, so these
+ * are set by the caller first.
+ *
+ *  @return         Logical true if the data was parsed correctly.
+ */
+bool importFont(NeoSpan<const uint8_t> data,
+                NeoFontFormat format,
+                NeoFont &font);
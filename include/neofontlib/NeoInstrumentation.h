@@ -0,0 +1,200 @@
+/** @file       NeoInstrumentation.h
+ *  @brief      Opt-in timers and counters for the applet encode/decode phases.
+ *
+ *  The hooks placed in the library hot paths are only compiled in when
+ *  NEOFONTLIB_INSTRUMENTATION is defined (CMake option of the same name).
+ *  Without it the NEO_PHASE, NEO_NEXT_PHASE and NEO_COUNT macros expand to
+ *  nothing. The sink classes are always available so that client code builds
+ *  in both modes.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+
+/** The instrumented phases of decodeApplet() and encodeApplet().
+ */
+enum class NeoPhase {
+    DecodeHeader,  /**< Magic, size, code and metadata parsing. */
+    DecodeReset,   /**< setHeight() and clear() of the target font. */
+    DecodeBitmaps, /**< Bitmap unpacking in to the characters. */
+    EncodeAlloc,   /**< Output allocation of the vector encodeApplet(). */
+    EncodeHeader,  /**< Prefix, metadata and name string. */
+    EncodeBitmaps, /**< Bitmap packing. */
+    EncodeTables,  /**< Width, location and font info tables. */
+    Count,
+};
+
+constexpr size_t neoPhaseCount = static_cast<size_t>(NeoPhase::Count);
+
+/** Return a printable name for a phase.
+ */
+const char *neoPhaseName(NeoPhase phase);
+
+/** Counters gathered during a single phase.
+ */
+struct NeoPhaseCounters {
+    uint64_t bytes = 0;       /**< Applet bytes read or written. */
+    uint64_t glyphs = 0;      /**< Characters processed. */
+    uint64_t pixelsSet = 0;   /**< Set pixels read or written. */
+    uint64_t allocations = 0; /**< Heap allocations made by the library. */
+};
+
+/** One finished phase, as delivered to a sink.
+ */
+struct NeoPhaseEvent {
+    NeoPhase phase;
+    uint64_t startNs;    /**< Steady clock time stamp, in nanoseconds. */
+    uint64_t durationNs; /**< Phase duration, in nanoseconds. */
+    NeoPhaseCounters counters;
+};
+
+/** Receiver of phase events. Sinks may be called concurrently from several
+ * threads and must do their own locking.
+ */
+class NeoInstrumentSink {
+public:
+    virtual ~NeoInstrumentSink() = default;
+    virtual void record(const NeoPhaseEvent &event) = 0;
+};
+
+/** Install the process wide sink. Pass nullptr to disable reporting. The sink
+ * must outlive all instrumented calls made while it is installed.
+ */
+void setNeoInstrumentSink(NeoInstrumentSink *sink);
+NeoInstrumentSink *neoInstrumentSink();
+
+/** Sink forwarding every event to a user callback.
+ */
+class NeoCallbackSink : public NeoInstrumentSink {
+public:
+    using Callback = std::function<void(const NeoPhaseEvent &)>;
+
+    explicit NeoCallbackSink(Callback callback);
+    void record(const NeoPhaseEvent &event) override;
+
+private:
+    Callback m_callback;
+};
+
+/** Sink aggregating durations in to log2 histograms and summing the counters,
+ * per phase.
+ */
+class NeoHistogramSink : public NeoInstrumentSink {
+public:
+    /// Bucket n holds durations in [2^n, 2^(n+1)) ns, bucket 0 also holds 0.
+    static constexpr size_t bucketCount = 40;
+
+    struct PhaseStats {
+        uint64_t calls = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        NeoPhaseCounters counters;
+        std::array<uint64_t, bucketCount> buckets = {};
+    };
+
+    void record(const NeoPhaseEvent &event) override;
+
+    PhaseStats stats(NeoPhase phase) const;
+    void reset();
+
+    /// Write a human readable summary of all phases.
+    void print(FILE *out) const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::array<PhaseStats, neoPhaseCount> m_stats = {};
+};
+
+/** Sink writing events in the Chrome trace-event JSON format, viewable in
+ * chrome://tracing or Perfetto.
+ */
+class NeoTraceEventSink : public NeoInstrumentSink {
+public:
+    explicit NeoTraceEventSink(const char *path);
+    NeoTraceEventSink(const NeoTraceEventSink &) = delete;
+    NeoTraceEventSink &operator=(const NeoTraceEventSink &) = delete;
+    ~NeoTraceEventSink() override;
+
+    bool isOpen() const;
+    void record(const NeoPhaseEvent &event) override;
+
+private:
+    std::mutex m_mutex;
+    FILE *m_file = nullptr;
+    bool m_first = true;
+};
+
+#ifdef NEOFONTLIB_INSTRUMENTATION
+
+/** RAII timer for a sequence of phases. The current phase is reported when
+ * next() starts another one, or when the timer goes out of scope. Events are
+ * only produced if a sink is installed when the timer is created.
+ */
+class NeoScopedPhase {
+public:
+    explicit NeoScopedPhase(NeoPhase phase)
+        : m_sink(neoInstrumentSink())
+        , m_phase(phase) {
+        if (m_sink) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    NeoScopedPhase(const NeoScopedPhase &) = delete;
+    NeoScopedPhase &operator=(const NeoScopedPhase &) = delete;
+
+    ~NeoScopedPhase() {
+        finish();
+    }
+
+    /// Report the current phase and start timing another one.
+    void next(NeoPhase phase) {
+        finish();
+        m_phase = phase;
+        counters = {};
+        if (m_sink) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    NeoPhaseCounters counters;
+
+private:
+    void finish() {
+        if (!m_sink) {
+            return;
+        }
+        auto end = std::chrono::steady_clock::now();
+        auto ns = [](auto d) {
+            return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d)
+                    .count());
+        };
+        m_sink->record({m_phase,
+                        ns(m_start.time_since_epoch()),
+                        ns(end - m_start),
+                        counters});
+    }
+
+    NeoInstrumentSink *m_sink;
+    NeoPhase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#define NEO_PHASE(var, phase) NeoScopedPhase var{phase}
+#define NEO_NEXT_PHASE(var, phase) ((var).next(phase))
+#define NEO_COUNT(var, field, n) ((var).counters.field += (n))
+
+#else
+
+#define NEO_PHASE(var, phase)
+#define NEO_NEXT_PHASE(var, phase) ((void)0)
+#define NEO_COUNT(var, field, n) ((void)0)
+
+#endif
@@ -0,0 +1,104 @@
+/** @file       NeoMemory.h
+ *  @brief      Memory accounting for fonts and caches.
+ *
+ *  Fonts are plain objects of a fixed size, so their footprint is computed
+ *  on request. Objects that hold memory that can be rebuilt, such as caches,
+ *  derive from NeoMemoryConsumer and keep a running total up to date. When a
+ *  cap is set and the total goes over it, the largest consumers are asked to
+ *  release their memory, which they do the next time they are used. This
+ *  keeps the accounting thread safe without locking the consumers.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+class NeoFont;
+
+struct NeoFontFootprint {
+    size_t allocated = 0; /**< Size of the object, sizeof(NeoFont). */
+    size_t pixels = 0;    /**< Bytes needed for width x height bits per
+                             character. */
+    size_t applet = 0;    /**< appletSize(). */
+
+    NeoFontFootprint &operator+=(const NeoFontFootprint &other);
+};
+
+NeoFontFootprint neoFontFootprint(const NeoFont &font);
+
+/** Base of objects whose memory is counted in neoMemoryUsage(). Consumers
+ * can not be copied or moved, since the registry refers to them.
+ */
+class NeoMemoryConsumer {
+public:
+    /// @param  name    Static string naming the kind of consumer.
+    explicit NeoMemoryConsumer(const char *name);
+    NeoMemoryConsumer(const NeoMemoryConsumer &) = delete;
+    NeoMemoryConsumer &operator=(const NeoMemoryConsumer &) = delete;
+    virtual ~NeoMemoryConsumer();
+
+    [[nodiscard]] const char *memoryName() const {
+        return m_name;
+    }
+
+    /// Bytes held, as last reported by the consumer.
+    [[nodiscard]] size_t memoryCharged() const {
+        return m_charged.load(std::memory_order_relaxed);
+    }
+
+protected:
+    /// Report the bytes now held. Going over the cap asks the largest of the
+    /// other consumers to release their memory, and this one too if that is
+    /// not enough.
+    void setMemoryCharged(size_t bytes);
+
+    /// Check, and clear, a request to release memory. Called by the
+    /// consumer when it is next used, from the thread that owns it.
+    bool releaseRequested() {
+        return m_release.load(std::memory_order_relaxed) &&
+               m_release.exchange(false, std::memory_order_acquire);
+    }
+
+private:
+    friend void enforceNeoMemoryCap();
+
+    static void requestReleases(const NeoMemoryConsumer *spared);
+
+    const char *m_name;
+    std::atomic<size_t> m_charged{0};
+    std::atomic<bool> m_release{false};
+};
+
+/// Totals of the consumers, grouped by name.
+struct NeoMemoryUsage {
+    struct Group {
+        const char *name = nullptr;
+        size_t consumers = 0;
+        size_t bytes = 0;
+    };
+
+    std::vector<Group> groups;
+    size_t total = 0;
+    size_t cap = 0;                /**< Zero when there is no cap. */
+    uint64_t releaseRequests = 0; /**< Since the program started. */
+
+    /** Write the values in the Prometheus text exposition format, for
+     * scraping or for a node exporter textfile.
+     */
+    void print(FILE *out) const;
+};
+
+NeoMemoryUsage neoMemoryUsage();
+
+/** Set the memory cap for all consumers, in bytes, zero for none. Setting a
+ * lower cap takes effect at once.
+ */
+void setNeoMemoryCap(size_t bytes);
+size_t neoMemoryCap();
+
+/// Ask consumers to release memory until the total is within the cap.
+void enforceNeoMemoryCap();
@@ -0,0 +1,24 @@
+/** @file       NeoNetpbm.h
+ *  @brief      Reading and writing of Netpbm (PBM/PGM) images.
+ */
+
+#pragma once
+
+#include <iosfwd>
+
+class NeoBitmap;
+
+/** Read a PBM (P1, P4) or PGM (P2, P5) image. Gray pixels darker than the
+ * threshold become set pixels; PBM images are copied as they are.
+ *
+ *  @param  in          The image data.
+ *  @param  image       Receives the image.
+ *  @param  threshold   Gray level (0-255 scale) below which a pixel is ink.
+ *  @return             Logical true if the image was read correctly.
+ */
+bool readNetpbm(std::istream &in, NeoBitmap &image, int threshold = 128);
+bool readNetpbmFile(const char *path, NeoBitmap &image, int threshold = 128);
+
+/// Write an image as a raw (P4) PBM file.
+bool writePbm(const NeoBitmap &image, std::ostream &out);
+bool writePbmFile(const NeoBitmap &image, const char *path);
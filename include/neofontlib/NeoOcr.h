@@ -0,0 +1,98 @@
+/** @file       NeoOcr.h
+ *  @brief      Recognition of text rendered with a known font.
+ */
+
+#pragma once
+
+#include "NeoBitmap.h"
+#include "NeoCharacterEncoding.h"
+#include "NeoSpan.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class NeoFont;
+
+struct NeoOcrOptions {
+    /// Mismatching pixels allowed in a glyph when no exact match is found.
+    /// Zero only accepts exact matches, which is also the fastest.
+    int maxDistance = 0;
+};
+
+/** An index of the glyphs of one font, used to read text back from screen
+ * dumps rendered with that font.
+ *
+ * Glyphs are grouped by width, and within a width sorted by their first row
+ * and a hash of all rows, so an exact match is found with a binary search per
+ * width. Distances are counted with popcount over row words. Characters with
+ * identical glyphs are indexed once, as the lowest code; of the blank glyphs
+ * only space is indexed.
+ */
+class NeoGlyphMatcher {
+public:
+    static constexpr int unknown = -1;   /**< Ink that matched no glyph. */
+    static constexpr int lineBreak = -2; /**< Separates lines of a screen. */
+
+    explicit NeoGlyphMatcher(const NeoFont &font,
+                             const NeoOcrOptions &options = {});
+
+    [[nodiscard]] int height() const {
+        return m_height;
+    }
+
+    /** Read one line of text whose top row is y, from column x to the last
+     * inked column. Matching is greedy from the left: the widest glyph that
+     * matches is taken and the scan advances by its width. Blank columns that
+     * match nothing are skipped, ink that matches nothing is reported once as
+     * unknown.
+     *
+     *  @param  codes   Neo character codes are appended here.
+     */
+    void readLine(const NeoBitmap &screen,
+                  int x,
+                  int y,
+                  std::vector<int> &codes) const;
+
+    /** Read all lines of a screen, starting at the top and stepping height()
+     * plus lineSpacing rows. Lines are separated by lineBreak.
+     */
+    void readScreen(const NeoBitmap &screen,
+                    std::vector<int> &codes,
+                    int lineSpacing = 0) const;
+
+private:
+    struct Glyph {
+        int code;
+        int width;
+        int ink;
+        uint64_t firstRow;
+        uint64_t hash;
+        size_t rows; /**< Index of the first row word in m_rows. */
+    };
+
+    struct WidthGroup {
+        int width;
+        uint64_t mask[2];
+        size_t begin; /**< Range of m_glyphs. */
+        size_t end;
+    };
+
+    int match(const uint64_t *window, int &width) const;
+    int matchClosest(const uint64_t *window, int &width) const;
+
+    int m_height = 0;
+    NeoOcrOptions m_options;
+    std::vector<Glyph> m_glyphs;
+    std::vector<uint64_t> m_rows;      /**< Two words per row, MSB first. */
+    std::vector<WidthGroup> m_groups;  /**< Widest first. */
+};
+
+/** Convert recognised codes to text. Unknown becomes U+FFFD and lineBreak a
+ * newline.
+ *
+ *  @param  codes       Codes from NeoGlyphMatcher.
+ *  @param  codePage    Normally that of the matched font.
+ */
+std::u16string neoCodesToUTF16(
+    NeoSpan<const int> codes,
+    const NeoCodePage &codePage = neoCodePage(neoCodePageNeo));
@@ -0,0 +1,42 @@
+/** @file       NeoPsf.h
+ *  @brief      Import of Linux console (PSF1/PSF2) fonts.
+ */
+
+#pragma once
+
+#include "NeoSpan.h"
+#include <cstdint>
+
+class NeoFont;
+
+/** Details of an imported PSF font.
+ */
+struct NeoPsfInfo {
+    int version = 0;         /**< 1 or 2. */
+    int glyphCount = 0;      /**< Glyphs in the PSF file. */
+    int width = 0;           /**< PSF glyph width, in pixels. */
+    int height = 0;          /**< PSF glyph height, in pixels. */
+    bool hasUnicodeTable = false;
+    int mappedCharacters = 0; /**< Neo characters that received a glyph. */
+};
+
+/// True if the data starts with a PSF1, PSF2 or gzip signature.
+bool isPsfData(NeoSpan<const uint8_t> data);
+
+/** Replace the glyphs of a font with those of a PSF font. Glyphs are matched
+ * to Neo character codes by Unicode value, using the PSF Unicode table when
+ * present and the glyph index otherwise. Neo characters without a glyph are
+ * left blank. The font height is set from the PSF font, the name and other
+ * metadata are left alone.
+ *
+ *  @param  data    The PSF file contents, optionally gzip compressed.
+ *  @param  font    The font to fill.
+ *  @param  info    Optional, receives details about the PSF font.
+ *  @return         Logical true if the data was parsed correctly.
+ */
+bool importPsf(NeoSpan<const uint8_t> data,
+               NeoFont &font,
+               NeoPsfInfo *info = nullptr);
+
+/// Read a PSF file (.psf, .psfu or .psf.gz) and import it.
+bool importPsfFile(const char *path, NeoFont &font, NeoPsfInfo *info = nullptr);
@@ -0,0 +1,49 @@
+/** @file       NeoResample.h
+ *  @brief      Scaling of fonts to other heights.
+ */
+
+#pragma once
+
+#include "NeoFont.h"
+#include "NeoSpan.h"
+#include <vector>
+
+enum class NeoResampleMode {
+    Nearest, /**< Sample the source pixel under each target pixel centre. */
+    Box,     /**< Set pixels covered at least half by source ink. Smooth, but
+                thin strokes can vanish when shrinking. */
+    Scale2x, /**< Double with Scale2x (EPX) while it fits, then Box. Keeps
+                diagonals smooth when scaling up. */
+};
+
+struct NeoResampleOptions {
+    NeoResampleMode mode = NeoResampleMode::Box;
+    int threads = 0; /**< Zero uses all cores. */
+};
+
+/** Scale one character from srcHeight rows to height rows. The width is
+ * scaled by the same factor, rounded, and limited to the character limits.
+ */
+void resampleCharacter(const NeoCharacter &source,
+                       int srcHeight,
+                       NeoCharacter &target,
+                       int height,
+                       NeoResampleMode mode = NeoResampleMode::Box);
+
+/** Make target a copy of source scaled to a new height. The characters are
+ * processed in parallel.
+ *
+ *  @return         The height used, after limiting to the character limits.
+ */
+int resampleFont(const NeoFont &source,
+                 NeoFont &target,
+                 int height,
+                 const NeoResampleOptions &options = {});
+
+/** Scale a master font to several heights in one pass, with all characters
+ * of all sizes sharing one pool of threads. Names and other metadata are
+ * copied from the master.
+ */
+std::vector<NeoFont> resampleFamily(const NeoFont &master,
+                                    NeoSpan<const int> heights,
+                                    const NeoResampleOptions &options = {});
@@ -0,0 +1,116 @@
+/** @file       NeoScreen.h
+ *  @brief      Text screen simulator with incremental redraw.
+ */
+
+#pragma once
+
+#include "NeoBitmap.h"
+#include "NeoGlyphCache.h"
+#include "NeoSpan.h"
+#include <cstdint>
+#include <vector>
+
+class NeoFont;
+struct NeoFontChanges;
+
+/** A document of lines of Neo character codes shown on a 1-bpp screen, one
+ * document line per text row, starting at a scroll position. Lines longer
+ * than the screen are clipped.
+ *
+ * Every line keeps the x position of each of its characters, taken from the
+ * font's widths, and each text row keeps the pixel span that has changed
+ * since the last render(). Editing updates the positions from the edit
+ * point onwards and widens the span; render() clears and redraws only the
+ * characters inside it, from a NeoGlyphCache. Inserting or removing lines and
+ * scrolling move the framebuffer rows instead of redrawing them.
+ *
+ * The font must outlive the screen. If its widths, glyphs or height change,
+ * invalidate() must be called. A new height resizes the framebuffer to the
+ * same number of text rows.
+ */
+class NeoScreen {
+public:
+    NeoScreen(const NeoFont &font, int width, int rows);
+
+    [[nodiscard]] const NeoBitmap &framebuffer() const {
+        return m_framebuffer;
+    }
+
+    [[nodiscard]] int rows() const {
+        return m_rows;
+    }
+
+    [[nodiscard]] size_t lineCount() const {
+        return m_lines.size();
+    }
+
+    [[nodiscard]] NeoSpan<const uint8_t> line(size_t index) const {
+        return m_lines.at(index).codes;
+    }
+
+    /// Replace the document, splitting lines at lineBreak.
+    void assign(NeoSpan<const uint8_t> text, uint8_t lineBreak = '\n');
+
+    void insert(size_t line, size_t column, uint8_t code);
+    void erase(size_t line, size_t column);
+
+    /// Insert a new line before line, with the given contents.
+    void insertLine(size_t line, NeoSpan<const uint8_t> codes = {});
+    void eraseLine(size_t line);
+
+    /// Move the end of a line, from column, to a new line after it.
+    void splitLine(size_t line, size_t column);
+
+    /// Append the next line to a line.
+    void joinLine(size_t line);
+
+    [[nodiscard]] size_t top() const {
+        return m_top;
+    }
+
+    void scrollTo(size_t top);
+
+    /// Redraw everything, for example after the font changed.
+    void invalidate();
+
+    /// Redraw everything if a NeoFontTransaction changed any character or
+    /// the height.
+    void invalidate(const NeoFontChanges &changes);
+
+    /// The cache used to draw characters, for its hit and miss counters.
+    [[nodiscard]] const NeoGlyphCache &glyphCache() const {
+        return m_glyphs;
+    }
+
+    /** Bring the framebuffer up to date.
+     *
+     *  @return         The number of characters drawn.
+     */
+    int render();
+
+private:
+    struct Line {
+        std::vector<uint8_t> codes;
+        std::vector<int> x; /**< Start of each character, then the end. */
+    };
+
+    /// Pixel columns of a text row to redraw, empty when from >= to.
+    struct Dirty {
+        int from = 0;
+        int to = 0;
+    };
+
+    void layout(Line &line, size_t from);
+    void markLine(size_t line, int from, int to);
+    void moveRows(int from, int to, int count);
+    int visibleRow(size_t line) const;
+
+    const NeoFont &m_font;
+    int m_rows;
+    int m_height;
+    NeoBitmap m_framebuffer;
+    NeoGlyphCache m_glyphs;
+    std::vector<Line> m_lines;
+    std::vector<Dirty> m_dirty; /**< One per text row. */
+    size_t m_top = 0;
+};
@@ -0,0 +1,70 @@
+/** @file       NeoSpan.h
+ *  @brief      Minimal non-owning view of contiguous memory.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+/** A pointer and a length, used by the allocation free parts of the API.
+ * This is a C++17 stand-in for std::span with only what the library needs.
+ */
+template <typename T>
+class NeoSpan {
+public:
+    constexpr NeoSpan() = default;
+    constexpr NeoSpan(T *data, size_t size)
+        : m_data(data)
+        , m_size(size) {}
+
+    /// Construct from any contiguous container with data() and size() whose
+    /// element type has the same size as T (eg. std::vector<char> as bytes).
+    /// This also converts a mutable span in to a const one.
+    template <typename Container,
+              typename Element = std::remove_pointer_t<
+                  decltype(std::declval<Container &>().data())>,
+              typename = std::enable_if_t<
+                  sizeof(Element) == sizeof(T) &&
+                  (std::is_const_v<T> || !std::is_const_v<Element>)>>
+    constexpr NeoSpan(Container &&c)
+        : m_data(reinterpret_cast<T *>(c.data()))
+        , m_size(c.size()) {}
+
+    constexpr T *data() const {
+        return m_data;
+    }
+
+    constexpr size_t size() const {
+        return m_size;
+    }
+
+    constexpr bool empty() const {
+        return m_size == 0;
+    }
+
+    constexpr T *begin() const {
+        return m_data;
+    }
+
+    constexpr T *end() const {
+        return m_data + m_size;
+    }
+
+    constexpr T &operator[](size_t i) const {
+        return m_data[i];
+    }
+
+    constexpr NeoSpan first(size_t n) const {
+        return {m_data, n < m_size ? n : m_size};
+    }
+
+    constexpr NeoSpan subspan(size_t offset) const {
+        return offset < m_size ? NeoSpan{m_data + offset, m_size - offset}
+                               : NeoSpan{};
+    }
+
+private:
+    T *m_data = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,75 @@
+/** @file       NeoSubset.h
+ *  @brief      Reduction of a font to the characters used by a text corpus.
+ */
+
+#pragma once
+
+#include "NeoFont.h"
+#include "NeoSpan.h"
+#include <array>
+#include <cstdint>
+
+/// Usage count per Neo character code.
+using NeoCharacterHistogram = std::array<uint64_t, NeoFont::charCount>;
+
+/** Counts the Neo characters needed to show UTF-8 text. Text can be added in
+ * chunks of any size, sequences split between chunks are handled. Code points
+ * are mapped with the code page of the font that will be subset.
+ */
+class NeoCorpusScanner {
+public:
+    explicit NeoCorpusScanner(
+        const NeoCodePage &codePage = neoCodePage(neoCodePageNeo));
+
+    void add(NeoSpan<const char> text);
+
+    /// Histogram of the text added so far.
+    [[nodiscard]] NeoCharacterHistogram histogram() const;
+
+    /// Number of code points that have no Neo character.
+    [[nodiscard]] uint64_t unmapped() const;
+
+    /// Number of code points seen.
+    [[nodiscard]] uint64_t codepoints() const;
+
+private:
+    void addCodepoint(uint32_t codepoint);
+
+    const NeoCodePage *m_codePage;
+
+    /// Plain ASCII bytes are counted per byte value in several banks, so
+    /// that consecutive equal bytes do not wait on each other's increment.
+    static constexpr size_t banks = 4;
+    std::array<std::array<uint64_t, 128>, banks> m_ascii = {};
+    NeoCharacterHistogram m_other = {};
+    uint64_t m_otherCount = 0;
+    uint64_t m_unmapped = 0;
+
+    /// Neo code + 1 for U+0080 to U+07FF that map to a single character.
+    std::array<uint8_t, 0x800> m_twoByte = {};
+
+    /// Partial UTF-8 sequence carried between chunks.
+    uint32_t m_partial = 0;
+    int m_pending = 0;
+};
+
+/// Scan a whole file. @return false if it could not be read.
+bool scanCorpusFile(const char *path, NeoCorpusScanner &scanner);
+
+struct NeoSubsetReport {
+    unsigned int sizeBefore = 0; /**< appletSize() before subsetting. */
+    unsigned int sizeAfter = 0;  /**< appletSize() after subsetting. */
+    int kept = 0;                /**< Characters left unchanged. */
+    int removed = 0;             /**< Characters replaced by a blank. */
+
+    [[nodiscard]] unsigned int bytesSaved() const {
+        return sizeBefore - sizeAfter;
+    }
+};
+
+/** Replace every character used fewer than minCount times with a blank,
+ * one pixel wide character, which is the smallest the applet can store.
+ */
+NeoSubsetReport subsetFont(NeoFont &font,
+                           const NeoCharacterHistogram &usage,
+                           uint64_t minCount = 1);
@@ -0,0 +1,104 @@
+/** @file       NeoAppletBuffer.cc
+ *  @brief      Reusable storage for encoded applets.
+ */
+
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoFont.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NeoAppletBuffer::NeoAppletBuffer(size_t capacity) {
+    reserve(capacity);
+}
+
+void NeoAppletBuffer::reserve(size_t capacity) {
+    if (capacity > m_data.size()) {
+        m_data.resize(capacity);
+    }
+}
+
+/** Resize the logical contents, growing the storage only when needed.
+ */
+uint8_t *NeoAppletBuffer::prepare(size_t size) {
+    reserve(size);
+    m_size = size;
+    return m_data.data();
+}
+
+NeoSpan<const uint8_t> NeoAppletBuffer::encode(const NeoFont &font) {
+    auto size = font.appletSize();
+    auto data = prepare(size);
+    m_size = font.encodeApplet(data, size);
+    return bytes();
+}
+
+NeoSpan<const uint8_t> NeoAppletBuffer::update(const NeoFont &font,
+                                               const NeoFontChanges &changes,
+                                               bool *patched) {
+    bool ok = font.patchApplet({m_data.data(), m_size}, changes);
+    if (patched) {
+        *patched = ok;
+    }
+    return ok ? bytes() : encode(font);
+}
+
+bool NeoAppletBuffer::decode(NeoFont &font) const {
+    return font.decodeApplet(bytes());
+}
+
+/** Read a file using plain POSIX calls, since stdio and iostreams allocate
+ * their own buffers.
+ */
+bool NeoAppletBuffer::load(const char *path) {
+    m_size = 0;
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    auto data = prepare(size);
+    size_t done = 0;
+    while (done < size) {
+        auto n = ::read(fd, data + done, size - done);
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    m_size = done;
+    return done == size;
+}
+
+bool NeoAppletBuffer::save(const char *path) const {
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t done = 0;
+    while (done < m_size) {
+        auto n = ::write(fd, m_data.data() + done, m_size - done);
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return (::close(fd) == 0) && done == m_size;
+}
+
+void NeoAppletBuffer::assign(NeoSpan<const uint8_t> data) {
+    auto dest = prepare(data.size());
+    if (!data.empty()) {
+        memcpy(dest, data.data(), data.size());
+    }
+}
@@ -0,0 +1,62 @@
+/** @file       NeoAppletCache.cc
+ *  @brief      Directory of encoded applets keyed by font fingerprint.
+ */
+
+#include "neofontlib/NeoAppletCache.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoFont.h"
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NeoAppletCache::NeoAppletCache(std::string directory)
+    : m_directory(std::move(directory)) {}
+
+std::string NeoAppletCache::path(uint64_t fingerprint) const {
+    char name[32];
+    snprintf(name, sizeof name, "/%016" PRIx64 ".OS3KApp", fingerprint);
+    return m_directory + name;
+}
+
+bool NeoAppletCache::lookup(uint64_t fingerprint, NeoAppletBuffer &out) const {
+    return out.load(path(fingerprint).c_str()) && out.size() > 0;
+}
+
+bool NeoAppletCache::store(uint64_t fingerprint,
+                           const NeoAppletBuffer &applet) const {
+    static std::atomic<unsigned> counter{0};
+
+    if (::mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+    auto target = path(fingerprint);
+    auto tmp = target + ".tmp." + std::to_string(::getpid()) + "." +
+               std::to_string(counter++);
+    if (!applet.save(tmp.c_str()) || ::rename(tmp.c_str(), target.c_str())) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+NeoSpan<const uint8_t> NeoAppletCache::encode(const NeoFont &font,
+                                              uint64_t fingerprint,
+                                              NeoAppletBuffer &out,
+                                              bool *hit) const {
+    // A size mismatch means a damaged entry, which is simply replaced.
+    bool found = lookup(fingerprint, out) && out.size() == font.appletSize();
+    if (hit) {
+        *hit = found;
+    }
+    if (found) {
+        return out.bytes();
+    }
+    if (out.encode(font).empty()) {
+        return {};
+    }
+    store(fingerprint, out);
+    return out.bytes();
+}
@@ -0,0 +1,372 @@
+/** @file       NeoBdf.cc
+ *  @brief      Import and export of X11 BDF fonts.
+ */
+
+#include "neofontlib/NeoBdf.h"
+#include "NeoBits.h"
+#include "neofontlib/NeoCharacterEncoding.h"
+#include "neofontlib/NeoFont.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace {
+
+/** Maximum number of row bytes handled, enough for a glyph that starts at
+ * x = maxWidth - 1 and is maxWidth wide.
+ */
+constexpr size_t kMaxRowBytes = NeoCharacter::rowBytes * 2;
+
+bool startsWith(const std::string &line, const char *keyword) {
+    auto n = strlen(keyword);
+    return line.compare(0, n, keyword) == 0 &&
+           (line.size() == n || line[n] == ' ' || line[n] == '\t');
+}
+
+/** Read only stream over a memory buffer.
+ */
+struct MemoryStreamBuf : std::streambuf {
+    MemoryStreamBuf(NeoSpan<const uint8_t> data) {
+        auto p = reinterpret_cast<char *>(const_cast<uint8_t *>(data.data()));
+        setg(p, p, p + data.size());
+    }
+};
+
+/** Parse up to count integers following the keyword of a line.
+ */
+int parseInts(const std::string &line, int *values, int count) {
+    auto p = line.c_str();
+    while (*p && *p != ' ' && *p != '\t') {
+        ++p; // Skip the keyword
+    }
+    int parsed = 0;
+    for (; parsed < count; ++parsed) {
+        char *end = nullptr;
+        auto v = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        values[parsed] = static_cast<int>(v);
+        p = end;
+    }
+    return parsed;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/** Convert one BITMAP line in to a Neo row: hex bytes are bit reversed and
+ * then shifted right by xoff pixels, a byte at a time. A negative xoff crops
+ * the left columns.
+ */
+void hexToRow(const std::string &line, int xoff, int width, uint8_t *row) {
+    uint8_t bytes[kMaxRowBytes + 1] = {};
+    size_t count = 0;
+    for (size_t i = 0; i + 1 < line.size() && count < kMaxRowBytes; i += 2) {
+        int hi = hexValue(line[i]);
+        int lo = hexValue(line[i + 1]);
+        if (hi < 0 || lo < 0) {
+            break;
+        }
+        bytes[count++] = neoReversedBits[(hi << 4) | lo];
+    }
+
+    memset(row, 0, NeoCharacter::rowBytes);
+    if (xoff >= 0) {
+        auto byteShift = static_cast<size_t>(xoff / 8);
+        int bitShift = xoff % 8;
+        for (size_t i = 0; i < count; ++i) {
+            auto dst = i + byteShift;
+            if (dst < NeoCharacter::rowBytes) {
+                row[dst] |= static_cast<uint8_t>(bytes[i] << bitShift);
+            }
+            if (bitShift && dst + 1 < NeoCharacter::rowBytes) {
+                row[dst + 1] |=
+                    static_cast<uint8_t>(bytes[i] >> (8 - bitShift));
+            }
+        }
+    }
+    else {
+        // bytes[count] is zero, so the last byte can read one past the end.
+        auto byteSkip = static_cast<size_t>(-xoff / 8);
+        int bitSkip = -xoff % 8;
+        for (size_t i = 0;
+             i + byteSkip < count && i < NeoCharacter::rowBytes;
+             ++i) {
+            auto src = i + byteSkip;
+            auto v = bytes[src] >> bitSkip;
+            if (bitSkip) {
+                v |= bytes[src + 1] << (8 - bitSkip);
+            }
+            row[i] = static_cast<uint8_t>(v);
+        }
+    }
+
+    auto used = (static_cast<size_t>(width) + 7) / 8;
+    row[used - 1] &= neoLastByteMask(width);
+    memset(row + used, 0, NeoCharacter::rowBytes - used);
+}
+
+/** What a Neo character has received so far. A glyph of its own replaces a
+ * copy made for another code with the same Unicode value.
+ */
+enum class BdfMapping : uint8_t {
+    None,
+    Copy,
+    Glyph,
+};
+
+/** Glyph being parsed.
+ */
+struct BdfGlyph {
+    int encoding = -1;
+    int advance = -1;
+    int bbx[4] = {0, 0, 0, 0}; // width, height, xoff, yoff
+    int codes[8];
+    size_t codeCount = 0;
+};
+
+} // namespace
+
+bool importBdf(std::istream &in, NeoFont &font, NeoBdfInfo *info) {
+    auto line = std::string{};
+    if (!std::getline(in, line) || !startsWith(line, "STARTFONT")) {
+        return false;
+    }
+
+    int fontBox[4] = {0, 0, 0, 0};
+    int ascent = -1;
+    int descent = -1;
+    int defaultAdvance = 8;
+    int height = 0;
+    int glyphCount = 0;
+    int mapped = 0;
+    BdfMapping seen[NeoFont::charCount] = {};
+    bool inGlyphs = false;
+    auto glyph = BdfGlyph{};
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        if (!inGlyphs) {
+            if (startsWith(line, "FONTBOUNDINGBOX")) {
+                parseInts(line, fontBox, 4);
+                defaultAdvance = fontBox[0];
+            }
+            else if (startsWith(line, "FONT_ASCENT")) {
+                parseInts(line, &ascent, 1);
+            }
+            else if (startsWith(line, "FONT_DESCENT")) {
+                parseInts(line, &descent, 1);
+            }
+            else if (startsWith(line, "CHARS")) {
+                // Metrics are complete, prepare the font.
+                inGlyphs = true;
+                if (ascent < 0 || descent < 0) {
+                    descent = -fontBox[3];
+                    ascent = fontBox[1] - descent;
+                }
+                height = font.setHeight(ascent + descent);
+                for (auto &c : font) {
+                    c.setWidth(defaultAdvance);
+                    for (int y = 0; y < height; ++y) {
+                        memset(c.row(y), 0, NeoCharacter::rowBytes);
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (startsWith(line, "STARTCHAR")) {
+            glyph = BdfGlyph{};
+            glyph.advance = defaultAdvance;
+            ++glyphCount;
+        }
+        else if (startsWith(line, "ENCODING")) {
+            // "ENCODING -1 <code>" names the Neo code of a glyph that
+            // shares its Unicode value with another, as written by
+            // exportBdf().
+            int values[2] = {-1, -1};
+            parseInts(line, values, 2);
+            glyph.encoding = values[0];
+            if (glyph.encoding == -1 && values[1] >= 0 &&
+                values[1] < static_cast<int>(NeoFont::charCount)) {
+                glyph.codes[0] = values[1];
+                glyph.codeCount = 1;
+            }
+            else if (glyph.encoding >= 0 && glyph.encoding <= 0xffff) {
+                glyph.codeCount = font.codePage().fromUTF16(
+                    static_cast<uint16_t>(glyph.encoding),
+                    glyph.codes,
+                    sizeof glyph.codes / sizeof *glyph.codes);
+            }
+        }
+        else if (startsWith(line, "DWIDTH")) {
+            parseInts(line, &glyph.advance, 1);
+        }
+        else if (startsWith(line, "BBX")) {
+            parseInts(line, glyph.bbx, 4);
+        }
+        else if (startsWith(line, "BITMAP")) {
+            // Glyphs outside the Neo character set are skipped unparsed.
+            NeoCharacter *target = nullptr;
+            for (size_t i = 0; i < glyph.codeCount; ++i) {
+                auto code = glyph.codes[i];
+                if (code >= 0 && seen[code] != BdfMapping::Glyph) {
+                    target = &font.character(code);
+                    target->setWidth(glyph.advance);
+                    mapped += seen[code] == BdfMapping::None;
+                    seen[code] = BdfMapping::Glyph;
+                    break;
+                }
+            }
+
+            // Row of the cell that receives the first bitmap line.
+            int top = ascent - (glyph.bbx[3] + glyph.bbx[1]);
+            int xoff = glyph.bbx[2];
+            int y = top;
+            while (std::getline(in, line) && !startsWith(line, "ENDCHAR")) {
+                if (target && y >= 0 && y < height) {
+                    hexToRow(line, xoff, target->width(), target->row(y));
+                }
+                ++y;
+            }
+
+            // Copy to other Neo codes that share the Unicode value.
+            if (target) {
+                for (size_t i = 0; i < glyph.codeCount; ++i) {
+                    auto code = glyph.codes[i];
+                    if (seen[code] == BdfMapping::None) {
+                        font.character(code) = *target;
+                        seen[code] = BdfMapping::Copy;
+                        ++mapped;
+                    }
+                }
+            }
+        }
+        else if (startsWith(line, "ENDFONT")) {
+            break;
+        }
+    }
+
+    if (info) {
+        info->glyphCount = glyphCount;
+        info->mappedCharacters = mapped;
+        info->ascent = ascent;
+        info->descent = descent;
+    }
+    return inGlyphs;
+}
+
+bool isBdfData(NeoSpan<const uint8_t> data) {
+    constexpr char keyword[] = "STARTFONT";
+    constexpr size_t n = sizeof keyword - 1;
+    return data.size() > n && !memcmp(data.data(), keyword, n) &&
+           (data[n] == ' ' || data[n] == '\t' || data[n] == '\n');
+}
+
+bool importBdf(NeoSpan<const uint8_t> data, NeoFont &font, NeoBdfInfo *info) {
+    auto buf = MemoryStreamBuf{data};
+    auto in = std::istream{&buf};
+    return importBdf(in, font, info);
+}
+
+bool importBdfFile(const char *path, NeoFont &font, NeoBdfInfo *info) {
+    auto file = std::ifstream{path};
+    return file && importBdf(file, font, info);
+}
+
+bool exportBdf(const NeoFont &font, std::ostream &out) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    int height = font.height();
+    int maxWidth = 1;
+    for (auto &c : font) {
+        if (c.width() > maxWidth) {
+            maxWidth = c.width();
+        }
+    }
+
+    // BDF names are single tokens.
+    auto name = std::string{font.fontName()};
+    for (auto &ch : name) {
+        if (ch == ' ' || ch == '-') {
+            ch = '_';
+        }
+    }
+
+    out << "STARTFONT 2.1\n"
+        << "FONT -neo-" << name << "-medium-r-normal--" << height
+        << "-" << height * 10 << "-72-72-c-" << maxWidth * 10
+        << "-iso10646-1\n"
+        << "SIZE " << height << " 72 72\n"
+        << "FONTBOUNDINGBOX " << maxWidth << " " << height << " 0 0\n"
+        << "STARTPROPERTIES 4\n"
+        << "FAMILY_NAME \"" << font.fontName() << "\"\n"
+        << "FONT_VERSION \"" << font.version() << "\"\n"
+        << "FONT_ASCENT " << height << "\n"
+        << "FONT_DESCENT 0\n"
+        << "ENDPROPERTIES\n"
+        << "CHARS " << NeoFont::charCount << "\n";
+
+    auto &codePage = font.codePage();
+    char line[NeoCharacter::rowBytes * 2 + 2];
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &c = font.character(i);
+        auto unicode = codePage.toUTF16(i);
+        int width = c.width();
+        bool primary = codePage.fromUTF16(unicode) == i;
+
+        out << "STARTCHAR neo" << i << "\n";
+        if (primary) {
+            out << "ENCODING " << unicode << "\n";
+        }
+        else {
+            out << "ENCODING -1 " << i << "\n";
+        }
+        out << "SWIDTH " << width * 1000 / height << " 0\n"
+            << "DWIDTH " << width << " 0\n"
+            << "BBX " << width << " " << height << " 0 0\n"
+            << "BITMAP\n";
+
+        auto bytes = (static_cast<size_t>(width) + 7) / 8;
+        auto lastMask = neoLastByteMask(width);
+        for (int y = 0; y < height; ++y) {
+            auto row = c.row(y);
+            for (size_t b = 0; b < bytes; ++b) {
+                auto v = row[b];
+                if (b + 1 == bytes) {
+                    v &= lastMask;
+                }
+                v = neoReversedBits[v];
+                line[b * 2] = hexDigits[v >> 4];
+                line[b * 2 + 1] = hexDigits[v & 15];
+            }
+            line[bytes * 2] = '\n';
+            out.write(line, static_cast<std::streamsize>(bytes * 2 + 1));
+        }
+        out << "ENDCHAR\n";
+    }
+    out << "ENDFONT\n";
+    return static_cast<bool>(out);
+}
+
+bool exportBdfFile(const NeoFont &font, const char *path) {
+    auto file = std::ofstream{path};
+    return file && exportBdf(font, file);
+}
@@ -0,0 +1,156 @@
+/** @file       NeoBitmap.cc
+ *  @brief      Packed one bit per pixel image.
+ */
+
+#include "neofontlib/NeoBitmap.h"
+#include "NeoBits.h"
+#include "neofontlib/NeoCharacter.h"
+#include <algorithm>
+#include <cstring>
+
+NeoBitmap::NeoBitmap(int width, int height) {
+    resize(width, height);
+}
+
+void NeoBitmap::resize(int width, int height) {
+    m_width = std::max(width, 0);
+    m_height = std::max(height, 0);
+    m_stride = (static_cast<size_t>(m_width) + 7) / 8;
+    m_data.assign(m_stride * m_height, 0);
+}
+
+void NeoBitmap::clear() {
+    std::fill(m_data.begin(), m_data.end(), 0);
+}
+
+int NeoBitmap::getPixel(int x, int y) const {
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+        return 0;
+    }
+    return (row(y)[x / 8] >> (7 - x % 8)) & 1;
+}
+
+void NeoBitmap::setPixel(int x, int y) {
+    if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
+        row(y)[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+    }
+}
+
+void NeoBitmap::fillRect(int x, int y, int w, int h) {
+    paintRect(x, y, w, h, true);
+}
+
+void NeoBitmap::clearRect(int x, int y, int w, int h) {
+    paintRect(x, y, w, h, false);
+}
+
+void NeoBitmap::paintRect(int x, int y, int w, int h, bool set) {
+    int x0 = std::max(x, 0);
+    int x1 = std::min(x + w, m_width);
+    int y0 = std::max(y, 0);
+    int y1 = std::min(y + h, m_height);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    int firstByte = x0 / 8;
+    int lastByte = (x1 - 1) / 8;
+    auto firstMask = static_cast<uint8_t>(0xff >> (x0 % 8));
+    auto lastMask = static_cast<uint8_t>(0xff << (7 - (x1 - 1) % 8));
+    auto paint = [set](uint8_t &byte, uint8_t mask) {
+        byte = static_cast<uint8_t>(set ? byte | mask : byte & ~mask);
+    };
+    for (int yy = y0; yy < y1; ++yy) {
+        auto r = row(yy);
+        if (firstByte == lastByte) {
+            paint(r[firstByte], firstMask & lastMask);
+            continue;
+        }
+        paint(r[firstByte], firstMask);
+        if (lastByte > firstByte + 1) {
+            memset(r + firstByte + 1, set ? 0xff : 0, lastByte - firstByte - 1);
+        }
+        paint(r[lastByte], lastMask);
+    }
+}
+
+void NeoBitmap::drawCharacter(const NeoCharacter &c, int x, int y) {
+    int width = c.width();
+    int height = c.height();
+    auto bytes = (width + 7) / 8;
+    auto lastMask = neoLastByteMask(width);
+    int y0 = std::max(0, -y);
+    int y1 = std::min(height, m_height - y);
+
+    for (int cy = y0; cy < y1; ++cy) {
+        auto src = c.row(cy);
+        auto dst = row(y + cy);
+        for (int b = 0; b < bytes; ++b) {
+            auto v = src[b];
+            if (b + 1 == bytes) {
+                v &= lastMask;
+            }
+            if (!v) {
+                continue;
+            }
+            // Place the 8 pixels of this byte at pixel column px.
+            unsigned int bits = neoReversedBits[v];
+            int px = x + b * 8;
+            if (px < 0) {
+                if (px <= -8) {
+                    continue;
+                }
+                bits = (bits << -px) & 0xff;
+                px = 0;
+            }
+            int byte = px / 8;
+            int shift = px % 8;
+            if (byte < static_cast<int>(m_stride)) {
+                dst[byte] |= static_cast<uint8_t>(bits >> shift);
+            }
+            if (shift && byte + 1 < static_cast<int>(m_stride)) {
+                dst[byte + 1] |= static_cast<uint8_t>(bits << (8 - shift));
+            }
+        }
+        // Keep the padding bits past the right hand edge clear.
+        if (m_width % 8) {
+            dst[m_stride - 1] &= paddingMask();
+        }
+    }
+}
+
+void NeoBitmap::extractCharacter(
+    int x, int y, int w, int h, NeoCharacter &c) const {
+    w = std::min(w, c.width());
+    h = std::min(h, c.height());
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    auto bytes = static_cast<size_t>((w + 7) / 8);
+
+    for (int cy = 0; cy < h; ++cy) {
+        auto dst = c.row(cy);
+        memset(dst, 0, NeoCharacter::rowBytes);
+        int sy = y + cy;
+        if (sy < 0 || sy >= m_height) {
+            continue;
+        }
+        auto src = row(sy);
+        for (size_t b = 0; b < bytes; ++b) {
+            // Gather 8 pixels starting at column px.
+            int px = x + static_cast<int>(b) * 8;
+            unsigned int bits = 0;
+            for (int part = 0; part < 2; ++part) {
+                int byte = (px >= 0 ? px / 8 : (px - 7) / 8) + part;
+                if (byte < 0 || byte >= static_cast<int>(m_stride)) {
+                    continue;
+                }
+                int shift = ((px % 8) + 8) % 8;
+                unsigned int v = src[byte];
+                bits |= part == 0 ? (v << shift) : (v >> (8 - shift));
+            }
+            dst[b] = neoReversedBits[bits & 0xff];
+        }
+        dst[bytes - 1] &= neoLastByteMask(w);
+    }
+}
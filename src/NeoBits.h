@@ -0,0 +1,61 @@
+/** @file       NeoBits.h
+ *  @brief      Bit helpers shared by the importers and exporters.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/** Table reversing the bit order of a byte. Most file formats store the
+ * leftmost pixel in the most significant bit, NeoCharacter rows in the least
+ * significant one.
+ */
+constexpr std::array<uint8_t, 256> neoReversedBits = [] {
+    auto table = std::array<uint8_t, 256>{};
+    for (int i = 0; i < 256; ++i) {
+        int r = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            if (i & (1 << bit)) {
+                r |= 0x80 >> bit;
+            }
+        }
+        table[i] = static_cast<uint8_t>(r);
+    }
+    return table;
+}();
+
+/** Mask of the valid bits in the last byte of a row that is width pixels
+ * wide, in NeoCharacter (LSB first) order.
+ */
+constexpr uint8_t neoLastByteMask(int width) {
+    return static_cast<uint8_t>(0xff >> ((8 - width % 8) % 8));
+}
+
+/** Load a NeoCharacter row as two words, pixel x in bit x % 64 of word
+ * x / 64, with pixels right of width cleared. The bytes are combined
+ * explicitly so the words are the same on any host.
+ */
+inline void neoLoadRow(const uint8_t *row, int width, uint64_t *words) {
+    for (int w = 0; w < 2; ++w) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) {
+            v = (v << 8) | row[w * 8 + i];
+        }
+        int bits = width - w * 64;
+        if (bits <= 0) {
+            v = 0;
+        }
+        else if (bits < 64) {
+            v &= (uint64_t{1} << bits) - 1;
+        }
+        words[w] = v;
+    }
+}
+
+/// Store two words loaded by neoLoadRow() back as a NeoCharacter row.
+inline void neoStoreRow(const uint64_t *words, uint8_t *row) {
+    for (int i = 0; i < 16; ++i) {
+        row[i] = static_cast<uint8_t>(words[i / 8] >> (i % 8 * 8));
+    }
+}
@@ -4,6 +4,9 @@
  */
 
 #include "neofontlib/NeoCharacter.h"
+#include "NeoBits.h"
+#include <algorithm>
+#include <cstdlib>
 #include <stdexcept>
 #include <stdint.h>
 #include <string.h>
@@ -34,6 +37,77 @@ constexpr char XY_TO_BIT(char x, char y) {
     }
 }
 
+namespace {
+
+/// A whole row, pixel x in bit x. The drawing operations work on these
+/// instead of single pixels.
+using Row = unsigned __int128;
+
+Row loadRow(const uint8_t *row) {
+    uint64_t words[2];
+    neoLoadRow(row, NeoCharacter::maxWidth, words);
+    return Row{words[0]} | Row{words[1]} << 64;
+}
+
+void storeRow(Row value, uint8_t *row) {
+    uint64_t words[2] = {static_cast<uint64_t>(value),
+                         static_cast<uint64_t>(value >> 64)};
+    neoStoreRow(words, row);
+}
+
+/// Pixels x0 up to x1, where 0 <= x0 and x1 <= maxWidth.
+Row spanMask(int x0, int x1) {
+    if (x0 >= x1) {
+        return 0;
+    }
+    auto ones = ~Row{0};
+    auto below = x1 >= static_cast<int>(NeoCharacter::maxWidth)
+                     ? ones
+                     : (Row{1} << x1) - 1;
+    return below & (ones << x0);
+}
+
+/// Set, clear or flip the pixels of a row given by mask, as changePixel().
+void applyMask(uint8_t *row, Row mask, int v) {
+    auto value = loadRow(row);
+    if (v > 0) {
+        value |= mask;
+    }
+    else if (v == 0) {
+        value &= ~mask;
+    }
+    else {
+        value ^= mask;
+    }
+    storeRow(value, row);
+}
+
+/** Grow seed to the runs of open pixels it touches, in both directions at
+ * once with log2(maxWidth) shifts.
+ */
+Row fillRuns(Row seed, Row open) {
+    Row left = seed;
+    Row right = seed;
+    Row openLeft = open;
+    Row openRight = open;
+    for (int shift = 1; shift < static_cast<int>(NeoCharacter::maxWidth);
+         shift *= 2) {
+        left |= openLeft & (left << shift);
+        openLeft &= openLeft << shift;
+        right |= openRight & (right >> shift);
+        openRight &= openRight >> shift;
+    }
+    return left | right;
+}
+
+int lowestBit(Row value) {
+    auto low = static_cast<uint64_t>(value);
+    return low ? __builtin_ctzll(low)
+               : 64 + __builtin_ctzll(static_cast<uint64_t>(value >> 64));
+}
+
+} // namespace
+
 NeoCharacter::NeoCharacter() {
     clear();
 }
@@ -62,9 +136,10 @@ int NeoCharacter::height() const {
  *  @return         The actual width used.
  */
 int NeoCharacter::setWidth(int w) {
-    if (w > maxWidth)
+    // Compared as int, so that a negative width is raised to the minimum.
+    if (w > static_cast<int>(maxWidth))
         w = maxWidth;
-    if (w < minWidth)
+    if (w < static_cast<int>(minWidth))
         w = minWidth;
     m_width = w;
     return m_width;
@@ -76,17 +151,12 @@ int NeoCharacter::setWidth(int w) {
  *  @return         The actual height used.
  */
 int NeoCharacter::setHeight(int h) {
-    if (h > maxHexght)
+    if (h > static_cast<int>(maxHexght))
         h = maxHexght;
-    if (h < minHeight)
+    if (h < static_cast<int>(minHeight))
         h = minHeight;
-    if (h > m_height) {
-        for (int y = m_height; y < h; y++) {
-            for (int x = 0; x < m_width; x++) {
-                // Clear newly expanded rows
-                m_bitmap[XY_TO_BYTE(x, y)] &= ~(1u << XY_TO_BIT(x, y));
-            }
-        }
+    for (int y = m_height; y < h; y++) {
+        memset(row(y), 0, rowBytes); // Clear newly expanded rows
     }
     m_height = h;
     return m_height;
@@ -182,6 +252,276 @@ void NeoCharacter::changePixel(int x, int y, int v) {
     }
 }
 
+/** Change the pixels x0 up to x1 of row y, clipped to the character.
+ */
+void NeoCharacter::paintSpan(int y, int x0, int x1, int v, NeoRowRange &dirty) {
+    if (y < 0 || y >= m_height) {
+        return;
+    }
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, m_width);
+    if (x0 < x1) {
+        applyMask(row(y), spanMask(x0, x1), v);
+        dirty.include(y);
+    }
+}
+
+/** Draw a line with Bresenham's algorithm. The pixels of the line in each row
+ * are changed together, so a shallow line costs one operation per row.
+ * Pixels outside the character are skipped.
+ *
+ *  @param  x0, y0  The first end point.
+ *  @param  x1, y1  The last end point, included in the line.
+ *  @param  v       As for changePixel(). Every pixel is changed once, so
+ * flipping works.
+ *  @return         The rows changed.
+ */
+NeoRowRange NeoCharacter::drawLine(int x0, int y0, int x1, int y1, int v) {
+    auto dirty = NeoRowRange{};
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    int x = x0;
+    int y = y0;
+    int runStart = x0; // First pixel of the line in row y
+    for (;;) {
+        if (x == x1 && y == y1) {
+            paintSpan(
+                y, std::min(runStart, x), std::max(runStart, x) + 1, v, dirty);
+            break;
+        }
+        int e2 = 2 * err;
+        int last = x;
+        if (e2 >= dy) {
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            paintSpan(y,
+                      std::min(runStart, last),
+                      std::max(runStart, last) + 1,
+                      v,
+                      dirty);
+            y += sy;
+            runStart = x;
+        }
+    }
+    return dirty;
+}
+
+/** Draw the outline of a rectangle, clipped to the character.
+ *
+ *  @param  x, y    The top left corner.
+ *  @param  w, h    The size, in pixels.
+ *  @param  v       As for changePixel().
+ *  @return         The rows changed.
+ */
+NeoRowRange NeoCharacter::drawRect(int x, int y, int w, int h, int v) {
+    auto dirty = NeoRowRange{};
+    if (w <= 0 || h <= 0) {
+        return dirty;
+    }
+    paintSpan(y, x, x + w, v, dirty);
+    if (h > 1) {
+        paintSpan(y + h - 1, x, x + w, v, dirty);
+    }
+    int from = std::max(y + 1, 0);
+    int to = std::min(y + h - 1, m_height);
+    for (int row = from; row < to; row++) {
+        paintSpan(row, x, x + 1, v, dirty);
+        if (w > 1) {
+            paintSpan(row, x + w - 1, x + w, v, dirty);
+        }
+    }
+    return dirty;
+}
+
+/** Fill a rectangle, clipped to the character, a row at a time.
+ *
+ *  @param  x, y    The top left corner.
+ *  @param  w, h    The size, in pixels.
+ *  @param  v       As for changePixel().
+ *  @return         The rows changed.
+ */
+NeoRowRange NeoCharacter::fillRect(int x, int y, int w, int h, int v) {
+    auto dirty = NeoRowRange{};
+    if (w <= 0) {
+        return dirty;
+    }
+    int from = std::max(y, 0);
+    int to = std::min(y + std::max(h, 0), m_height);
+    for (int row = from; row < to; row++) {
+        paintSpan(row, x, x + w, v, dirty);
+    }
+    return dirty;
+}
+
+/** Change the 4-connected area of pixels with the same value as (x, y). Each
+ * row of the area is grown along its runs with word shifts and then seeds
+ * the rows above and below, until no row changes.
+ *
+ *  @param  x, y    A pixel in the area.
+ *  @param  v       The value for the area, as for changePixel(). Filling an
+ * area with its own value does nothing.
+ *  @return         The rows changed.
+ */
+NeoRowRange NeoCharacter::floodFill(int x, int y, int v) {
+    auto dirty = NeoRowRange{};
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+        return dirty;
+    }
+    int value = getPixel(x, y);
+    int target = v > 0 ? 1 : v == 0 ? 0 : !value;
+    if (target == value) {
+        return dirty;
+    }
+
+    // Pixels that may join the area, and the area found so far.
+    Row open[maxHexght];
+    Row area[maxHexght] = {};
+    auto inside = spanMask(0, m_width);
+    for (int row = 0; row < m_height; row++) {
+        auto bits = loadRow(this->row(row));
+        open[row] = (value ? bits : ~bits) & inside;
+    }
+
+    area[y] = Row{1} << x;
+    Row pending = Row{1} << y; // Rows with area not grown along the row
+    while (pending) {
+        int row = lowestBit(pending);
+        pending &= pending - 1;
+        area[row] = fillRuns(area[row], open[row]);
+        for (int next : {row - 1, row + 1}) {
+            if (next < 0 || next >= m_height) {
+                continue;
+            }
+            auto seed = area[row] & open[next] & ~area[next];
+            if (seed) {
+                area[next] |= seed;
+                pending |= Row{1} << next;
+            }
+        }
+    }
+
+    for (int row = 0; row < m_height; row++) {
+        if (area[row]) {
+            applyMask(this->row(row), area[row], -1);
+            dirty.include(row);
+        }
+    }
+    return dirty;
+}
+
+/** Copy a rectangle of pixels from another character, or from elsewhere in
+ * this one, replacing the pixels under it. The rectangle is clipped to both
+ * characters, which need not have the same size. To cut a region out as a
+ * clipboard, paste it in to a blank character of the region's size.
+ *
+ *  @param  source  The character to copy from, which may be this one.
+ *  @param  sx, sy  The top left corner of the region in source.
+ *  @param  w, h    The size of the region.
+ *  @param  x, y    Where the top left corner goes in this character.
+ *  @return         The rows changed.
+ */
+NeoRowRange NeoCharacter::paste(const NeoCharacter &source,
+                                int sx,
+                                int sy,
+                                int w,
+                                int h,
+                                int x,
+                                int y) {
+    if (sx < 0) {
+        w += sx;
+        x -= sx;
+        sx = 0;
+    }
+    if (sy < 0) {
+        h += sy;
+        y -= sy;
+        sy = 0;
+    }
+    if (x < 0) {
+        w += x;
+        sx -= x;
+        x = 0;
+    }
+    if (y < 0) {
+        h += y;
+        sy -= y;
+        y = 0;
+    }
+    w = std::min({w, source.m_width - sx, m_width - x});
+    h = std::min({h, source.m_height - sy, m_height - y});
+    if (w <= 0 || h <= 0) {
+        return {};
+    }
+
+    // Read every source row first in case the regions overlap.
+    Row rows[maxHexght];
+    for (int i = 0; i < h; i++) {
+        rows[i] = loadRow(source.row(sy + i)) >> sx << x;
+    }
+    auto mask = spanMask(x, x + w);
+    for (int i = 0; i < h; i++) {
+        auto target = row(y + i);
+        storeRow((loadRow(target) & ~mask) | (rows[i] & mask), target);
+    }
+    return {y, y + h};
+}
+
+/** Direct access to the storage of one row, for code that moves whole rows
+ * instead of single pixels. The row is rowBytes long; bits right of width()
+ * are not guaranteed to be clear.
+ *
+ *  @param  y       The row, 0 to maxHexght - 1.
+ *  @return         A pointer to the first byte of the row.
+ */
+const uint8_t *NeoCharacter::row(int y) const {
+    return &m_bitmap.at(XY_TO_BYTE(0, y));
+}
+
+uint8_t *NeoCharacter::row(int y) {
+    return &m_bitmap.at(XY_TO_BYTE(0, y));
+}
+
+/** Find the horizontal ink extent of the character. All rows are ORed
+ * together a word at a time and the highest set column of the result is
+ * located.
+ *
+ *  @return         One more than the rightmost set pixel column, or zero if
+ * the character is blank.
+ */
+int NeoCharacter::inkWidth() const {
+    constexpr size_t words = rowBytes / sizeof(uint64_t);
+    uint64_t acc[words] = {};
+    // Only the words that hold columns left of the width
+    size_t usedWords = (m_width + 63) / 64;
+    for (int y = 0; y < m_height; y++) {
+        auto r = row(y);
+        for (size_t w = 0; w < usedWords; w++) {
+            uint64_t v;
+            memcpy(&v, r + w * sizeof v, sizeof v);
+            acc[w] |= v;
+        }
+    }
+
+    uint8_t bytes[rowBytes];
+    memcpy(bytes, acc, sizeof bytes);
+    int usedBytes = (m_width + 7) / 8;
+    if (m_width % 8) {
+        bytes[usedBytes - 1] &= 0xff >> (8 - m_width % 8);
+    }
+    for (int b = usedBytes - 1; b >= 0; b--) {
+        if (bytes[b]) {
+            return b * 8 + 32 - __builtin_clz(bytes[b]);
+        }
+    }
+    return 0;
+}
+
 /** Translate the character.
  *
  *  @param  dx      The x-displacement (positive => right, negative => left).
@@ -4,22 +4,26 @@
  *  @copyright  (c) 2006 Alquanto. All Rights Reserved.
  */
 #include "neofontlib/NeoCharacterEncoding.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
 #include <stdint.h>
+#include <string>
 
-/** Static lookup table used to map 8 bit Neo character codes to UTF16.
+namespace {
+
+/** Lookup table used to map 8 bit Neo character codes to UTF16, with the
+ * translations of the Neo font characters 0-31.
  */
-static const uint16_t neoToUnicode[256] = {
-#if 1 // translations of the Neo font characters 0-31
+constexpr NeoCodePage::Table neoToUnicode = {{
     0x25a0, 0x03b4, 0x0394, 0x222b, 0x0143, 0x0133, 0x274f, 0x2154, 0x02d9,
     0x21e5, 0x2193, 0x2191, 0x2913, 0x21b5, 0x2908, 0x2909, 0x2192, 0x2153,
     0x039e, 0x03b1, 0x03c1, 0x2195, 0x21b5, 0x25a1, 0x221a, 0x2264, 0x2265,
     0x03b8, 0x221e, 0x03a9, 0x03b2, 0x03a3,
-#else // standard control codes, with exception of 0x0000 (solid block)
-    0x25a0, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007, 0x0008,
-    0x0009, 0x000a, 0x000b, 0x000c, 0x000d, 0x000e, 0x000f, 0x0010, 0x0011,
-    0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017, 0x0018, 0x0019, 0x001a,
-    0x001b, 0x001c, 0x001d, 0x001e, 0x001f,
-#endif
     0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027, 0x0028,
     0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f, 0x0030, 0x0031,
     0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003a,
@@ -44,7 +48,194 @@ static const uint16_t neoToUnicode[256] = {
     0x00dd, 0x00de, 0x00df, 0x00e0, 0x00e1, 0x00e2, 0x00e3, 0x00e4, 0x00e5,
     0x00e6, 0x00e7, 0x00e8, 0x00e9, 0x00ea, 0x00eb, 0x00ec, 0x00ed, 0x00ee,
     0x00ef, 0x00f0, 0x00f1, 0x00f2, 0x00f3, 0x00f4, 0x00f5, 0x00f6, 0x00f7,
-    0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x00fd, 0x00fe, 0x00ff};
+    0x00f8, 0x00f9, 0x00fa, 0x00fb, 0x00fc, 0x00fd, 0x00fe, 0x00ff}};
+
+/** The same table with standard control codes for 1-31. Code 0 stays the
+ * solid block.
+ */
+constexpr NeoCodePage::Table controlToUnicode = [] {
+    auto table = neoToUnicode;
+    for (uint16_t i = 1; i < 32; ++i) {
+        table[i] = i;
+    }
+    return table;
+}();
+
+constexpr NeoCodePage builtInPages[] = {
+    {"neo", neoToUnicode},
+    {"control", controlToUnicode},
+};
+
+constexpr size_t builtInCount = sizeof builtInPages / sizeof *builtInPages;
+constexpr size_t maxUserPages = 48;
+
+/** Pages added at run time. Slots are only filled, never changed, so readers
+ * need no lock: a slot is published by the release store of count.
+ */
+struct Registry {
+    std::mutex mutex;
+    std::atomic<size_t> count{0};
+    std::unique_ptr<const NeoCodePage> pages[maxUserPages];
+};
+
+Registry &registry() {
+    static Registry r;
+    return r;
+}
+
+const NeoCodePage *userPage(NeoCodePageId id) {
+    if (id < neoCodePageUserMin) {
+        return nullptr;
+    }
+    auto &r = registry();
+    size_t index = id - neoCodePageUserMin;
+    if (index >= r.count.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return r.pages[index].get();
+}
+
+/** Parse a number in the mapping files, "0x" followed by hex digits.
+ */
+bool parseHex(const char *&p, unsigned long &value) {
+    while (*p == ' ' || *p == '\t') {
+        ++p;
+    }
+    if (p[0] != '0' || (p[1] != 'x' && p[1] != 'X')) {
+        return false;
+    }
+    char *end = nullptr;
+    value = strtoul(p + 2, &end, 16);
+    if (end == p + 2) {
+        return false;
+    }
+    p = end;
+    return true;
+}
+
+} // namespace
+
+/** Return the lowest Neo character code used for a UTF16 code.
+ *
+ *  @param  utf16           The UTF16 code, in native endian form.
+ *  @return                 The lowest matching Neo character code, or -1 if
+ * the character does not exist in the code page.
+ */
+int NeoCodePage::fromUTF16(uint16_t utf16) const {
+    auto it = std::lower_bound(
+        m_fromUnicode.begin(),
+        m_fromUnicode.end(),
+        utf16,
+        [](const Reverse &a, uint16_t b) { return a.utf16 < b; });
+    if (it == m_fromUnicode.end() || it->utf16 != utf16) {
+        return -1;
+    }
+    return it->neo;
+}
+
+/** Find all Neo character codes used for a UTF16 code.
+ *
+ *  @param  utf16           The UTF16 code, in native endian form.
+ *  @param  codes           Receives up to maxCodes Neo codes, in ascending
+ * order.
+ *  @param  maxCodes        The size of codes.
+ *  @return                 The number of matching Neo codes, which may be
+ * larger than maxCodes.
+ */
+size_t NeoCodePage::fromUTF16(uint16_t utf16,
+                              int *codes,
+                              size_t maxCodes) const {
+    auto it = std::lower_bound(
+        m_fromUnicode.begin(),
+        m_fromUnicode.end(),
+        utf16,
+        [](const Reverse &a, uint16_t b) { return a.utf16 < b; });
+    size_t count = 0;
+    for (; it != m_fromUnicode.end() && it->utf16 == utf16; ++it, ++count) {
+        if (count < maxCodes) {
+            codes[count] = it->neo;
+        }
+    }
+    return count;
+}
+
+const NeoCodePage &neoCodePage(NeoCodePageId id) {
+    if (id < builtInCount) {
+        return builtInPages[id];
+    }
+    auto page = userPage(id);
+    return page ? *page : builtInPages[neoCodePageNeo];
+}
+
+bool isNeoCodePage(NeoCodePageId id) {
+    return id < builtInCount || userPage(id);
+}
+
+int findNeoCodePage(const char *name) {
+    for (size_t i = 0; i < builtInCount; ++i) {
+        if (strcmp(builtInPages[i].name(), name) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    auto &r = registry();
+    auto count = r.count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        if (strcmp(r.pages[i]->name(), name) == 0) {
+            return static_cast<int>(neoCodePageUserMin + i);
+        }
+    }
+    return -1;
+}
+
+int registerNeoCodePage(const NeoCodePage &page) {
+    auto &r = registry();
+    auto lock = std::lock_guard{r.mutex};
+    auto count = r.count.load(std::memory_order_relaxed);
+    if (count >= maxUserPages || !*page.name() ||
+        findNeoCodePage(page.name()) >= 0) {
+        return -1;
+    }
+    r.pages[count] = std::make_unique<const NeoCodePage>(page);
+    r.count.store(count + 1, std::memory_order_release);
+    return static_cast<int>(neoCodePageUserMin + count);
+}
+
+bool parseNeoCodePage(std::istream &in, NeoCodePage::Table &table) {
+    table = neoToUnicode;
+    auto line = std::string{};
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        const char *p = line.c_str();
+        while (*p == ' ' || *p == '\t' || *p == '\r') {
+            ++p;
+        }
+        if (!*p) {
+            continue;
+        }
+        unsigned long code = 0;
+        unsigned long utf16 = 0;
+        if (!parseHex(p, code) || code > 255) {
+            return false;
+        }
+        if (!parseHex(p, utf16)) {
+            continue; // Codes without a mapping keep the default
+        }
+        if (utf16 > 0xffff) {
+            return false; // The Neo character set is within the BMP
+        }
+        table[code] = static_cast<uint16_t>(utf16);
+    }
+    return !in.bad();
+}
+
+int loadNeoCodePage(const char *path, const char *name) {
+    auto file = std::ifstream{path};
+    auto table = NeoCodePage::Table{};
+    if (!file || !parseNeoCodePage(file, table)) {
+        return -1;
+    }
+    return registerNeoCodePage(NeoCodePage{name, table});
+}
 
 /** Return the UTF16 equivalent to a given Neo character code.
  *
@@ -52,7 +243,20 @@ static const uint16_t neoToUnicode[256] = {
  *  @return                 The corresponding UTF16 code, in native endian form.
  */
 uint16_t NeoCharacterToUTF16(int neoCharacter) {
-    return (neoCharacter >= 0 && neoCharacter <= 255)
-               ? neoToUnicode[neoCharacter]
-               : neoToUnicode[0];
+    return builtInPages[neoCodePageNeo].toUTF16(neoCharacter);
+}
+
+/** Return the Neo character code used for a UTF16 code.
+ *
+ *  @param  utf16           The UTF16 code, in native endian form.
+ *  @return                 The lowest matching Neo character code, or -1 if
+ * the character does not exist in the Neo character set.
+ */
+int UTF16ToNeoCharacter(uint16_t utf16) {
+    return builtInPages[neoCodePageNeo].fromUTF16(utf16);
+}
+
+/// @see NeoCodePage::fromUTF16()
+size_t UTF16ToNeoCharacters(uint16_t utf16, int *codes, size_t maxCodes) {
+    return builtInPages[neoCodePageNeo].fromUTF16(utf16, codes, maxCodes);
 }
@@ -0,0 +1,342 @@
+/** @file       NeoDelta.cc
+ *  @brief      Comparison of fonts and binary patches between versions.
+ *
+ *  Delta layout, all integers little endian:
+ *
+ *      "NFD1"
+ *      u64     neoFontHash() of the old font
+ *      u64     neoFontHash() of the new font
+ *      u8      new height
+ *      u8      flags, bit 0: metadata follows
+ *      [metadata: applet name, applet info, font name and version as u8
+ *       length + bytes, then u16 ident]
+ *      u16     number of character records
+ *      records: u8 code, u8 new width, u16 packed length, packed XOR rows
+ *
+ *  The XOR covers the new height and the bytes needed for the wider of the
+ *  two widths. It is packed as control bytes: with the top bit set, a run of
+ *  (c & 0x7f) + 1 zero bytes, otherwise c + 1 literal bytes follow.
+ */
+
+#include "neofontlib/NeoDelta.h"
+#include "NeoBits.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoHash.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+constexpr char deltaMagic[4] = {'N', 'F', 'D', '1'};
+constexpr uint8_t flagMetadata = 1;
+
+using Rows = std::array<uint64_t, NeoCharacter::maxHexght * 2>;
+
+/** Rows of a character as two words each, with pixels right of the width
+ * and rows below the height cleared.
+ */
+void canonicalRows(const NeoCharacter &c, int height, Rows &rows) {
+    rows = {};
+    for (int y = 0; y < height; ++y) {
+        neoLoadRow(c.row(y), c.width(), &rows[y * 2]);
+    }
+}
+
+bool sameMetadata(const NeoFont &a, const NeoFont &b) {
+    return !strcmp(a.appletName(), b.appletName()) &&
+           !strcmp(a.appletInfo(), b.appletInfo()) &&
+           !strcmp(a.fontName(), b.fontName()) &&
+           !strcmp(a.version(), b.version()) && a.ident() == b.ident();
+}
+
+void putU16(std::vector<uint8_t> &out, unsigned v) {
+    out.push_back(v & 0xff);
+    out.push_back((v >> 8) & 0xff);
+}
+
+void putU64(std::vector<uint8_t> &out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back((v >> (i * 8)) & 0xff);
+    }
+}
+
+void putString(std::vector<uint8_t> &out, const char *s) {
+    auto length = std::min<size_t>(strlen(s), 255);
+    out.push_back(static_cast<uint8_t>(length));
+    out.insert(out.end(), s, s + length);
+}
+
+void pack(const uint8_t *data, size_t size, std::vector<uint8_t> &out) {
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 0;
+        while (i + run < size && !data[i + run] && run < 128) {
+            ++run;
+        }
+        if (run) {
+            out.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+            i += run;
+            continue;
+        }
+        size_t literal = 0;
+        while (i + literal < size && data[i + literal] && literal < 128) {
+            ++literal;
+        }
+        out.push_back(static_cast<uint8_t>(literal - 1));
+        out.insert(out.end(), data + i, data + i + literal);
+        i += literal;
+    }
+}
+
+bool unpack(NeoSpan<const uint8_t> packed, uint8_t *data, size_t size) {
+    size_t o = 0;
+    for (size_t i = 0; i < packed.size();) {
+        auto c = packed[i++];
+        size_t n = (c & 0x7f) + 1u;
+        if (o + n > size) {
+            return false;
+        }
+        if (c & 0x80) {
+            memset(data + o, 0, n);
+        }
+        else {
+            if (i + n > packed.size()) {
+                return false;
+            }
+            memcpy(data + o, packed.data() + i, n);
+            i += n;
+        }
+        o += n;
+    }
+    return o == size;
+}
+
+/** Bounds checked reader for the delta.
+ */
+struct Reader {
+    NeoSpan<const uint8_t> data;
+    size_t offset = 0;
+    bool ok = true;
+
+    const uint8_t *take(size_t n) {
+        if (!ok || offset + n > data.size()) {
+            ok = false;
+            return nullptr;
+        }
+        offset += n;
+        return data.data() + offset - n;
+    }
+
+    unsigned u8() {
+        auto p = take(1);
+        return p ? p[0] : 0;
+    }
+
+    unsigned u16() {
+        auto p = take(2);
+        return p ? p[0] | (p[1] << 8) : 0;
+    }
+
+    uint64_t u64() {
+        auto p = take(8);
+        uint64_t v = 0;
+        for (int i = 7; p && i >= 0; --i) {
+            v = (v << 8) | p[i];
+        }
+        return v;
+    }
+
+    bool string(char *out, size_t size) {
+        auto length = u8();
+        auto p = take(length);
+        if (!p || length >= size) {
+            ok = false;
+            return false;
+        }
+        memcpy(out, p, length);
+        out[length] = 0;
+        return true;
+    }
+};
+
+} // namespace
+
+NeoFontDiff diffFonts(const NeoFont &from, const NeoFont &to) {
+    auto diff = NeoFontDiff{};
+    diff.heightChanged = from.height() != to.height();
+    diff.metadataChanged = !sameMetadata(from, to);
+
+    int height = std::max(from.height(), to.height());
+    auto a = Rows{};
+    auto b = Rows{};
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &ca = from.character(i);
+        auto &cb = to.character(i);
+        if (ca.width() != cb.width()) {
+            diff.changedWidths.push_back(i);
+        }
+        canonicalRows(ca, from.height(), a);
+        canonicalRows(cb, to.height(), b);
+        uint64_t changed = 0;
+        for (int w = 0; w < height * 2; ++w) {
+            changed += __builtin_popcountll(a[w] ^ b[w]);
+        }
+        if (changed) {
+            diff.changedGlyphs.push_back(i);
+            diff.pixelsChanged += changed;
+        }
+    }
+    return diff;
+}
+
+std::vector<uint8_t> makeFontDelta(const NeoFont &from, const NeoFont &to) {
+    auto out =
+        std::vector<uint8_t>(deltaMagic, deltaMagic + sizeof deltaMagic);
+    putU64(out, neoFontHash(from));
+    putU64(out, neoFontHash(to));
+    out.push_back(static_cast<uint8_t>(to.height()));
+
+    bool metadata = !sameMetadata(from, to);
+    out.push_back(metadata ? flagMetadata : 0);
+    if (metadata) {
+        putString(out, to.appletName());
+        putString(out, to.appletInfo());
+        putString(out, to.fontName());
+        putString(out, to.version());
+        putU16(out, to.ident());
+    }
+
+    auto countOffset = out.size();
+    putU16(out, 0);
+
+    unsigned records = 0;
+    auto a = Rows{};
+    auto b = Rows{};
+    uint8_t bytes[NeoCharacter::maxHexght * NeoCharacter::rowBytes];
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &ca = from.character(i);
+        auto &cb = to.character(i);
+        canonicalRows(ca, from.height(), a);
+        canonicalRows(cb, to.height(), b);
+        bool same = ca.width() == cb.width();
+        for (int w = 0; same && w < to.height() * 2; ++w) {
+            same = a[w] == b[w];
+        }
+        if (same) {
+            continue;
+        }
+
+        // XOR of the bytes covering the wider of the two widths.
+        size_t rowBytes = (std::max(ca.width(), cb.width()) + 7) / 8;
+        size_t size = 0;
+        for (int y = 0; y < to.height(); ++y) {
+            uint64_t x[2] = {a[y * 2] ^ b[y * 2], a[y * 2 + 1] ^ b[y * 2 + 1]};
+            uint8_t row[NeoCharacter::rowBytes];
+            neoStoreRow(x, row);
+            memcpy(bytes + size, row, rowBytes);
+            size += rowBytes;
+        }
+
+        out.push_back(static_cast<uint8_t>(i));
+        out.push_back(static_cast<uint8_t>(cb.width()));
+        auto lengthOffset = out.size();
+        putU16(out, 0);
+        pack(bytes, size, out);
+        auto length = out.size() - lengthOffset - 2;
+        out[lengthOffset] = length & 0xff;
+        out[lengthOffset + 1] = (length >> 8) & 0xff;
+        ++records;
+    }
+    out[countOffset] = records & 0xff;
+    out[countOffset + 1] = (records >> 8) & 0xff;
+    return out;
+}
+
+bool applyFontDelta(NeoFont &font, NeoSpan<const uint8_t> delta) {
+    auto in = Reader{delta};
+    auto magic = in.take(sizeof deltaMagic);
+    if (!magic || memcmp(magic, deltaMagic, sizeof deltaMagic)) {
+        return false;
+    }
+    auto fromHash = in.u64();
+    auto toHash = in.u64();
+    if (!in.ok || fromHash != neoFontHash(font)) {
+        return false;
+    }
+
+    // Work on a copy so a bad delta leaves the font as it was.
+    auto result = std::make_unique<NeoFont>(font);
+    int oldHeight = font.height();
+    int height = static_cast<int>(in.u8());
+    if (height < static_cast<int>(NeoCharacter::minHeight) ||
+        height > static_cast<int>(NeoCharacter::maxHexght)) {
+        return false;
+    }
+    result->setHeight(height);
+
+    if (in.u8() & flagMetadata) {
+        char text[256];
+        if (in.string(text, sizeof text)) {
+            result->setAppletName(text);
+        }
+        if (in.string(text, sizeof text)) {
+            result->setAppletInfo(text);
+        }
+        if (in.string(text, sizeof text)) {
+            result->setFontName(text);
+        }
+        if (in.string(text, sizeof text)) {
+            result->setVersion(text);
+        }
+        result->setIdent(static_cast<int>(in.u16()));
+    }
+
+    auto records = in.u16();
+    auto rows = Rows{};
+    uint8_t bytes[NeoCharacter::maxHexght * NeoCharacter::rowBytes];
+    for (unsigned r = 0; in.ok && r < records; ++r) {
+        auto code = static_cast<int>(in.u8());
+        auto width = static_cast<int>(in.u8());
+        auto length = in.u16();
+        auto packed = in.take(length);
+        if (!packed) {
+            return false;
+        }
+
+        auto &c = result->character(code);
+        size_t rowBytes = (std::max(c.width(), width) + 7) / 8;
+        if (!width || rowBytes > NeoCharacter::rowBytes ||
+            !unpack({packed, length}, bytes, rowBytes * height)) {
+            return false;
+        }
+
+        canonicalRows(font.character(code), oldHeight, rows);
+        c.setWidth(width);
+        for (int y = 0; y < height; ++y) {
+            auto row = c.row(y);
+            neoStoreRow(&rows[y * 2], row);
+            for (size_t i = 0; i < rowBytes; ++i) {
+                row[i] ^= bytes[y * rowBytes + i];
+            }
+        }
+    }
+
+    if (!in.ok || neoFontHash(*result) != toHash) {
+        return false;
+    }
+    font = *result;
+    return true;
+}
+
+bool applyAppletDelta(NeoSpan<const uint8_t> applet,
+                      NeoSpan<const uint8_t> delta,
+                      NeoAppletBuffer &out) {
+    auto font = std::make_unique<NeoFont>();
+    if (!font->decodeApplet(applet) || !applyFontDelta(*font, delta)) {
+        return false;
+    }
+    return !out.encode(*font).empty();
+}
@@ -0,0 +1,25 @@
+/** @file       NeoFitWidths.cc
+ *  @brief      Trimming of blank columns right of the ink in every character.
+ */
+
+#include "neofontlib/NeoFitWidths.h"
+#include "neofontlib/NeoFont.h"
+
+NeoFitWidthsReport fitWidths(NeoFont &font,
+                             const NeoFitWidthsOptions &options) {
+    auto report = NeoFitWidthsReport{};
+    report.sizeBefore = font.appletSize();
+
+    for (auto &c : font) {
+        int ink = c.inkWidth();
+        int width = ink ? ink + options.rightBearing : options.blankWidth;
+        if (width <= 0 || width >= c.width()) {
+            continue;
+        }
+        report.columnsRemoved += c.width() - c.setWidth(width);
+        ++report.narrowed;
+    }
+
+    report.sizeAfter = font.appletSize();
+    return report;
+}
@@ -5,10 +5,16 @@
 
 #include "neofontlib/NeoFont.h"
 #include "neofontlib/AppletID.h"
+#include "neofontlib/NeoInstrumentation.h"
+#include "NeoParallel.h"
+#include <algorithm>
+#include <array>
 #include <cctype>
+#include <climits>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <thread>
 
 /* -------------------------------------------------------------------------------------------------------------------------------
  *
@@ -144,6 +150,48 @@ static void write32b(uint8_t *data, int offset, int value) {
     data[offset + 3] = (value >> 0) & 255;
 }
 
+/** Write the applet bitmap of one character: for each band of eight rows,
+ * one byte per column with the top row of the band in bit 0. Each band is
+ * an 8x8 bit transpose of the character rows, done eight columns at a time.
+ *
+ *  @param  c       The character.
+ *  @param  bands   Number of bands, the font height rounded up to 8 rows.
+ *  @param  out     Output, bands * c.width() bytes.
+ */
+static void packCharacter(const NeoCharacter &c, int bands, uint8_t *out) {
+    const int width = c.width();
+    const int height = c.height();
+    for (int band = 0; band < bands; ++band) {
+        const int rows = std::clamp(height - band * 8, 0, 8);
+        for (int x = 0; x < width; x += 8) {
+            // Row r of the band in byte r, pixel x + i in bit i.
+            uint64_t v = 0;
+            for (int r = 0; r < rows; ++r) {
+                v |= uint64_t{c.row(band * 8 + r)[x / 8]} << (r * 8);
+            }
+            uint64_t t = (v ^ (v >> 7)) & 0x00aa00aa00aa00aa;
+            v ^= t ^ (t << 7);
+            t = (v ^ (v >> 14)) & 0x0000cccc0000cccc;
+            v ^= t ^ (t << 14);
+            t = (v ^ (v >> 28)) & 0x00000000f0f0f0f0;
+            v ^= t ^ (t << 28);
+            // Now column x + i in byte i, the row r in bit r.
+            for (int i = 0; i < 8 && x + i < width; ++i) {
+                *out++ = static_cast<uint8_t>(v >> (i * 8));
+            }
+        }
+    }
+}
+
+/// Number of set bits in a block, for the instrumentation counters.
+[[maybe_unused]] static uint64_t countBits(const uint8_t *data, size_t size) {
+    uint64_t count = 0;
+    for (size_t i = 0; i < size; ++i) {
+        count += __builtin_popcount(data[i]);
+    }
+    return count;
+}
+
 /* -------------------------------------------------------------------------------------------------------------------------------
  *
  *      NeoFont class definition.
@@ -162,6 +210,7 @@ NeoFont::NeoFont()
     , m_versionBuild(' ')
     , m_ident(kAppletID_UserMin)
     , m_height(16)
+    , m_codePage(neoCodePageNeo)
     , m_characters() {
     setFontName("Unnamed");
     setAppletInfo("Neo Custom Font. Copyright (c) 2008 [author].");
@@ -224,6 +273,16 @@ int NeoFont::height() const {
     return m_height;
 }
 
+/** Return the code page used to map the character codes to Unicode.
+ */
+NeoCodePageId NeoFont::codePageId() const {
+    return m_codePage;
+}
+
+const NeoCodePage &NeoFont::codePage() const {
+    return neoCodePage(m_codePage);
+}
+
 const char *NeoFont::setAppletName(const char *n) {
     strncpy(m_appletName.data(), n, m_appletName.size());
     m_appletName.back() = 0;
@@ -284,9 +343,9 @@ int NeoFont::setIdent(int id) {
  * applied.
  */
 int NeoFont::setHeight(int h) {
-    if (h < NeoCharacter::minHeight)
+    if (h < static_cast<int>(NeoCharacter::minHeight))
         h = NeoCharacter::minHeight;
-    if (h > NeoCharacter::maxHexght)
+    if (h > static_cast<int>(NeoCharacter::maxHexght))
         h = NeoCharacter::maxHexght;
 
     for (unsigned int i = 0; i < charCount; i++) {
@@ -297,11 +356,23 @@ int NeoFont::setHeight(int h) {
     return m_height;
 }
 
+/** Set the code page of the font. The id is stored rather than the page, so
+ * archives of fonts using a registered page are only valid within the
+ * process that registered it.
+ *
+ * @param  id       The code page.
+ * @return          The applied code page, the default one if id is unknown.
+ */
+NeoCodePageId NeoFont::setCodePage(NeoCodePageId id) {
+    m_codePage = isNeoCodePage(id) ? id : neoCodePageNeo;
+    return m_codePage;
+}
+
 /** Clear all font data. The contents of each character are erased, and a
  * default width applied. The height is left unchanged.
  */
 void NeoFont::clear() {
-    for (unsigned int i = 0; i < sizeof charCount; i++) {
+    for (unsigned int i = 0; i < charCount; i++) {
         m_characters[i].setWidth(8);
         m_characters[i].clear();
     }
@@ -369,13 +440,18 @@ unsigned int NeoFont::appletSize() const {
  *
  *  @param  data    A pointer to the font data (the Neo file).
  *  @param  length  The number of bytes of data.
+ *  @param  options Threading of the bitmap packing.
  *  @return         The number of bytes in the file, or zero if failed.
  */
-unsigned int NeoFont::encodeApplet(uint8_t *data, unsigned int length) const {
+unsigned int NeoFont::encodeApplet(uint8_t *data,
+                                   unsigned int length,
+                                   const NeoEncodeOptions &options) const {
     if (length < appletSize()) {
         return 0; // Not enough output space
     }
 
+    NEO_PHASE(phase, NeoPhase::EncodeHeader);
+
     // Copy the prefix block (including outline header and applet loader code).
     for (unsigned int i = 0; i < sizeof file_prefix; i++) {
         data[i] = file_prefix[i];
@@ -408,22 +484,54 @@ unsigned int NeoFont::encodeApplet(uint8_t *data, unsigned int length) const {
         data[offset++] = 0;
 
     // Append the bitmap data.
+    NEO_COUNT(phase, bytes, offset);
+    NEO_NEXT_PHASE(phase, NeoPhase::EncodeBitmaps);
     unsigned int bytes_per_column = ((height() + 7) / 8);
     unsigned int bitmap_offset = offset;
+
+    // The start of each character bitmap, so that they can be written
+    // independently.
+    std::array<unsigned int, charCount + 1> starts;
+    starts[0] = 0;
     for (unsigned int i = 0; i < charCount; i++) {
-        unsigned int width = m_characters[i].width();
-        unsigned int byte_count = bytes_per_column * m_characters[i].width();
-        for (unsigned int byte = 0; byte < byte_count; byte++) {
-            unsigned int b = 0;
-            for (unsigned int bit = 0; bit < 8; bit++) {
-                int x = byte % width;
-                int y = bit + ((byte / width) * 8);
-                if (m_characters[i].getPixel(x, y))
-                    b = b | (1u << bit);
-            }
-            data[offset++] = b;
+        starts[i + 1] = starts[i] + bytes_per_column * m_characters[i].width();
+    }
+    unsigned int bitmap_size = starts[charCount];
+
+    int threads = options.threads;
+    if (threads < 1) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    if (threads <= 1 || bitmap_size < options.parallelThreshold) {
+        for (unsigned int i = 0; i < charCount; i++) {
+            packCharacter(
+                m_characters[i], bytes_per_column, data + offset + starts[i]);
         }
     }
+    else {
+        // A few chunks per thread, split by output size rather than by
+        // character count since widths vary a lot.
+        size_t chunks = std::min<size_t>(threads * 4, charCount);
+        auto chunkStart = [&](size_t k) {
+            auto target = static_cast<unsigned int>(
+                uint64_t{bitmap_size} * k / chunks);
+            return std::lower_bound(starts.begin(), starts.end() - 1, target) -
+                   starts.begin();
+        };
+        neoParallelFor(chunks, threads, [&](size_t k) {
+            for (auto i = chunkStart(k), end = chunkStart(k + 1); i < end;
+                 i++) {
+                packCharacter(m_characters[i],
+                              bytes_per_column,
+                              data + offset + starts[i]);
+            }
+        });
+    }
+    NEO_COUNT(phase, pixelsSet, countBits(data + offset, bitmap_size));
+    offset += bitmap_size;
+    NEO_COUNT(phase, glyphs, charCount);
+    NEO_COUNT(phase, bytes, offset - bitmap_offset);
+    NEO_NEXT_PHASE(phase, NeoPhase::EncodeTables);
 
     // Pad to the next word boundary.
     while ((offset % 4) != 0)
@@ -489,17 +597,104 @@ unsigned int NeoFont::encodeApplet(uint8_t *data, unsigned int length) const {
     write32b(data, 0x1a2, font_info_offset + 8 - 0x1a6);
     write32b(data, 0x1ca, font_info_offset + 12 - 0x1ce);
 
+    NEO_COUNT(phase, bytes, offset - width_table_offset);
     return offset;
 }
 
-std::vector<char> NeoFont::encodeApplet() const {
+/** Encode in to a caller provided buffer. Use appletSize() to find the
+ * required size. No memory is allocated.
+ *
+ *  @param  data    The output buffer.
+ *  @param  options Threading of the bitmap packing.
+ *  @return         The number of bytes written, or zero if the buffer is too
+ * small.
+ */
+unsigned int NeoFont::encodeApplet(NeoSpan<uint8_t> data,
+                                   const NeoEncodeOptions &options) const {
+    if (data.size() > UINT_MAX) {
+        data = data.first(UINT_MAX);
+    }
+    return encodeApplet(
+        data.data(), static_cast<unsigned int>(data.size()), options);
+}
+
+std::vector<char> NeoFont::encodeApplet(const NeoEncodeOptions &options) const {
     std::vector<char> str;
-    str.resize(appletSize());
+    {
+        NEO_PHASE(phase, NeoPhase::EncodeAlloc);
+        str.resize(appletSize());
+        NEO_COUNT(phase, allocations, 1);
+    }
 
-    encodeApplet(reinterpret_cast<uint8_t *>(str.data()), str.size());
+    encodeApplet(reinterpret_cast<uint8_t *>(str.data()), str.size(), options);
     return str;
 }
 
+/** Bring an applet encoded from this font up to date after some characters
+ * changed, by packing only those characters again. This only works while the
+ * layout stays the same, so it fails if the height, the metadata or the width
+ * of a changed character differs from the applet; encode it again instead.
+ *
+ *  @param  applet  The output of an earlier encodeApplet() of this font.
+ *  @param  changes The characters that changed since then.
+ *  @return         Logical true if the applet was patched. On failure it is
+ * left unchanged.
+ */
+bool NeoFont::patchApplet(NeoSpan<uint8_t> applet,
+                          const NeoFontChanges &changes) const {
+    if (changes.height || changes.metadata || applet.size() != appletSize()) {
+        return false;
+    }
+
+    // The font information structure and the magic word end the applet.
+    auto data = applet.data();
+    auto length = static_cast<unsigned int>(applet.size());
+    unsigned int font_info_offset = length - 20;
+    if (XB32(data, length - 4) != 0xcafefeed ||
+        XB8(data, font_info_offset + kAppletRelOffFontHeight) !=
+            static_cast<unsigned int>(m_height)) {
+        return false;
+    }
+    unsigned int width_table =
+        XB32(data, font_info_offset + kAppletRelOffWidthTable);
+    unsigned int location_table =
+        XB32(data, font_info_offset + kAppletRelOffLocationTable);
+    unsigned int bitmap_start =
+        XB32(data, font_info_offset + kAppletRelOffBitmaps);
+    if (width_table > length - charCount ||
+        location_table > length - charCount * 2 || bitmap_start > length) {
+        return false;
+    }
+
+    unsigned int bytes_per_column = (m_height + 7) / 8;
+    for (unsigned int i = 0; i < charCount; i++) {
+        if (!changes.characters[i]) {
+            continue;
+        }
+        unsigned int width = m_characters[i].width();
+        unsigned int offset = XB16(data, location_table + i * 2);
+        if (XB8(data, width_table + i) != width ||
+            offset > length - bitmap_start ||
+            width * bytes_per_column > length - bitmap_start - offset) {
+            return false;
+        }
+    }
+
+    NEO_PHASE(phase, NeoPhase::EncodeBitmaps);
+    for (unsigned int i = 0; i < charCount; i++) {
+        if (changes.characters[i]) {
+            unsigned int offset = XB16(data, location_table + i * 2);
+            packCharacter(m_characters[i],
+                          bytes_per_column,
+                          data + bitmap_start + offset);
+            NEO_COUNT(phase, glyphs, 1);
+            NEO_COUNT(
+                phase, bytes, m_characters[i].width() * bytes_per_column);
+        }
+    }
+    return true;
+}
+
 /** Method used to parse a Neo smart applet containing font data and load this
  * in to the font object.
  *
@@ -509,6 +704,13 @@ std::vector<char> NeoFont::encodeApplet() const {
  * otherwise.
  */
 bool NeoFont::decodeApplet(const uint8_t *data, unsigned int length) {
+    NEO_PHASE(phase, NeoPhase::DecodeHeader);
+
+    if (length < sizeof file_prefix + 4) {
+        // Too short to hold the header
+        return false;
+    }
+
     // Check the magic number at the start of the file.
     unsigned int magic = XB32(data, kAppletOffMagic1);
     if (magic != kMagic1) {
@@ -541,6 +743,10 @@ bool NeoFont::decodeApplet(const uint8_t *data, unsigned int length) {
 
     int pc_rel_offset = (code4 < 128) ? (code4) : (code4 - 256);
     unsigned int font_config_offset = 0x148 + 2 + pc_rel_offset + code1;
+    if (font_config_offset > length - 16) {
+        // Font info structure outside the file
+        return false;
+    }
 
     unsigned int width_table =
         XB32(data, font_config_offset + kAppletRelOffWidthTable);
@@ -548,8 +754,14 @@ bool NeoFont::decodeApplet(const uint8_t *data, unsigned int length) {
         XB32(data, font_config_offset + kAppletRelOffLocationTable);
     unsigned int bitmap_start =
         XB32(data, font_config_offset + kAppletRelOffBitmaps);
+    if (width_table > length - charCount ||
+        location_table > length - charCount * 2 || bitmap_start > length) {
+        // Tables outside the file
+        return false;
+    }
 
-    setHeight(XB8(data, font_config_offset + kAppletRelOffFontHeight));
+    unsigned int font_height =
+        XB8(data, font_config_offset + kAppletRelOffFontHeight);
 
     setAppletName((const char *)&data[kAppletOffAppletName]);
     setAppletInfo((const char *)&data[kAppletOffAppletInfo]);
@@ -569,13 +781,27 @@ bool NeoFont::decodeApplet(const uint8_t *data, unsigned int length) {
 
     m_ident = (((int)data[kAppletOffID1]) * 256) + (int)data[kAppletOffID0];
 
-    clear(); // Reset all bitmaps to empty so we only need to program 'set'
-             // pixels.
+    NEO_COUNT(phase, bytes, bitmap_start);
+    NEO_NEXT_PHASE(phase, NeoPhase::DecodeReset);
+
+    // Reset all bitmaps to empty so we only need to program 'set'
+    // pixels, in one pass over the characters.
+    batch([&](NeoFontTransaction &tx) {
+        tx.clear();
+        tx.setHeight(font_height);
+    });
+
+    NEO_NEXT_PHASE(phase, NeoPhase::DecodeBitmaps);
 
     for (unsigned int i = 0; i < charCount; i++) {
         unsigned int character_width = XB8(data, (width_table + i));
         unsigned int offset = XB16(data, (location_table + (i * 2)));
         unsigned int bits = bitmap_start + offset;
+        if (offset > length - bitmap_start ||
+            character_width * ((m_height + 7) / 8) > length - bits) {
+            // Character bitmap outside the file
+            return false;
+        }
 
         m_characters[i].setWidth(character_width);
 
@@ -585,15 +811,32 @@ bool NeoFont::decodeApplet(const uint8_t *data, unsigned int length) {
                 int bit_index = y % 8;
                 bool isSet =
                     (XB8(data, (bits + byte_index)) & (1 << bit_index)) != 0;
-                if (isSet)
+                if (isSet) {
                     m_characters[i].setPixel(x, y);
+                    NEO_COUNT(phase, pixelsSet, 1);
+                }
             }
         }
+        NEO_COUNT(phase, bytes, character_width * ((m_height + 7) / 8));
     }
+    NEO_COUNT(phase, glyphs, charCount);
 
     return true;
 }
 
+/** Decode an applet from a caller provided buffer. No memory is allocated.
+ *
+ *  @param  data    The applet file contents.
+ *  @return         Logical true if the data was parsed correctly, false
+ * otherwise.
+ */
+bool NeoFont::decodeApplet(NeoSpan<const uint8_t> data) {
+    if (data.size() > UINT_MAX) {
+        return false;
+    }
+    return decodeApplet(data.data(), static_cast<unsigned int>(data.size()));
+}
+
 /** Return the size of the archive data.
  *
  *  @return     The number of bytes in archive().
@@ -648,3 +891,138 @@ int NeoFont::maxWidth() const {
     }
     return max_width;
 }
+
+/* -------------------------------------------------------------------------------------------------------------------------------
+ *
+ *      NeoFontTransaction class definition.
+ *
+ * -------------------------------------------------------------------------------------------------------------------------------
+ */
+
+NeoFontTransaction::NeoFontTransaction(NeoFont &font)
+    : m_font(font)
+    , m_height(font.height()) {
+    m_lowest.fill(NeoCharacter::maxHexght);
+}
+
+/** Commit what was recorded, also when unwinding from an exception: the
+ * characters already returned by character() have the new height, so the
+ * others must be brought to it as well.
+ */
+NeoFontTransaction::~NeoFontTransaction() {
+    commit();
+}
+
+/** Set the height the font will have. Rows exposed by a larger height are
+ * cleared when each character is updated.
+ *
+ * @param  h        The required height, in pixels.
+ * @return          The height after limiting.
+ */
+int NeoFontTransaction::setHeight(int h) {
+    m_height = std::clamp(h,
+                          static_cast<int>(NeoCharacter::minHeight),
+                          static_cast<int>(NeoCharacter::maxHexght));
+    for (auto &lowest : m_lowest) {
+        lowest = std::min<uint8_t>(lowest, m_height);
+    }
+    return m_height;
+}
+
+/** Set the width of a character.
+ *
+ * @return          The width after limiting, or zero if index is out of
+ * range.
+ */
+int NeoFontTransaction::setWidth(int index, int w) {
+    if (index < 0 || index >= static_cast<int>(NeoFont::charCount)) {
+        return 0;
+    }
+    w = std::clamp(w,
+                   static_cast<int>(NeoCharacter::minWidth),
+                   static_cast<int>(NeoCharacter::maxWidth));
+    m_widths[index] = static_cast<uint8_t>(w);
+    m_changes.characters.set(index);
+    return w;
+}
+
+/** Erase every character and give it the default width, as NeoFont::clear().
+ * Widths set before this are dropped.
+ */
+void NeoFontTransaction::clear() {
+    m_clear.set();
+    m_widths.fill(0);
+    m_changes.characters.set();
+}
+
+void NeoFontTransaction::setAppletName(const char *n) {
+    m_font.setAppletName(n);
+    m_changes.metadata = true;
+}
+
+void NeoFontTransaction::setAppletInfo(const char *n) {
+    m_font.setAppletInfo(n);
+    m_changes.metadata = true;
+}
+
+void NeoFontTransaction::setFontName(const char *n) {
+    m_font.setFontName(n);
+    m_changes.metadata = true;
+}
+
+void NeoFontTransaction::setVersion(const char *v) {
+    m_font.setVersion(v);
+    m_changes.metadata = true;
+}
+
+void NeoFontTransaction::setIdent(int i) {
+    m_font.setIdent(i);
+    m_changes.metadata = true;
+}
+
+void NeoFontTransaction::setCodePage(NeoCodePageId id) {
+    m_font.setCodePage(id);
+    m_changes.metadata = true;
+}
+
+NeoCharacter &NeoFontTransaction::character(int index) {
+    auto &c = m_font.character(index); // Throws if out of range
+    update(index);
+    m_changes.characters.set(index);
+    return c;
+}
+
+/** Bring one character up to date with the recorded changes.
+ */
+void NeoFontTransaction::update(int index) {
+    auto &c = m_font.m_characters[index];
+    if (m_clear[index]) {
+        c.clear();
+        c.setWidth(8);
+        m_clear.reset(index);
+    }
+    if (m_widths[index]) {
+        c.setWidth(m_widths[index]);
+        m_widths[index] = 0;
+    }
+    if (m_lowest[index] < c.height()) {
+        c.setHeight(m_lowest[index]);
+    }
+    if (c.height() != m_height) {
+        c.setHeight(m_height);
+    }
+    m_lowest[index] = NeoCharacter::maxHexght;
+}
+
+NeoFontChanges NeoFontTransaction::commit() {
+    if (m_committed) {
+        return {};
+    }
+    m_committed = true;
+    for (unsigned int i = 0; i < NeoFont::charCount; i++) {
+        update(i);
+    }
+    m_changes.height = m_font.m_height != m_height;
+    m_font.m_height = m_height;
+    return m_changes;
+}
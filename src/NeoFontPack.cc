@@ -0,0 +1,361 @@
+/** @file       NeoFontPack.cc
+ *  @brief      Container file holding many encoded font applets.
+ *
+ *  Layout, all integers little endian:
+ *
+ *      header (32 bytes)
+ *          "NFPK", u32 version, u64 index offset, u32 entry count,
+ *          12 reserved bytes
+ *      applets, each starting on a 4 byte boundary
+ *      index
+ *          count records of 48 bytes, sorted by ident and name:
+ *          u64 offset, u32 size, u32 CRC-32, u16 ident, 2 reserved bytes,
+ *          24 bytes NUL padded font name
+ *          count u32 record numbers, sorted by name
+ *
+ *  Appending writes applets and a new index after the old index, then
+ *  rewrites the header. The old index is left behind as dead space.
+ */
+
+#include "neofontlib/NeoFontPack.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoFont.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char packMagic[4] = {'N', 'F', 'P', 'K'};
+constexpr uint32_t packVersion = 1;
+constexpr size_t headerSize = 32;
+constexpr size_t recordSize = 48;
+constexpr size_t nameSize = 24;
+
+constexpr std::array<uint32_t, 256> crcTable = [] {
+    auto table = std::array<uint32_t, 256>{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}();
+
+uint32_t crc32(NeoSpan<const uint8_t> data) {
+    uint32_t c = 0xffffffffu;
+    for (auto b : data) {
+        c = crcTable[(c ^ b) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+}
+
+uint64_t getLe(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+void putLe(uint8_t *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        p[i] = static_cast<uint8_t>(v >> (i * 8));
+    }
+}
+
+bool writeAll(int fd, const uint8_t *data, size_t size, uint64_t offset) {
+    while (size) {
+        auto n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool readAll(int fd, uint8_t *data, size_t size, uint64_t offset) {
+    while (size) {
+        auto n = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+/** Check a header and find the index.
+ */
+bool parseHeader(const uint8_t *header,
+                 uint64_t fileSize,
+                 uint64_t &indexOffset,
+                 uint32_t &count) {
+    if (memcmp(header, packMagic, sizeof packMagic) ||
+        getLe(header + 4, 4) != packVersion) {
+        return false;
+    }
+    indexOffset = getLe(header + 8, 8);
+    count = static_cast<uint32_t>(getLe(header + 16, 4));
+    return indexOffset >= headerSize && indexOffset <= fileSize &&
+           (fileSize - indexOffset) / (recordSize + 4) >= count;
+}
+
+int compareNames(const char *a, const char *b) {
+    return strncmp(a, b, nameSize);
+}
+
+} // namespace
+
+NeoFontPack::~NeoFontPack() {
+    close();
+}
+
+bool NeoFontPack::open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(headerSize)) {
+        ::close(fd);
+        return false;
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    auto map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    m_data = static_cast<const uint8_t *>(map);
+    m_size = size;
+
+    uint64_t indexOffset;
+    uint32_t count;
+    if (!parseHeader(m_data, m_size, indexOffset, count)) {
+        close();
+        return false;
+    }
+
+    auto index = m_data + indexOffset;
+    m_entries.resize(count);
+    m_byName.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        auto record = index + i * recordSize;
+        auto offset = getLe(record, 8);
+        auto length = getLe(record + 8, 4);
+        if (offset > m_size || length > m_size - offset) {
+            close();
+            return false;
+        }
+        auto &e = m_entries[i];
+        e.applet = {m_data + offset, static_cast<size_t>(length)};
+        e.checksum = static_cast<uint32_t>(getLe(record + 12, 4));
+        e.ident = static_cast<int>(getLe(record + 16, 2));
+        memcpy(e.name, record + 20, nameSize);
+        e.name[nameSize - 1] = 0;
+
+        m_byName[i] = static_cast<uint32_t>(
+            getLe(index + count * recordSize + i * 4, 4));
+        if (m_byName[i] >= count) {
+            close();
+            return false;
+        }
+    }
+
+    // The applets are read on demand, in no particular order.
+    ::madvise(const_cast<uint8_t *>(m_data), m_size, MADV_RANDOM);
+    return true;
+}
+
+void NeoFontPack::close() {
+    if (m_data) {
+        ::munmap(const_cast<uint8_t *>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_entries.clear();
+    m_byName.clear();
+}
+
+const NeoFontPackEntry *NeoFontPack::findIdent(int ident) const {
+    auto it = std::lower_bound(
+        m_entries.begin(), m_entries.end(), ident, [](auto &e, int i) {
+            return e.ident < i;
+        });
+    return it != m_entries.end() && it->ident == ident ? &*it : nullptr;
+}
+
+const NeoFontPackEntry *NeoFontPack::findName(const char *name) const {
+    auto it = std::lower_bound(
+        m_byName.begin(), m_byName.end(), name, [&](uint32_t i, auto n) {
+            return compareNames(m_entries[i].name, n) < 0;
+        });
+    if (it == m_byName.end() || compareNames(m_entries[*it].name, name)) {
+        return nullptr;
+    }
+    return &m_entries[*it];
+}
+
+bool NeoFontPack::verify(const NeoFontPackEntry &entry) const {
+    return crc32(entry.applet) == entry.checksum;
+}
+
+bool NeoFontPack::load(const NeoFontPackEntry &entry, NeoFont &font) const {
+    return font.decodeApplet(entry.applet);
+}
+
+NeoFontPackWriter::~NeoFontPackWriter() {
+    close();
+}
+
+bool NeoFontPackWriter::open(const char *path) {
+    close();
+    m_fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        close();
+        return false;
+    }
+
+    if (st.st_size == 0) {
+        // New pack: an empty index right after the header.
+        m_end = headerSize;
+        return commit();
+    }
+
+    uint8_t header[headerSize];
+    uint64_t indexOffset;
+    uint32_t count;
+    if (!readAll(m_fd, header, sizeof header, 0) ||
+        !parseHeader(header,
+                     static_cast<uint64_t>(st.st_size),
+                     indexOffset,
+                     count)) {
+        close();
+        return false;
+    }
+
+    auto index = std::vector<uint8_t>(count * recordSize);
+    if (!readAll(m_fd, index.data(), index.size(), indexOffset)) {
+        close();
+        return false;
+    }
+    m_records.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        auto record = index.data() + i * recordSize;
+        auto &r = m_records[i];
+        r.offset = getLe(record, 8);
+        r.size = static_cast<uint32_t>(getLe(record + 8, 4));
+        r.checksum = static_cast<uint32_t>(getLe(record + 12, 4));
+        r.ident = static_cast<int>(getLe(record + 16, 2));
+        memcpy(r.name, record + 20, nameSize);
+    }
+    m_end = (static_cast<uint64_t>(st.st_size) + 3) & ~uint64_t{3};
+    return true;
+}
+
+bool NeoFontPackWriter::add(const NeoFont &font) {
+    auto buffer = NeoAppletBuffer{};
+    auto applet = buffer.encode(font);
+    return !applet.empty() && append(applet, font);
+}
+
+bool NeoFontPackWriter::addApplet(NeoSpan<const uint8_t> applet) {
+    auto font = std::make_unique<NeoFont>();
+    return font->decodeApplet(applet) && append(applet, *font);
+}
+
+bool NeoFontPackWriter::append(NeoSpan<const uint8_t> applet,
+                               const NeoFont &font) {
+    if (m_fd < 0 || !writeAll(m_fd, applet.data(), applet.size(), m_end)) {
+        return false;
+    }
+    auto r = Record{};
+    r.offset = m_end;
+    r.size = static_cast<uint32_t>(applet.size());
+    r.checksum = crc32(applet);
+    r.ident = font.ident();
+    strncpy(r.name, font.fontName(), nameSize - 1);
+    m_records.push_back(r);
+    m_end = (m_end + applet.size() + 3) & ~uint64_t{3};
+    return true;
+}
+
+bool NeoFontPackWriter::commit() {
+    if (m_fd < 0) {
+        return false;
+    }
+
+    // Stable, so fonts with the same ident and name keep their order.
+    std::stable_sort(
+        m_records.begin(), m_records.end(), [](auto &a, auto &b) {
+            if (a.ident != b.ident) {
+                return a.ident < b.ident;
+            }
+            return compareNames(a.name, b.name) < 0;
+        });
+    auto count = static_cast<uint32_t>(m_records.size());
+    auto byName = std::vector<uint32_t>(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        byName[i] = i;
+    }
+    std::stable_sort(byName.begin(), byName.end(), [&](auto a, auto b) {
+        return compareNames(m_records[a].name, m_records[b].name) < 0;
+    });
+
+    auto index = std::vector<uint8_t>(count * (recordSize + 4));
+    for (uint32_t i = 0; i < count; ++i) {
+        auto record = index.data() + i * recordSize;
+        auto &r = m_records[i];
+        putLe(record, r.offset, 8);
+        putLe(record + 8, r.size, 4);
+        putLe(record + 12, r.checksum, 4);
+        putLe(record + 16, static_cast<uint64_t>(r.ident), 2);
+        memcpy(record + 20, r.name, nameSize);
+        putLe(index.data() + count * recordSize + i * 4, byName[i], 4);
+    }
+
+    uint8_t header[headerSize] = {};
+    memcpy(header, packMagic, sizeof packMagic);
+    putLe(header + 4, packVersion, 4);
+    putLe(header + 8, m_end, 8);
+    putLe(header + 16, count, 4);
+
+    // The index must be on disk before the header points at it.
+    if (!writeAll(m_fd, index.data(), index.size(), m_end) ||
+        ::fdatasync(m_fd) != 0 ||
+        !writeAll(m_fd, header, sizeof header, 0) || ::fdatasync(m_fd) != 0) {
+        return false;
+    }
+
+    // Later appends go after this index, so it stays valid until the next
+    // header write.
+    m_end = (m_end + index.size() + 3) & ~uint64_t{3};
+    return true;
+}
+
+void NeoFontPackWriter::close() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_end = 0;
+    m_records.clear();
+}
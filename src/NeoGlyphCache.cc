@@ -0,0 +1,204 @@
+/** @file       NeoGlyphCache.cc
+ *  @brief      Pre-shifted glyph rows for drawing text in to a NeoBitmap.
+ */
+
+#include "neofontlib/NeoGlyphCache.h"
+#include "NeoBits.h"
+#include "neofontlib/NeoBitmap.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kAlignment = 64;
+
+} // namespace
+
+NeoGlyphCache::NeoGlyphCache(const NeoFont &font, size_t capacity)
+    : NeoMemoryConsumer("glyph_cache")
+    , m_font(font)
+    , m_capacity(capacity) {
+    m_stats.capacity = capacity;
+}
+
+/** Free the atlas. It is allocated again by the next draw that misses.
+ */
+void NeoGlyphCache::release() {
+    invalidate();
+    m_storage.reset();
+    m_atlas = nullptr;
+    setMemoryCharged(0);
+}
+
+/** Convert a character to rows for one phase and store them in the atlas.
+ *
+ *  @return         Logical false if the rows do not fit in an empty atlas.
+ */
+bool NeoGlyphCache::build(int code, int phase, Entry &entry) {
+    auto &c = m_font.character(code);
+    int width = c.width();
+    int sourceBytes = (width + 7) / 8;
+    auto lastMask = neoLastByteMask(width);
+    auto ink = [&](int y) {
+        auto row = c.row(y);
+        for (int b = 0; b + 1 < sourceBytes; ++b) {
+            if (row[b]) {
+                return true;
+            }
+        }
+        return (row[sourceBytes - 1] & lastMask) != 0;
+    };
+
+    int top = 0;
+    int bottom = c.height();
+    while (top < bottom && !ink(top)) {
+        ++top;
+    }
+    while (bottom > top && !ink(bottom - 1)) {
+        --bottom;
+    }
+
+    int bytes = (width + phase + 7) / 8;
+    size_t size = static_cast<size_t>(bottom - top) * bytes;
+    // Keep every entry on its own cache lines.
+    size_t padded = (size + kAlignment - 1) / kAlignment * kAlignment;
+    if (padded > m_capacity) {
+        return false;
+    }
+    if (!m_atlas) {
+        m_storage.reset(new uint8_t[m_capacity + kAlignment]);
+        auto address = reinterpret_cast<uintptr_t>(m_storage.get());
+        m_atlas = m_storage.get() + (kAlignment - address % kAlignment);
+        setMemoryCharged(m_capacity + kAlignment);
+    }
+    if (m_used + padded > m_capacity) {
+        for (auto &e : m_table) {
+            e.valid = false;
+        }
+        m_stats.evictions += m_entries;
+        m_entries = 0;
+        m_used = 0;
+    }
+
+    auto out = m_atlas + m_used;
+    memset(out, 0, size);
+    for (int y = top; y < bottom; ++y) {
+        auto row = c.row(y);
+        for (int b = 0; b < sourceBytes; ++b) {
+            auto v = row[b];
+            if (b + 1 == sourceBytes) {
+                v &= lastMask;
+            }
+            unsigned int bits = neoReversedBits[v];
+            out[b] |= static_cast<uint8_t>(bits >> phase);
+            if (phase) {
+                out[b + 1] |= static_cast<uint8_t>(bits << (8 - phase));
+            }
+        }
+        out += bytes;
+    }
+
+    entry.offset = static_cast<uint32_t>(m_used);
+    entry.top = static_cast<uint8_t>(top);
+    entry.rows = static_cast<uint8_t>(bottom - top);
+    entry.bytes = static_cast<uint8_t>(bytes);
+    entry.valid = true;
+    m_used += padded;
+    ++m_entries;
+    return true;
+}
+
+void NeoGlyphCache::draw(NeoBitmap &target, int code, int x, int y) {
+    if (releaseRequested()) {
+        ++m_stats.releases;
+        release();
+    }
+    int phase = x & (phases - 1);
+    auto &entry = m_table.at(static_cast<size_t>(code) * phases + phase);
+    if (entry.valid) {
+        ++m_stats.hits;
+    }
+    else {
+        ++m_stats.misses;
+        if (!build(code, phase, entry)) {
+            target.drawCharacter(m_font.character(code), x, y);
+            return;
+        }
+    }
+
+    int byteX = (x - phase) / 8;
+    int stride = static_cast<int>(target.stride());
+    int b0 = std::max(0, -byteX);
+    int b1 = std::min(static_cast<int>(entry.bytes), stride - byteX);
+    int r0 = std::max(0, -(y + entry.top));
+    int r1 = std::min(static_cast<int>(entry.rows),
+                      target.height() - (y + entry.top));
+    if (b0 >= b1 || r0 >= r1) {
+        return;
+    }
+
+    bool edge = byteX + b1 == stride && target.width() % 8;
+    auto mask = target.paddingMask();
+    auto src = m_atlas + entry.offset + static_cast<size_t>(r0) * entry.bytes;
+    auto dst = target.row(y + entry.top + r0) + byteX;
+    for (int r = r0; r < r1; ++r, src += entry.bytes, dst += stride) {
+        for (int b = b0; b < b1; ++b) {
+            dst[b] |= src[b];
+        }
+        // Keep the padding bits past the right hand edge clear.
+        if (edge) {
+            dst[b1 - 1] &= mask;
+        }
+    }
+}
+
+/** Drop every entry, for example after the font height changed.
+ */
+void NeoGlyphCache::invalidate() {
+    for (auto &e : m_table) {
+        e.valid = false;
+    }
+    m_entries = 0;
+    m_used = 0;
+}
+
+/** Rebuild a character the next time it is drawn. Its old rows stay in the
+ * atlas until it is next emptied.
+ */
+void NeoGlyphCache::invalidate(int code) {
+    if (code < 0 || code >= static_cast<int>(NeoFont::charCount)) {
+        return;
+    }
+    for (int phase = 0; phase < phases; ++phase) {
+        auto &e = m_table[code * phases + phase];
+        if (e.valid) {
+            e.valid = false;
+            --m_entries;
+        }
+    }
+}
+
+void NeoGlyphCache::invalidate(const NeoFontChanges &changes) {
+    if (changes.height) {
+        invalidate();
+        return;
+    }
+    for (size_t i = 0; i < NeoFont::charCount; ++i) {
+        if (changes.characters[i]) {
+            invalidate(static_cast<int>(i));
+        }
+    }
+}
+
+NeoGlyphCacheStats NeoGlyphCache::stats() const {
+    auto stats = m_stats;
+    stats.bytesUsed = m_used;
+    return stats;
+}
+
+void NeoGlyphCache::resetStats() {
+    m_stats.hits = 0;
+    m_stats.misses = 0;
+    m_stats.evictions = 0;
+    m_stats.releases = 0;
+}
@@ -0,0 +1,155 @@
+/** @file       NeoGlyphCodec.cc
+ *  @brief      Compact storage of character bitmaps.
+ */
+
+#include "neofontlib/NeoGlyphCodec.h"
+#include "NeoBits.h"
+#include "neofontlib/NeoFont.h"
+#include <cstring>
+
+static_assert(NeoCharacter::maxHexght == 66 && NeoCharacter::rowBytes == 16,
+              "neoGlyphMaxEncodedSize assumes the character limits");
+
+size_t encodeGlyph(const NeoCharacter &c, uint8_t *out) {
+    int width = c.width();
+    int height = c.height();
+    int bytes = (width + 7) / 8;
+    auto lastMask = neoLastByteMask(width);
+
+    auto p = out;
+    *p++ = static_cast<uint8_t>(width - 1);
+    *p++ = static_cast<uint8_t>(height - 1);
+    auto rowMask = p;
+    memset(rowMask, 0, (height + 7) / 8);
+    p += (height + 7) / 8;
+
+    uint8_t previous[NeoCharacter::rowBytes] = {};
+    for (int y = 0; y < height; ++y) {
+        uint8_t row[NeoCharacter::rowBytes];
+        memcpy(row, c.row(y), bytes);
+        row[bytes - 1] &= lastMask;
+
+        uint8_t delta[NeoCharacter::rowBytes];
+        bool any = false;
+        for (int b = 0; b < bytes; ++b) {
+            delta[b] = row[b] ^ previous[b];
+            any |= delta[b] != 0;
+        }
+        memcpy(previous, row, bytes);
+        if (!any) {
+            continue;
+        }
+
+        rowMask[y / 8] |= static_cast<uint8_t>(1 << (y % 8));
+        if (bytes == 1) {
+            *p++ = delta[0];
+            continue;
+        }
+        auto byteMask = p;
+        memset(byteMask, 0, (bytes + 7) / 8);
+        p += (bytes + 7) / 8;
+        for (int b = 0; b < bytes; ++b) {
+            if (delta[b]) {
+                byteMask[b / 8] |= static_cast<uint8_t>(1 << (b % 8));
+                *p++ = delta[b];
+            }
+        }
+    }
+    return static_cast<size_t>(p - out);
+}
+
+size_t decodeGlyph(NeoSpan<const uint8_t> data, NeoCharacter &c) {
+    if (data.size() < 2) {
+        return 0;
+    }
+    int width = data[0] + 1;
+    int height = data[1] + 1;
+    if (width > static_cast<int>(NeoCharacter::maxWidth) ||
+        height > static_cast<int>(NeoCharacter::maxHexght)) {
+        return 0;
+    }
+    int bytes = (width + 7) / 8;
+    size_t maskBytes = (bytes + 7) / 8;
+
+    // Sizes are checked against what is left before p moves, so it never
+    // points past the end.
+    size_t rowMaskBytes = (height + 7) / 8;
+    if (data.size() - 2 < rowMaskBytes) {
+        return 0;
+    }
+    auto rowMask = data.data() + 2;
+    auto p = rowMask + rowMaskBytes;
+    auto end = data.data() + data.size();
+
+    c.setWidth(width);
+    if (c.height() != height) {
+        c.setHeight(height);
+    }
+
+    // The row is built in two words, so storing it is two plain stores.
+    uint64_t row[2] = {};
+    for (int y = 0; y < height; ++y) {
+        if (rowMask[y / 8] & (1 << (y % 8))) {
+            if (bytes == 1) {
+                if (p == end) {
+                    return 0;
+                }
+                row[0] ^= *p++;
+            }
+            else {
+                if (static_cast<size_t>(end - p) < maskBytes) {
+                    return 0;
+                }
+                unsigned mask = p[0] | (maskBytes > 1 ? p[1] << 8 : 0);
+                p += maskBytes;
+                auto present = static_cast<size_t>(__builtin_popcount(mask));
+                if (static_cast<size_t>(end - p) < present) {
+                    return 0;
+                }
+                while (mask) {
+                    int b = __builtin_ctz(mask);
+                    mask &= mask - 1;
+                    row[b / 8] ^= uint64_t{*p++} << (b % 8 * 8);
+                }
+            }
+        }
+        neoStoreRow(row, c.row(y));
+    }
+    return static_cast<size_t>(p - data.data());
+}
+
+void encodeFontGlyphs(const NeoFont &font, std::vector<uint8_t> &out) {
+    uint8_t buffer[neoGlyphMaxEncodedSize];
+    out.push_back(static_cast<uint8_t>(font.height()));
+    for (auto &c : font) {
+        auto size = encodeGlyph(c, buffer);
+        out.insert(out.end(), buffer, buffer + size);
+    }
+}
+
+size_t decodeFontGlyphs(NeoSpan<const uint8_t> data, NeoFont &font) {
+    if (data.empty()) {
+        return 0;
+    }
+    int height = data[0];
+    if (height < static_cast<int>(NeoCharacter::minHeight) ||
+        height > static_cast<int>(NeoCharacter::maxHexght)) {
+        return 0;
+    }
+    if (font.height() != height) {
+        font.setHeight(height);
+    }
+    size_t offset = 1;
+    for (auto &c : font) {
+        // Every glyph must have the height of the font, or the applet
+        // encoder would pack it with the wrong number of rows. A rejected
+        // glyph is given the font height back.
+        auto used = decodeGlyph(data.subspan(offset), c);
+        if (!used || c.height() != height) {
+            c.setHeight(height);
+            return 0;
+        }
+        offset += used;
+    }
+    return offset;
+}
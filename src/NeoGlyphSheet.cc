@@ -0,0 +1,134 @@
+/** @file       NeoGlyphSheet.cc
+ *  @brief      Conversion between fonts and grid images of their glyphs.
+ */
+
+#include "neofontlib/NeoGlyphSheet.h"
+#include "neofontlib/NeoCharacterEncoding.h"
+#include "neofontlib/NeoFont.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+/** 3x5 pixel hex digits used for the cell labels, one byte per row with the
+ * leftmost pixel in bit 2.
+ */
+constexpr uint8_t labelDigits[16][5] = {
+    {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 3, 1, 7},
+    {5, 5, 7, 1, 1}, {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 2, 2, 2},
+    {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7}, {2, 5, 7, 5, 5}, {6, 5, 6, 5, 6},
+    {3, 4, 4, 4, 3}, {6, 5, 5, 5, 6}, {7, 4, 6, 4, 7}, {7, 4, 6, 4, 4},
+};
+
+constexpr int labelDigitWidth = 3;
+constexpr int labelHeight = 5;
+constexpr int labelWidth = labelDigitWidth * 2 + 1;
+
+void drawDigit(NeoBitmap &image, int digit, int x, int y) {
+    for (int row = 0; row < labelHeight; ++row) {
+        for (int col = 0; col < labelDigitWidth; ++col) {
+            if (labelDigits[digit][row] & (4 >> col)) {
+                image.setPixel(x + col, y + row);
+            }
+        }
+    }
+}
+
+/** Draw a string with the font itself.
+ */
+void drawText(NeoBitmap &image, const NeoFont &font, const char *text, int x) {
+    for (auto p = text; *p; ++p) {
+        int code = font.codePage().fromUTF16(static_cast<unsigned char>(*p));
+        if (code < 0) {
+            code = '?';
+        }
+        auto &c = font.character(code);
+        image.drawCharacter(c, x, 1);
+        x += c.width();
+    }
+}
+
+} // namespace
+
+bool importGlyphSheet(const NeoBitmap &sheet,
+                      NeoFont &font,
+                      const NeoGlyphSheetOptions &options) {
+    if (options.columns <= 0 || options.rows <= 0) {
+        return false;
+    }
+    int cellWidth =
+        options.cellWidth ? options.cellWidth : sheet.width() / options.columns;
+    int cellHeight =
+        options.cellHeight ? options.cellHeight : sheet.height() / options.rows;
+    if (cellWidth <= 0 || cellHeight <= 0) {
+        return false;
+    }
+
+    int height = font.setHeight(cellHeight);
+    int blankWidth = options.blankWidth ? options.blankWidth : cellWidth / 2;
+    for (int cy = 0; cy < options.rows; ++cy) {
+        for (int cx = 0; cx < options.columns; ++cx) {
+            int code = options.firstCode + cy * options.columns + cx;
+            if (code < 0 || code >= static_cast<int>(NeoFont::charCount)) {
+                continue;
+            }
+            auto &c = font.character(code);
+            c.setWidth(cellWidth);
+            sheet.extractCharacter(
+                cx * cellWidth, cy * cellHeight, cellWidth, height, c);
+
+            int ink = c.inkWidth();
+            c.setWidth(ink ? ink + options.rightBearing : blankWidth);
+        }
+    }
+    return true;
+}
+
+NeoBitmap renderSpecimen(const NeoFont &font,
+                         const NeoSpecimenOptions &options) {
+    int columns = std::max(options.columns, 1);
+    int rows = (static_cast<int>(NeoFont::charCount) + columns - 1) / columns;
+
+    int widest = 1;
+    for (auto &c : font) {
+        widest = std::max(widest, c.width());
+    }
+
+    // Cell: label, gap, glyph, gap, advance line, with a grid line on the left
+    // and top.
+    int cellWidth = 1 + 1 + std::max(widest, labelWidth) + 1;
+    int cellHeight = 1 + 1 + labelHeight + 1 + font.height() + 1 + 1 + 1;
+    int top = options.title ? font.height() + 2 : 0;
+
+    auto image = NeoBitmap{columns * cellWidth + 1, top + rows * cellHeight + 1};
+
+    if (options.title) {
+        char title[64];
+        snprintf(title,
+                 sizeof title,
+                 "%s %s",
+                 font.fontName(),
+                 font.version());
+        drawText(image, font, title, 1);
+    }
+
+    for (int i = 0; i < columns + 1; ++i) {
+        image.fillRect(i * cellWidth, top, 1, rows * cellHeight + 1);
+    }
+    for (int i = 0; i < rows + 1; ++i) {
+        image.fillRect(0, top + i * cellHeight, columns * cellWidth + 1, 1);
+    }
+
+    for (int code = 0; code < static_cast<int>(NeoFont::charCount); ++code) {
+        int x = (code % columns) * cellWidth + 2;
+        int y = top + (code / columns) * cellHeight + 2;
+        drawDigit(image, code >> 4, x, y);
+        drawDigit(image, code & 15, x + labelDigitWidth + 1, y);
+
+        auto &c = font.character(code);
+        y += labelHeight + 1;
+        image.drawCharacter(c, x, y);
+        image.fillRect(x, y + font.height() + 1, c.width(), 1);
+    }
+    return image;
+}
@@ -0,0 +1,131 @@
+/** @file       NeoHash.cc
+ *  @brief      Content fingerprints of fonts.
+ */
+
+#include "neofontlib/NeoHash.h"
+#include "NeoBits.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/// Bump when the hashed content changes, so old fingerprints stop matching.
+constexpr uint64_t hashVersion = 1;
+
+uint64_t mixWord(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdull;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ull;
+    v ^= v >> 33;
+    return v;
+}
+
+void mix(uint64_t &hash, uint64_t v) {
+    hash = (hash ^ mixWord(v)) * 0x100000001b3ull;
+    hash = (hash << 27) | (hash >> 37);
+}
+
+void mixString(uint64_t &hash, const char *s) {
+    auto length = strlen(s);
+    mix(hash, length);
+    for (size_t i = 0; i < length; i += 8) {
+        uint64_t v = 0;
+        for (size_t j = i; j < i + 8 && j < length; ++j) {
+            v |= uint64_t{static_cast<uint8_t>(s[j])} << ((j - i) * 8);
+        }
+        mix(hash, v);
+    }
+}
+
+uint64_t combine(const NeoFont &font, const uint64_t *characterHashes) {
+    uint64_t hash = hashVersion;
+    mix(hash, neoMetadataHash(font));
+    mix(hash, font.height());
+    for (size_t i = 0; i < NeoFont::charCount; ++i) {
+        mix(hash, characterHashes[i]);
+    }
+    return hash;
+}
+
+} // namespace
+
+uint64_t neoCharacterHash(const NeoCharacter &c, int height) {
+    uint64_t hash = 0;
+    int width = c.width();
+    mix(hash, width);
+    int words = width > 64 ? 2 : 1;
+    uint64_t row[2];
+    for (int y = 0; y < height; ++y) {
+        neoLoadRow(c.row(y), width, row);
+        for (int w = 0; w < words; ++w) {
+            mix(hash, row[w]);
+        }
+    }
+    return hash;
+}
+
+uint64_t neoMetadataHash(const NeoFont &font) {
+    uint64_t hash = 0;
+    mixString(hash, font.appletName());
+    mixString(hash, font.appletInfo());
+    mixString(hash, font.fontName());
+    mixString(hash, font.version());
+    mix(hash, font.ident());
+    return hash;
+}
+
+uint64_t neoFontHash(const NeoFont &font) {
+    uint64_t hashes[NeoFont::charCount];
+    for (size_t i = 0; i < NeoFont::charCount; ++i) {
+        hashes[i] = neoCharacterHash(font.character(i), font.height());
+    }
+    return combine(font, hashes);
+}
+
+uint64_t neoDataHash(NeoSpan<const uint8_t> data, uint64_t seed) {
+    uint64_t hash = hashVersion;
+    mix(hash, seed);
+    mix(hash, data.size());
+    // Little endian words, so the hash does not depend on the host.
+    for (size_t i = 0; i < data.size(); i += 8) {
+        uint64_t v = 0;
+        for (size_t j = std::min(i + 8, data.size()); j-- > i;) {
+            v = (v << 8) | data[j];
+        }
+        mix(hash, v);
+    }
+    return hash;
+}
+
+uint64_t NeoFontHasher::fingerprint(const NeoFont &font) {
+    if (font.height() != m_height) {
+        m_height = font.height();
+        m_valid.reset();
+    }
+    if (!m_valid.all()) {
+        for (size_t i = 0; i < NeoFont::charCount; ++i) {
+            if (!m_valid[i]) {
+                m_hashes[i] = neoCharacterHash(font.character(i), m_height);
+                m_valid[i] = true;
+                ++m_hashed;
+            }
+        }
+    }
+    return combine(font, m_hashes.data());
+}
+
+void NeoFontHasher::invalidate(int code) {
+    if (code >= 0 && code < static_cast<int>(NeoFont::charCount)) {
+        m_valid[code] = false;
+    }
+}
+
+/// Drop the characters changed by a NeoFontTransaction.
+void NeoFontHasher::invalidate(const NeoFontChanges &changes) {
+    m_valid &= ~changes.characters;
+}
+
+void NeoFontHasher::invalidateAll() {
+    m_valid.reset();
+}
@@ -0,0 +1,44 @@
+/** @file       NeoImport.cc
+ *  @brief      Reading fonts in any of the supported source formats.
+ */
+
+#include "neofontlib/NeoImport.h"
+#include "neofontlib/NeoBdf.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoPsf.h"
+
+NeoFontFormat detectFontFormat(NeoSpan<const uint8_t> data) {
+    if (isBdfData(data)) {
+        return NeoFontFormat::Bdf;
+    }
+    if (isPsfData(data)) {
+        return NeoFontFormat::Psf;
+    }
+    return NeoFontFormat::Applet;
+}
+
+const char *fontFormatName(NeoFontFormat format) {
+    switch (format) {
+    case NeoFontFormat::Applet:
+        return "font applet";
+    case NeoFontFormat::Psf:
+        return "PSF font";
+    case NeoFontFormat::Bdf:
+        return "BDF font";
+    }
+    return "font";
+}
+
+bool importFont(NeoSpan<const uint8_t> data,
+                NeoFontFormat format,
+                NeoFont &font) {
+    switch (format) {
+    case NeoFontFormat::Applet:
+        return font.decodeApplet(data);
+    case NeoFontFormat::Psf:
+        return importPsf(data, font);
+    case NeoFontFormat::Bdf:
+        return importBdf(data, font);
+    }
+    return false;
+}
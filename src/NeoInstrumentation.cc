@@ -0,0 +1,175 @@
+/** @file       NeoInstrumentation.cc
+ *  @brief      Instrumentation sinks.
+ */
+
+#include "neofontlib/NeoInstrumentation.h"
+#include <atomic>
+#include <cinttypes>
+#include <utility>
+
+namespace {
+
+std::atomic<NeoInstrumentSink *> currentSink{nullptr};
+
+/** Index of the log2 histogram bucket for a duration.
+ */
+size_t bucketIndex(uint64_t ns) {
+    size_t index = 0;
+    while (ns > 1 && index + 1 < NeoHistogramSink::bucketCount) {
+        ns >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+/** Small sequential id of the calling thread, so that trace viewers show the
+ * phases run on each worker on a separate track.
+ */
+unsigned traceThreadId() {
+    static std::atomic<unsigned> next{1};
+    thread_local unsigned id = next++;
+    return id;
+}
+
+} // namespace
+
+const char *neoPhaseName(NeoPhase phase) {
+    switch (phase) {
+    case NeoPhase::DecodeHeader:
+        return "decode.header";
+    case NeoPhase::DecodeReset:
+        return "decode.reset";
+    case NeoPhase::DecodeBitmaps:
+        return "decode.bitmaps";
+    case NeoPhase::EncodeAlloc:
+        return "encode.alloc";
+    case NeoPhase::EncodeHeader:
+        return "encode.header";
+    case NeoPhase::EncodeBitmaps:
+        return "encode.bitmaps";
+    case NeoPhase::EncodeTables:
+        return "encode.tables";
+    case NeoPhase::Count:
+        break;
+    }
+    return "unknown";
+}
+
+void setNeoInstrumentSink(NeoInstrumentSink *sink) {
+    currentSink.store(sink, std::memory_order_release);
+}
+
+NeoInstrumentSink *neoInstrumentSink() {
+    return currentSink.load(std::memory_order_acquire);
+}
+
+NeoCallbackSink::NeoCallbackSink(Callback callback)
+    : m_callback(std::move(callback)) {}
+
+void NeoCallbackSink::record(const NeoPhaseEvent &event) {
+    if (m_callback) {
+        m_callback(event);
+    }
+}
+
+void NeoHistogramSink::record(const NeoPhaseEvent &event) {
+    auto index = static_cast<size_t>(event.phase);
+    if (index >= neoPhaseCount) {
+        return;
+    }
+
+    auto lock = std::lock_guard{m_mutex};
+    auto &s = m_stats[index];
+    ++s.calls;
+    s.totalNs += event.durationNs;
+    if (event.durationNs > s.maxNs) {
+        s.maxNs = event.durationNs;
+    }
+    s.counters.bytes += event.counters.bytes;
+    s.counters.glyphs += event.counters.glyphs;
+    s.counters.pixelsSet += event.counters.pixelsSet;
+    s.counters.allocations += event.counters.allocations;
+    ++s.buckets[bucketIndex(event.durationNs)];
+}
+
+NeoHistogramSink::PhaseStats NeoHistogramSink::stats(NeoPhase phase) const {
+    auto lock = std::lock_guard{m_mutex};
+    return m_stats.at(static_cast<size_t>(phase));
+}
+
+void NeoHistogramSink::reset() {
+    auto lock = std::lock_guard{m_mutex};
+    m_stats = {};
+}
+
+void NeoHistogramSink::print(FILE *out) const {
+    auto lock = std::lock_guard{m_mutex};
+    fprintf(out,
+            "%-16s %10s %12s %10s %10s %10s %8s %8s\n",
+            "phase",
+            "calls",
+            "total_us",
+            "max_us",
+            "bytes",
+            "glyphs",
+            "pixels",
+            "allocs");
+    for (size_t i = 0; i < neoPhaseCount; ++i) {
+        auto &s = m_stats[i];
+        if (!s.calls) {
+            continue;
+        }
+        fprintf(out,
+                "%-16s %10" PRIu64 " %12.1f %10.1f %10" PRIu64 " %10" PRIu64
+                " %8" PRIu64 " %8" PRIu64 "\n",
+                neoPhaseName(static_cast<NeoPhase>(i)),
+                s.calls,
+                s.totalNs / 1000.,
+                s.maxNs / 1000.,
+                s.counters.bytes,
+                s.counters.glyphs,
+                s.counters.pixelsSet,
+                s.counters.allocations);
+    }
+}
+
+NeoTraceEventSink::NeoTraceEventSink(const char *path)
+    : m_file(fopen(path, "w")) {
+    if (m_file) {
+        fputs("{\"traceEvents\":[\n", m_file);
+    }
+}
+
+NeoTraceEventSink::~NeoTraceEventSink() {
+    if (m_file) {
+        fputs("\n]}\n", m_file);
+        fclose(m_file);
+    }
+}
+
+bool NeoTraceEventSink::isOpen() const {
+    return m_file != nullptr;
+}
+
+void NeoTraceEventSink::record(const NeoPhaseEvent &event) {
+    auto lock = std::lock_guard{m_mutex};
+    if (!m_file) {
+        return;
+    }
+    // Complete ("X") events use microsecond time stamps.
+    fprintf(m_file,
+            "%s{\"name\":\"%s\",\"cat\":\"neofont\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytes\":%" PRIu64
+            ",\"glyphs\":%" PRIu64 ",\"pixels\":%" PRIu64
+            ",\"allocations\":%" PRIu64 "}}",
+            m_first ? "" : ",\n",
+            neoPhaseName(event.phase),
+            traceThreadId(),
+            event.startNs / 1000.,
+            event.durationNs / 1000.,
+            event.counters.bytes,
+            event.counters.glyphs,
+            event.counters.pixelsSet,
+            event.counters.allocations);
+    m_first = false;
+}
@@ -0,0 +1,173 @@
+/** @file       NeoMemory.cc
+ *  @brief      Memory accounting for fonts and caches.
+ */
+
+#include "neofontlib/NeoMemory.h"
+#include "neofontlib/NeoFont.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<NeoMemoryConsumer *> consumers;
+    std::atomic<size_t> total{0};
+    std::atomic<size_t> cap{0};
+    std::atomic<uint64_t> releaseRequests{0};
+};
+
+Registry &registry() {
+    static Registry r;
+    return r;
+}
+
+} // namespace
+
+NeoFontFootprint &NeoFontFootprint::operator+=(const NeoFontFootprint &other) {
+    allocated += other.allocated;
+    pixels += other.pixels;
+    applet += other.applet;
+    return *this;
+}
+
+NeoFontFootprint neoFontFootprint(const NeoFont &font) {
+    auto footprint = NeoFontFootprint{};
+    footprint.allocated = sizeof font;
+    for (auto &c : font) {
+        footprint.pixels += (c.width() * font.height() + 7) / 8;
+    }
+    footprint.applet = font.appletSize();
+    return footprint;
+}
+
+NeoMemoryConsumer::NeoMemoryConsumer(const char *name)
+    : m_name(name) {
+    auto &r = registry();
+    auto lock = std::lock_guard{r.mutex};
+    r.consumers.push_back(this);
+}
+
+NeoMemoryConsumer::~NeoMemoryConsumer() {
+    auto &r = registry();
+    r.total -= m_charged.load();
+    auto lock = std::lock_guard{r.mutex};
+    r.consumers.erase(
+        std::find(r.consumers.begin(), r.consumers.end(), this));
+}
+
+void NeoMemoryConsumer::setMemoryCharged(size_t bytes) {
+    auto &r = registry();
+    auto old = m_charged.exchange(bytes, std::memory_order_relaxed);
+    auto total = r.total += bytes - old; // Wraps correctly when shrinking
+    auto cap = r.cap.load(std::memory_order_relaxed);
+    if (cap && bytes > old && total > cap) {
+        requestReleases(this);
+    }
+}
+
+/** Mark the largest consumers until what is left fits in the cap. The one
+ * given as spared is marked last, since it is in use and would soon allocate
+ * again. Memory is only freed when each consumer next runs, so the total can
+ * stay over the cap for a while.
+ */
+void NeoMemoryConsumer::requestReleases(const NeoMemoryConsumer *spared) {
+    auto &r = registry();
+    auto cap = r.cap.load();
+    auto lock = std::lock_guard{r.mutex};
+    auto total = r.total.load();
+    if (!cap || total <= cap) {
+        return;
+    }
+
+    // The sizes are copied before sorting, since consumers change them
+    // without holding the lock.
+    auto order = std::vector<std::pair<NeoMemoryConsumer *, size_t>>{};
+    order.reserve(r.consumers.size());
+    for (auto consumer : r.consumers) {
+        order.emplace_back(consumer, consumer->memoryCharged());
+    }
+    std::sort(order.begin(), order.end(), [&](auto &a, auto &b) {
+        if ((a.first == spared) != (b.first == spared)) {
+            return b.first == spared;
+        }
+        return a.second > b.second;
+    });
+    for (auto [consumer, bytes] : order) {
+        if (total <= cap) {
+            break;
+        }
+        if (!bytes) {
+            continue;
+        }
+        if (!consumer->m_release.exchange(true)) {
+            ++r.releaseRequests;
+        }
+        total -= std::min(total, bytes);
+    }
+}
+
+void enforceNeoMemoryCap() {
+    NeoMemoryConsumer::requestReleases(nullptr);
+}
+
+void setNeoMemoryCap(size_t bytes) {
+    registry().cap = bytes;
+    enforceNeoMemoryCap();
+}
+
+size_t neoMemoryCap() {
+    return registry().cap;
+}
+
+NeoMemoryUsage neoMemoryUsage() {
+    auto &r = registry();
+    auto usage = NeoMemoryUsage{};
+    auto lock = std::lock_guard{r.mutex};
+    for (auto consumer : r.consumers) {
+        auto name = consumer->memoryName();
+        auto group = std::find_if(
+            usage.groups.begin(), usage.groups.end(), [&](auto &g) {
+                return strcmp(g.name, name) == 0;
+            });
+        if (group == usage.groups.end()) {
+            group = usage.groups.insert(group, {name, 0, 0});
+        }
+        ++group->consumers;
+        group->bytes += consumer->memoryCharged();
+    }
+    usage.total = r.total;
+    usage.cap = r.cap;
+    usage.releaseRequests = r.releaseRequests;
+    return usage;
+}
+
+void NeoMemoryUsage::print(FILE *out) const {
+    fputs("# TYPE neofont_memory_bytes gauge\n", out);
+    for (auto &g : groups) {
+        fprintf(out,
+                "neofont_memory_bytes{consumer=\"%s\"} %zu\n",
+                g.name,
+                g.bytes);
+    }
+    fputs("# TYPE neofont_memory_consumers gauge\n", out);
+    for (auto &g : groups) {
+        fprintf(out,
+                "neofont_memory_consumers{consumer=\"%s\"} %zu\n",
+                g.name,
+                g.consumers);
+    }
+    fprintf(out,
+            "# TYPE neofont_memory_total_bytes gauge\n"
+            "neofont_memory_total_bytes %zu\n"
+            "# TYPE neofont_memory_cap_bytes gauge\n"
+            "neofont_memory_cap_bytes %zu\n"
+            "# TYPE neofont_memory_release_requests_total counter\n"
+            "neofont_memory_release_requests_total %" PRIu64 "\n",
+            total,
+            cap,
+            releaseRequests);
+}
@@ -0,0 +1,170 @@
+/** @file       NeoNetpbm.cc
+ *  @brief      Reading and writing of Netpbm (PBM/PGM) images.
+ */
+
+#include "neofontlib/NeoNetpbm.h"
+#include "neofontlib/NeoBitmap.h"
+#include <cctype>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace {
+
+/** Read the next unsigned header value, skipping white space and comments.
+ */
+bool readHeaderValue(std::istream &in, int &value) {
+    int c = in.get();
+    while (c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') {
+                c = in.get();
+            }
+        }
+        else if (isspace(c)) {
+            c = in.get();
+        }
+        else {
+            break;
+        }
+    }
+    if (c == EOF || !isdigit(c)) {
+        return false;
+    }
+    value = 0;
+    while (c != EOF && isdigit(c)) {
+        value = value * 10 + (c - '0');
+        if (value > (1 << 24)) {
+            return false;
+        }
+        c = in.get();
+    }
+    // The single white space character ending the header is consumed here.
+    return true;
+}
+
+bool readPlainPbm(std::istream &in, NeoBitmap &image) {
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            int c;
+            do {
+                c = in.get();
+            } while (c != EOF && c != '0' && c != '1');
+            if (c == EOF) {
+                return false;
+            }
+            if (c == '1') {
+                image.setPixel(x, y);
+            }
+        }
+    }
+    return true;
+}
+
+bool readRawPbm(std::istream &in, NeoBitmap &image) {
+    auto stride = static_cast<std::streamsize>(image.stride());
+    for (int y = 0; y < image.height(); ++y) {
+        auto row = image.row(y);
+        if (!in.read(reinterpret_cast<char *>(row), stride)) {
+            return false;
+        }
+        if (image.width() % 8) {
+            row[stride - 1] &= image.paddingMask();
+        }
+    }
+    return true;
+}
+
+/** Read a gray image a row at a time and threshold it.
+ */
+bool readPgm(std::istream &in,
+             NeoBitmap &image,
+             bool raw,
+             int maxval,
+             int threshold) {
+    // Compare value * 255 < threshold * maxval, to avoid a division.
+    long limit = static_cast<long>(threshold) * maxval;
+    auto wide = maxval > 255;
+    auto line = std::vector<uint8_t>(
+        raw ? static_cast<size_t>(image.width()) * (wide ? 2 : 1) : 0);
+
+    for (int y = 0; y < image.height(); ++y) {
+        if (raw &&
+            !in.read(reinterpret_cast<char *>(line.data()),
+                     static_cast<std::streamsize>(line.size()))) {
+            return false;
+        }
+        auto row = image.row(y);
+        for (int x = 0; x < image.width(); ++x) {
+            int value = 0;
+            if (!raw) {
+                if (!readHeaderValue(in, value)) {
+                    return false;
+                }
+            }
+            else if (wide) {
+                value = (line[x * 2] << 8) | line[x * 2 + 1];
+            }
+            else {
+                value = line[x];
+            }
+            if (static_cast<long>(value) * 255 < limit) {
+                row[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool readNetpbm(std::istream &in, NeoBitmap &image, int threshold) {
+    char magic[2];
+    if (!in.read(magic, 2) || magic[0] != 'P') {
+        return false;
+    }
+    auto type = magic[1];
+    if (type != '1' && type != '2' && type != '4' && type != '5') {
+        return false;
+    }
+
+    int width = 0;
+    int height = 0;
+    int maxval = 1;
+    if (!readHeaderValue(in, width) || !readHeaderValue(in, height) ||
+        width <= 0 || height <= 0) {
+        return false;
+    }
+    if ((type == '2' || type == '5') &&
+        (!readHeaderValue(in, maxval) || maxval <= 0 || maxval > 65535)) {
+        return false;
+    }
+
+    image.resize(width, height);
+    switch (type) {
+    case '1':
+        return readPlainPbm(in, image);
+    case '4':
+        return readRawPbm(in, image);
+    default:
+        return readPgm(in, image, type == '5', maxval, threshold);
+    }
+}
+
+bool readNetpbmFile(const char *path, NeoBitmap &image, int threshold) {
+    auto file = std::ifstream{path, std::ios::binary};
+    return file && readNetpbm(file, image, threshold);
+}
+
+bool writePbm(const NeoBitmap &image, std::ostream &out) {
+    out << "P4\n" << image.width() << " " << image.height() << "\n";
+    out.write(reinterpret_cast<const char *>(image.data().data()),
+              static_cast<std::streamsize>(image.data().size()));
+    return static_cast<bool>(out);
+}
+
+bool writePbmFile(const NeoBitmap &image, const char *path) {
+    auto file = std::ofstream{path, std::ios::binary};
+    return file && writePbm(image, file);
+}
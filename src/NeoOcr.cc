@@ -0,0 +1,282 @@
+/** @file       NeoOcr.cc
+ *  @brief      Recognition of text rendered with a known font.
+ *
+ *  Glyph and screen rows are both handled as two 64 bit words with the
+ *  leftmost pixel in the most significant bit, which is the bit order of
+ *  NeoBitmap, so a screen window is a shifted big endian load.
+ */
+
+#include "neofontlib/NeoOcr.h"
+#include "neofontlib/NeoCharacterEncoding.h"
+#include "neofontlib/NeoFont.h"
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace {
+
+constexpr size_t rowWords = 2;
+
+uint64_t loadBigEndian(const uint8_t *bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v = (v << 8) | bytes[i];
+    }
+    return v;
+}
+
+/** Read 128 pixels of a bitmap row starting at column x. Pixels right of the
+ * row are zero.
+ */
+void loadWindow(const NeoBitmap &screen, int x, int y, uint64_t *out) {
+    uint8_t bytes[rowWords * 8 + 1] = {};
+    size_t first = static_cast<size_t>(x) / 8;
+    if (first < screen.stride()) {
+        memcpy(bytes,
+               screen.row(y) + first,
+               std::min(sizeof bytes, screen.stride() - first));
+    }
+    uint64_t hi = loadBigEndian(bytes);
+    uint64_t lo = loadBigEndian(bytes + 8);
+    int shift = x & 7;
+    if (shift) {
+        hi = (hi << shift) | (lo >> (64 - shift));
+        lo = (lo << shift) | (bytes[16] >> (8 - shift));
+    }
+    out[0] = hi;
+    out[1] = lo;
+}
+
+uint64_t widthMask(int width) {
+    if (width <= 0) {
+        return 0;
+    }
+    return width >= 64 ? ~uint64_t{0} : ~(~uint64_t{0} >> width);
+}
+
+/** Hash of the rows of a window or glyph, masked to a width.
+ */
+uint64_t hashRows(const uint64_t *rows, int height, const uint64_t *mask) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < height * static_cast<int>(rowWords); ++i) {
+        hash = (hash ^ (rows[i] & mask[i % rowWords])) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+/** Rightmost inked column of a band of rows, plus one.
+ */
+int inkEnd(const NeoBitmap &screen, int y, int height) {
+    int end = 0;
+    for (int r = y; r < y + height; ++r) {
+        auto row = screen.row(r);
+        for (int b = static_cast<int>(screen.stride()) - 1; b * 8 >= end; --b) {
+            if (row[b]) {
+                end = b * 8 + 8 - __builtin_ctz(row[b]);
+                break;
+            }
+        }
+    }
+    return std::min(end, screen.width());
+}
+
+} // namespace
+
+NeoGlyphMatcher::NeoGlyphMatcher(const NeoFont &font,
+                                 const NeoOcrOptions &options)
+    : m_height(font.height())
+    , m_options(options) {
+    auto glyphs = std::vector<Glyph>{};
+    auto rows = std::vector<uint64_t>(m_height * rowWords);
+    for (int code = 0; code < static_cast<int>(NeoFont::charCount); ++code) {
+        auto &c = font.character(code);
+        auto glyph = Glyph{code, c.width(), 0, 0, 0, m_rows.size()};
+        std::fill(rows.begin(), rows.end(), 0);
+        for (int y = 0; y < m_height; ++y) {
+            for (int x = 0; x < c.width(); ++x) {
+                if (c.getPixel(x, y)) {
+                    rows[y * rowWords + x / 64] |= uint64_t{1} << (63 - x % 64);
+                    ++glyph.ink;
+                }
+            }
+        }
+        if (!glyph.ink && code != ' ') {
+            continue;
+        }
+        uint64_t mask[rowWords] = {widthMask(c.width()),
+                                   widthMask(c.width() - 64)};
+        glyph.firstRow = rows[0];
+        glyph.hash = hashRows(rows.data(), m_height, mask);
+        m_rows.insert(m_rows.end(), rows.begin(), rows.end());
+        glyphs.push_back(glyph);
+    }
+
+    std::sort(glyphs.begin(), glyphs.end(), [](auto &a, auto &b) {
+        if (a.width != b.width) {
+            return a.width > b.width;
+        }
+        return std::tie(a.firstRow, a.hash, a.code) <
+               std::tie(b.firstRow, b.hash, b.code);
+    });
+
+    // Drop glyphs identical to a lower code of the same width.
+    for (auto &glyph : glyphs) {
+        if (!m_glyphs.empty()) {
+            auto &last = m_glyphs.back();
+            if (last.width == glyph.width && last.hash == glyph.hash &&
+                std::equal(m_rows.begin() + last.rows,
+                           m_rows.begin() + last.rows + m_height * rowWords,
+                           m_rows.begin() + glyph.rows)) {
+                continue;
+            }
+        }
+        if (m_groups.empty() || m_groups.back().width != glyph.width) {
+            m_groups.push_back({glyph.width,
+                                {widthMask(glyph.width),
+                                 widthMask(glyph.width - 64)},
+                                m_glyphs.size(),
+                                m_glyphs.size()});
+        }
+        m_glyphs.push_back(glyph);
+        m_groups.back().end = m_glyphs.size();
+    }
+}
+
+/** Find the widest glyph exactly matching a window.
+ *
+ *  @return         The code, or unknown.
+ */
+int NeoGlyphMatcher::match(const uint64_t *window, int &width) const {
+    for (auto &group : m_groups) {
+        auto begin = m_glyphs.begin() + group.begin;
+        auto end = m_glyphs.begin() + group.end;
+        auto firstRow = window[0] & group.mask[0];
+        auto first = std::lower_bound(
+            begin, end, firstRow, [](const Glyph &g, uint64_t v) {
+                return g.firstRow < v;
+            });
+        auto last = std::upper_bound(
+            first, end, firstRow, [](uint64_t v, const Glyph &g) {
+                return v < g.firstRow;
+            });
+        if (first == last) {
+            continue;
+        }
+
+        auto hash = hashRows(window, m_height, group.mask);
+        for (auto it = first; it != last; ++it) {
+            if (it->hash != hash) {
+                continue;
+            }
+            auto rows = m_rows.data() + it->rows;
+            bool same = true;
+            for (size_t i = 0; same && i < m_height * rowWords; ++i) {
+                same = (window[i] & group.mask[i % rowWords]) == rows[i];
+            }
+            if (same) {
+                width = group.width;
+                return it->code;
+            }
+        }
+    }
+    return unknown;
+}
+
+/** Find the glyph with the fewest mismatching pixels, preferring wider
+ * glyphs on a tie. Blank glyphs are never chosen this way.
+ */
+int NeoGlyphMatcher::matchClosest(const uint64_t *window, int &width) const {
+    int best = unknown;
+    int bestDistance = m_options.maxDistance + 1;
+    for (auto &group : m_groups) {
+        for (size_t g = group.begin; g < group.end; ++g) {
+            auto &glyph = m_glyphs[g];
+            auto rows = m_rows.data() + glyph.rows;
+            int distance = 0;
+            for (size_t i = 0; distance < bestDistance &&
+                               i < m_height * rowWords;
+                 ++i) {
+                distance += __builtin_popcountll(
+                    (window[i] & group.mask[i % rowWords]) ^ rows[i]);
+            }
+            if (distance < bestDistance && distance < glyph.ink) {
+                best = glyph.code;
+                bestDistance = distance;
+                width = group.width;
+            }
+        }
+    }
+    return best;
+}
+
+void NeoGlyphMatcher::readLine(const NeoBitmap &screen,
+                               int x,
+                               int y,
+                               std::vector<int> &codes) const {
+    if (y < 0 || y + m_height > screen.height() || m_glyphs.empty()) {
+        return;
+    }
+
+    uint64_t window[NeoCharacter::maxHexght * rowWords];
+    int end = inkEnd(screen, y, m_height);
+    bool lastUnknown = false;
+    while (x < end) {
+        for (int r = 0; r < m_height; ++r) {
+            loadWindow(screen, x, y + r, window + r * rowWords);
+        }
+
+        int width = 1;
+        int code = match(window, width);
+        if (code == unknown && m_options.maxDistance > 0) {
+            code = matchClosest(window, width);
+        }
+
+        if (code != unknown) {
+            codes.push_back(code);
+            lastUnknown = false;
+            x += width;
+            continue;
+        }
+
+        bool ink = false;
+        for (int r = 0; r < m_height; ++r) {
+            ink |= (window[r * rowWords] >> 63) != 0;
+        }
+        if (ink && !lastUnknown) {
+            codes.push_back(unknown);
+        }
+        lastUnknown = ink;
+        ++x;
+    }
+}
+
+void NeoGlyphMatcher::readScreen(const NeoBitmap &screen,
+                                 std::vector<int> &codes,
+                                 int lineSpacing) const {
+    int step = m_height + std::max(lineSpacing, 0);
+    for (int y = 0; y + m_height <= screen.height(); y += step) {
+        if (y) {
+            codes.push_back(lineBreak);
+        }
+        readLine(screen, 0, y, codes);
+    }
+}
+
+std::u16string neoCodesToUTF16(NeoSpan<const int> codes,
+                               const NeoCodePage &codePage) {
+    auto text = std::u16string{};
+    text.reserve(codes.size());
+    for (auto code : codes) {
+        if (code == NeoGlyphMatcher::lineBreak) {
+            text.push_back(u'\n');
+        }
+        else if (code < 0) {
+            text.push_back(u'\xfffd');
+        }
+        else {
+            text.push_back(static_cast<char16_t>(codePage.toUTF16(code)));
+        }
+    }
+    return text;
+}
@@ -0,0 +1,37 @@
+/** @file       NeoParallel.h
+ *  @brief      Minimal parallel loop used inside the library.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/** Call fn(i) for every i below count, spread over threads, including the
+ * calling one. Zero threads means one per core.
+ */
+template <typename Function>
+void neoParallelFor(size_t count, int threads, Function fn) {
+    if (threads < 1) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    threads = std::clamp(threads, 1, static_cast<int>(count ? count : 1));
+
+    auto next = std::atomic<size_t>{0};
+    auto worker = [&] {
+        for (size_t i; (i = next++) < count;) {
+            fn(i);
+        }
+    };
+    auto pool = std::vector<std::thread>{};
+    for (int i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : pool) {
+        t.join();
+    }
+}
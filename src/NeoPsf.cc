@@ -0,0 +1,319 @@
+/** @file       NeoPsf.cc
+ *  @brief      Import of Linux console (PSF1/PSF2) fonts.
+ */
+
+#include "neofontlib/NeoPsf.h"
+#include "NeoBits.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoCharacterEncoding.h"
+#include "neofontlib/NeoFont.h"
+#include <array>
+#include <cstring>
+#include <vector>
+
+#ifdef NEOFONTLIB_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+constexpr uint8_t kPsf1Magic0 = 0x36;
+constexpr uint8_t kPsf1Magic1 = 0x04;
+constexpr uint8_t kPsf1Mode512 = 0x01;
+constexpr uint8_t kPsf1ModeHasTab = 0x02;
+constexpr uint8_t kPsf1ModeSeq = 0x04;
+constexpr uint16_t kPsf1Separator = 0xffff;
+constexpr uint16_t kPsf1StartSeq = 0xfffe;
+
+constexpr uint8_t kPsf2Magic[4] = {0x72, 0xb5, 0x4a, 0x86};
+constexpr uint32_t kPsf2HasUnicodeTable = 0x01;
+constexpr uint8_t kPsf2Separator = 0xff;
+constexpr uint8_t kPsf2StartSeq = 0xfe;
+
+constexpr uint8_t kGzipMagic0 = 0x1f;
+constexpr uint8_t kGzipMagic1 = 0x8b;
+
+uint32_t readLE32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/** Layout of the glyph data, common to both PSF versions.
+ */
+struct PsfLayout {
+    int version = 0;
+    size_t glyphOffset = 0;
+    size_t glyphCount = 0;
+    size_t glyphSize = 0;
+    size_t bytesPerRow = 0;
+    int width = 0;
+    int height = 0;
+    size_t tableOffset = 0; /**< Zero if there is no Unicode table. */
+};
+
+bool parseHeader(NeoSpan<const uint8_t> data, PsfLayout &layout) {
+    auto p = data.data();
+    if (data.size() >= 4 && p[0] == kPsf1Magic0 && p[1] == kPsf1Magic1) {
+        layout.version = 1;
+        layout.glyphOffset = 4;
+        layout.glyphCount = (p[2] & kPsf1Mode512) ? 512 : 256;
+        layout.height = p[3];
+        layout.width = 8;
+        layout.bytesPerRow = 1;
+        layout.glyphSize = p[3];
+        if (p[2] & (kPsf1ModeHasTab | kPsf1ModeSeq)) {
+            layout.tableOffset =
+                layout.glyphOffset + layout.glyphCount * layout.glyphSize;
+        }
+    }
+    else if (data.size() >= 32 && !memcmp(p, kPsf2Magic, 4)) {
+        layout.version = 2;
+        layout.glyphOffset = readLE32(p + 8);
+        auto flags = readLE32(p + 12);
+        layout.glyphCount = readLE32(p + 16);
+        layout.glyphSize = readLE32(p + 20);
+        layout.height = static_cast<int>(readLE32(p + 24));
+        layout.width = static_cast<int>(readLE32(p + 28));
+        layout.bytesPerRow = (static_cast<size_t>(layout.width) + 7) / 8;
+        if (layout.width <= 0 || layout.height <= 0 ||
+            layout.glyphSize < layout.bytesPerRow * layout.height) {
+            return false;
+        }
+        if (flags & kPsf2HasUnicodeTable) {
+            layout.tableOffset =
+                layout.glyphOffset + layout.glyphCount * layout.glyphSize;
+        }
+    }
+    else {
+        return false;
+    }
+
+    if (layout.glyphCount == 0 || layout.height == 0 ||
+        layout.glyphOffset > data.size() ||
+        layout.glyphCount >
+            (data.size() - layout.glyphOffset) / layout.glyphSize) {
+        return false;
+    }
+    return true;
+}
+
+/** Assign a glyph to every Neo character showing the given Unicode value,
+ * unless the character already has one.
+ */
+void mapCodepoint(const NeoCodePage &codePage,
+                  uint32_t codepoint,
+                  int glyph,
+                  std::array<int, 256> &map) {
+    if (codepoint > 0xffff) {
+        return; // The Neo character set is within the BMP
+    }
+    int codes[8];
+    auto count = codePage.fromUTF16(
+        static_cast<uint16_t>(codepoint), codes, sizeof codes / sizeof *codes);
+    for (size_t i = 0; i < count && i < sizeof codes / sizeof *codes; ++i) {
+        if (map[codes[i]] < 0) {
+            map[codes[i]] = glyph;
+        }
+    }
+}
+
+/** Decode one UTF-8 sequence from the PSF2 Unicode table.
+ *
+ *  @return     The number of bytes used, or zero at a table control byte.
+ */
+size_t decodeUtf8(const uint8_t *p, const uint8_t *end, uint32_t &codepoint) {
+    auto c = *p;
+    size_t length = c < 0x80   ? 1
+                    : c < 0xc0 ? 0
+                    : c < 0xe0 ? 2
+                    : c < 0xf0 ? 3
+                    : c < 0xf8 ? 4
+                               : 0;
+    if (!length || static_cast<size_t>(end - p) < length) {
+        return 0;
+    }
+    codepoint = length == 1 ? c : (c & (0x7f >> length));
+    for (size_t i = 1; i < length; ++i) {
+        codepoint = (codepoint << 6) | (p[i] & 0x3f);
+    }
+    return length;
+}
+
+/** Build the Neo code to glyph index map from the Unicode table.
+ */
+void readUnicodeTable(NeoSpan<const uint8_t> data,
+                      const PsfLayout &layout,
+                      const NeoCodePage &codePage,
+                      std::array<int, 256> &map) {
+    auto p = data.data() + layout.tableOffset;
+    auto end = data.data() + data.size();
+    for (size_t glyph = 0; glyph < layout.glyphCount && p < end; ++glyph) {
+        auto g = static_cast<int>(glyph);
+        bool inSequence = false; // Combining sequences are not used
+        if (layout.version == 1) {
+            for (; p + 1 < end; p += 2) {
+                uint16_t value = static_cast<uint16_t>(p[0] | (p[1] << 8));
+                if (value == kPsf1Separator) {
+                    p += 2;
+                    break;
+                }
+                if (value == kPsf1StartSeq) {
+                    inSequence = true;
+                }
+                else if (!inSequence) {
+                    mapCodepoint(codePage, value, g, map);
+                }
+            }
+        }
+        else {
+            while (p < end) {
+                if (*p == kPsf2Separator) {
+                    ++p;
+                    break;
+                }
+                if (*p == kPsf2StartSeq) {
+                    inSequence = true;
+                    ++p;
+                    continue;
+                }
+                uint32_t codepoint = 0;
+                auto length = decodeUtf8(p, end, codepoint);
+                if (!length) {
+                    ++p; // Skip invalid bytes
+                    continue;
+                }
+                if (!inSequence) {
+                    mapCodepoint(codePage, codepoint, g, map);
+                }
+                p += length;
+            }
+        }
+    }
+}
+
+/** Copy one PSF glyph in to a character, a row at a time.
+ */
+void copyGlyph(const uint8_t *glyph,
+               const PsfLayout &layout,
+               int width,
+               int height,
+               NeoCharacter &c) {
+    auto copyBytes = (static_cast<size_t>(width) + 7) / 8;
+    auto lastMask = neoLastByteMask(width);
+    for (int y = 0; y < height; ++y) {
+        auto src = glyph + y * layout.bytesPerRow;
+        auto dst = c.row(y);
+        for (size_t i = 0; i < copyBytes; ++i) {
+            dst[i] = neoReversedBits[src[i]];
+        }
+        dst[copyBytes - 1] &= lastMask;
+        memset(dst + copyBytes, 0, NeoCharacter::rowBytes - copyBytes);
+    }
+}
+
+#ifdef NEOFONTLIB_HAVE_ZLIB
+
+bool gunzip(NeoSpan<const uint8_t> data, std::vector<uint8_t> &out) {
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in = const_cast<Bytef *>(data.data());
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    out.resize(data.size() * 4 + 4096);
+    int result = Z_OK;
+    while (result == Z_OK) {
+        if (stream.total_out == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        stream.next_out = out.data() + stream.total_out;
+        stream.avail_out = static_cast<uInt>(out.size() - stream.total_out);
+        result = inflate(&stream, Z_NO_FLUSH);
+    }
+    out.resize(stream.total_out);
+    inflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
+
+#endif
+
+} // namespace
+
+bool isPsfData(NeoSpan<const uint8_t> data) {
+    auto p = data.data();
+    return (data.size() >= 2 && p[0] == kPsf1Magic0 && p[1] == kPsf1Magic1) ||
+           (data.size() >= 4 && !memcmp(p, kPsf2Magic, 4)) ||
+           (data.size() >= 2 && p[0] == kGzipMagic0 && p[1] == kGzipMagic1);
+}
+
+bool importPsf(NeoSpan<const uint8_t> data, NeoFont &font, NeoPsfInfo *info) {
+    if (data.size() >= 2 && data[0] == kGzipMagic0 && data[1] == kGzipMagic1) {
+#ifdef NEOFONTLIB_HAVE_ZLIB
+        auto unpacked = std::vector<uint8_t>{};
+        return gunzip(data, unpacked) &&
+               unpacked.size() >= 2 && unpacked[0] != kGzipMagic0 &&
+               importPsf(NeoSpan<const uint8_t>{unpacked}, font, info);
+#else
+        return false; // Built without zlib
+#endif
+    }
+
+    auto layout = PsfLayout{};
+    if (!parseHeader(data, layout)) {
+        return false;
+    }
+
+    // Neo code -> PSF glyph index.
+    auto map = std::array<int, 256>{};
+    map.fill(-1);
+    if (layout.tableOffset && layout.tableOffset < data.size()) {
+        readUnicodeTable(data, layout, font.codePage(), map);
+    }
+    else {
+        for (int i = 0; i < 256; ++i) {
+            auto codepoint = font.codePage().toUTF16(i);
+            if (codepoint < layout.glyphCount) {
+                map[i] = codepoint;
+            }
+        }
+    }
+
+    int width = layout.width;
+    if (width > static_cast<int>(NeoCharacter::maxWidth)) {
+        width = NeoCharacter::maxWidth; // Crop oversized glyphs on the right
+    }
+    int height = font.setHeight(layout.height);
+
+    int mapped = 0;
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &c = font.character(i);
+        c.setWidth(width);
+        if (map[i] < 0) {
+            for (int y = 0; y < height; ++y) {
+                memset(c.row(y), 0, NeoCharacter::rowBytes);
+            }
+            continue;
+        }
+        auto glyph = data.data() + layout.glyphOffset +
+                     static_cast<size_t>(map[i]) * layout.glyphSize;
+        copyGlyph(glyph, layout, width, height, c);
+        ++mapped;
+    }
+
+    if (info) {
+        info->version = layout.version;
+        info->glyphCount = static_cast<int>(layout.glyphCount);
+        info->width = layout.width;
+        info->height = layout.height;
+        info->hasUnicodeTable = layout.tableOffset != 0;
+        info->mappedCharacters = mapped;
+    }
+    return true;
+}
+
+bool importPsfFile(const char *path, NeoFont &font, NeoPsfInfo *info) {
+    auto buffer = NeoAppletBuffer{};
+    return buffer.load(path) && importPsf(buffer.bytes(), font, info);
+}
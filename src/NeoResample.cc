@@ -0,0 +1,278 @@
+/** @file       NeoResample.cc
+ *  @brief      Scaling of fonts to other heights.
+ *
+ *  Characters are copied in to a plane of 64 bit row words, wide enough to
+ *  hold a doubled maximum width character. Pixel x of a row is bit x of the
+ *  little endian row, the same as in NeoCharacter, so rows are moved with
+ *  memcpy.
+ */
+
+#include "neofontlib/NeoResample.h"
+#include "NeoParallel.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr int planeWords = 4;
+constexpr int planeWidth = planeWords * 64;
+
+using Row = std::array<uint64_t, planeWords>;
+
+struct Plane {
+    int width = 0;
+    int height = 0;
+    std::array<Row, NeoCharacter::maxHexght> rows;
+};
+
+uint64_t lowBits(int n) {
+    return n >= 64 ? ~uint64_t{0} : (uint64_t{1} << n) - 1;
+}
+
+/** Number of set bits in columns [x0, x1) of a row.
+ */
+int countBits(const Row &row, int x0, int x1) {
+    int count = 0;
+    for (int w = x0 / 64; w < planeWords && w * 64 < x1; ++w) {
+        auto mask = lowBits(x1 - w * 64) & ~lowBits(x0 - w * 64);
+        count += __builtin_popcountll(row[w] & mask);
+    }
+    return count;
+}
+
+bool testBit(const Row &row, int x) {
+    return (row[x / 64] >> (x % 64)) & 1;
+}
+
+void load(const NeoCharacter &c, int height, Plane &plane) {
+    plane.width = c.width();
+    plane.height = height;
+    for (int y = 0; y < height; ++y) {
+        auto &row = plane.rows[y];
+        row = {};
+        memcpy(row.data(), c.row(y), NeoCharacter::rowBytes);
+        row[0] &= lowBits(plane.width);
+        row[1] &= lowBits(std::max(0, plane.width - 64));
+    }
+}
+
+void store(const Plane &plane, NeoCharacter &c) {
+    c.clear();
+    c.setHeight(plane.height);
+    c.setWidth(plane.width);
+    for (int y = 0; y < plane.height; ++y) {
+        memcpy(c.row(y), plane.rows[y].data(), NeoCharacter::rowBytes);
+    }
+}
+
+/** Spread the low 32 bits of v to the even bits of the result.
+ */
+uint64_t spreadBits(uint64_t v) {
+    v &= 0xffffffffull;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+    v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+    v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+    v = (v | (v << 2)) & 0x3333333333333333ull;
+    v = (v | (v << 1)) & 0x5555555555555555ull;
+    return v;
+}
+
+/** Interleave two rows, even pixels from a and odd pixels from b.
+ */
+Row interleave(const Row &a, const Row &b) {
+    auto out = Row{};
+    for (int w = 0; w < planeWords / 2; ++w) {
+        out[w * 2] = spreadBits(a[w]) | (spreadBits(b[w]) << 1);
+        out[w * 2 + 1] =
+            spreadBits(a[w] >> 32) | (spreadBits(b[w] >> 32) << 1);
+    }
+    return out;
+}
+
+/** Row with every pixel moved one step right, so bit x holds pixel x - 1.
+ */
+Row shiftRight(const Row &row) {
+    auto out = Row{};
+    for (int w = 0; w < planeWords; ++w) {
+        out[w] = (row[w] << 1) | (w ? row[w - 1] >> 63 : 0);
+    }
+    return out;
+}
+
+Row shiftLeft(const Row &row) {
+    auto out = Row{};
+    for (int w = 0; w < planeWords; ++w) {
+        out[w] = (row[w] >> 1) | (w + 1 < planeWords ? row[w + 1] << 63 : 0);
+    }
+    return out;
+}
+
+/** Scale2x (EPX) on whole row words. With E the pixel, B/H above and below
+ * and D/F left and right, the top left output pixel is D if D == B and the
+ * other two neighbours differ, otherwise E; the other corners are symmetric.
+ * The source must be at most half a plane wide and half the maximum height.
+ */
+void scale2x(const Plane &src, Plane &dst) {
+    const auto empty = Row{};
+    auto widthMask = Row{};
+    for (int w = 0; w < planeWords; ++w) {
+        widthMask[w] = lowBits(std::max(0, src.width - w * 64));
+    }
+
+    for (int y = 0; y < src.height; ++y) {
+        auto &e = src.rows[y];
+        auto &b = y ? src.rows[y - 1] : empty;
+        auto &h = y + 1 < src.height ? src.rows[y + 1] : empty;
+        auto d = shiftRight(e);
+        auto f = shiftLeft(e);
+
+        Row e0, e1, e2, e3;
+        for (int w = 0; w < planeWords; ++w) {
+            auto db = ~(d[w] ^ b[w]);
+            auto bf = ~(b[w] ^ f[w]);
+            auto dh = ~(d[w] ^ h[w]);
+            auto hf = ~(h[w] ^ f[w]);
+            auto m0 = db & ~bf & ~dh;
+            auto m1 = bf & ~db & ~hf;
+            auto m2 = dh & ~db & ~hf;
+            auto m3 = hf & ~dh & ~bf;
+            e0[w] = ((m0 & d[w]) | (~m0 & e[w])) & widthMask[w];
+            e1[w] = ((m1 & f[w]) | (~m1 & e[w])) & widthMask[w];
+            e2[w] = ((m2 & d[w]) | (~m2 & e[w])) & widthMask[w];
+            e3[w] = ((m3 & f[w]) | (~m3 & e[w])) & widthMask[w];
+        }
+        dst.rows[y * 2] = interleave(e0, e1);
+        dst.rows[y * 2 + 1] = interleave(e2, e3);
+    }
+    dst.width = src.width * 2;
+    dst.height = src.height * 2;
+}
+
+/** Resample by coverage. Each target pixel maps to a box of source pixels;
+ * it is set when at least half of the box is set. With nearest the box is
+ * the single pixel under the centre of the target pixel.
+ */
+void resampleBox(const Plane &src, Plane &dst, bool nearest) {
+    for (int y = 0; y < dst.height; ++y) {
+        auto &out = dst.rows[y];
+        out = {};
+        int y0 = y * src.height / dst.height;
+        int y1 = std::max(
+            y0 + 1, ((y + 1) * src.height + dst.height - 1) / dst.height);
+        if (nearest) {
+            y0 = (2 * y + 1) * src.height / (2 * dst.height);
+        }
+
+        for (int x = 0; x < dst.width; ++x) {
+            bool set;
+            if (nearest) {
+                int sx = (2 * x + 1) * src.width / (2 * dst.width);
+                set = testBit(src.rows[y0], sx);
+            }
+            else {
+                int x0 = x * src.width / dst.width;
+                int x1 = std::max(
+                    x0 + 1, ((x + 1) * src.width + dst.width - 1) / dst.width);
+                int count = 0;
+                for (int sy = y0; sy < y1; ++sy) {
+                    count += countBits(src.rows[sy], x0, x1);
+                }
+                set = count * 2 >= (x1 - x0) * (y1 - y0);
+            }
+            if (set) {
+                out[x / 64] |= uint64_t{1} << (x % 64);
+            }
+        }
+    }
+}
+
+int clampHeight(int height) {
+    return std::clamp(height,
+                      static_cast<int>(NeoCharacter::minHeight),
+                      static_cast<int>(NeoCharacter::maxHexght));
+}
+
+} // namespace
+
+void resampleCharacter(const NeoCharacter &source,
+                       int srcHeight,
+                       NeoCharacter &target,
+                       int height,
+                       NeoResampleMode mode) {
+    srcHeight = clampHeight(srcHeight);
+    height = clampHeight(height);
+
+    Plane planes[2];
+    int current = 0;
+    load(source, srcHeight, planes[current]);
+
+    int width = (source.width() * height + srcHeight / 2) / srcHeight;
+    width = std::clamp(width,
+                       static_cast<int>(NeoCharacter::minWidth),
+                       static_cast<int>(NeoCharacter::maxWidth));
+
+    if (mode == NeoResampleMode::Scale2x) {
+        while (planes[current].height * 2 <= height &&
+               planes[current].width * 2 <= planeWidth) {
+            scale2x(planes[current], planes[1 - current]);
+            current = 1 - current;
+        }
+    }
+
+    auto &src = planes[current];
+    auto &dst = planes[1 - current];
+    dst.width = width;
+    dst.height = height;
+    if (src.width == width && src.height == height) {
+        dst = src;
+    }
+    else {
+        resampleBox(src, dst, mode == NeoResampleMode::Nearest);
+    }
+    store(dst, target);
+}
+
+int resampleFont(const NeoFont &source,
+                 NeoFont &target,
+                 int height,
+                 const NeoResampleOptions &options) {
+    height = clampHeight(height);
+    if (&target != &source) {
+        target = source;
+    }
+    int srcHeight = source.height();
+    target.setHeight(height);
+    // Each character is read in to a plane before it is written, so this
+    // also works in place.
+    neoParallelFor(NeoFont::charCount, options.threads, [&](size_t i) {
+        resampleCharacter(source.character(i),
+                          srcHeight,
+                          target.character(i),
+                          height,
+                          options.mode);
+    });
+    return height;
+}
+
+std::vector<NeoFont> resampleFamily(const NeoFont &master,
+                                    NeoSpan<const int> heights,
+                                    const NeoResampleOptions &options) {
+    auto family = std::vector<NeoFont>(heights.size(), master);
+    for (size_t f = 0; f < family.size(); ++f) {
+        family[f].setHeight(clampHeight(heights[f]));
+    }
+
+    int srcHeight = master.height();
+    neoParallelFor(
+        family.size() * NeoFont::charCount, options.threads, [&](size_t i) {
+            auto &font = family[i / NeoFont::charCount];
+            int code = static_cast<int>(i % NeoFont::charCount);
+            resampleCharacter(master.character(code),
+                              srcHeight,
+                              font.character(code),
+                              font.height(),
+                              options.mode);
+        });
+    return family;
+}
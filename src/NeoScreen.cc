@@ -0,0 +1,290 @@
+/** @file       NeoScreen.cc
+ *  @brief      Text screen simulator with incremental redraw.
+ */
+
+#include "neofontlib/NeoScreen.h"
+#include "neofontlib/NeoFont.h"
+#include <algorithm>
+#include <cstring>
+
+NeoScreen::NeoScreen(const NeoFont &font, int width, int rows)
+    : m_font(font)
+    , m_rows(std::max(rows, 0))
+    , m_height(font.height())
+    , m_framebuffer(width, m_rows * font.height())
+    , m_glyphs(font)
+    , m_lines(1)
+    , m_dirty(m_rows) {
+    layout(m_lines.front(), 0);
+}
+
+/** Recompute the character positions of a line from a column onwards.
+ */
+void NeoScreen::layout(Line &line, size_t from) {
+    line.x.resize(line.codes.size() + 1);
+    if (from == 0) {
+        line.x[0] = 0;
+    }
+    for (size_t i = from; i < line.codes.size(); ++i) {
+        line.x[i + 1] = line.x[i] + m_font.character(line.codes[i]).width();
+    }
+}
+
+/** Text row of a document line, or -1 if it is not visible.
+ */
+int NeoScreen::visibleRow(size_t line) const {
+    if (line < m_top || line - m_top >= static_cast<size_t>(m_rows)) {
+        return -1;
+    }
+    return static_cast<int>(line - m_top);
+}
+
+void NeoScreen::markLine(size_t line, int from, int to) {
+    int row = visibleRow(line);
+    if (row < 0) {
+        return;
+    }
+    from = std::max(from, 0);
+    to = std::min(to, m_framebuffer.width());
+    if (from >= to) {
+        return;
+    }
+    auto &dirty = m_dirty[row];
+    if (dirty.from >= dirty.to) {
+        dirty = {from, to};
+    }
+    else {
+        dirty.from = std::min(dirty.from, from);
+        dirty.to = std::max(dirty.to, to);
+    }
+}
+
+/** Move count text rows of the framebuffer and their dirty spans.
+ */
+void NeoScreen::moveRows(int from, int to, int count) {
+    if (count <= 0 || from == to) {
+        return;
+    }
+    auto stride = m_framebuffer.stride();
+    memmove(m_framebuffer.row(to * m_height),
+            m_framebuffer.row(from * m_height),
+            static_cast<size_t>(count) * m_height * stride);
+    if (to < from) {
+        std::copy(m_dirty.begin() + from,
+                  m_dirty.begin() + from + count,
+                  m_dirty.begin() + to);
+    }
+    else {
+        std::copy_backward(m_dirty.begin() + from,
+                           m_dirty.begin() + from + count,
+                           m_dirty.begin() + to + count);
+    }
+}
+
+void NeoScreen::assign(NeoSpan<const uint8_t> text, uint8_t lineBreak) {
+    m_lines.assign(1, Line{});
+    for (auto code : text) {
+        if (code == lineBreak) {
+            m_lines.emplace_back();
+        }
+        else {
+            m_lines.back().codes.push_back(code);
+        }
+    }
+    for (auto &line : m_lines) {
+        layout(line, 0);
+    }
+    m_top = 0;
+    invalidate();
+}
+
+void NeoScreen::insert(size_t line, size_t column, uint8_t code) {
+    auto &l = m_lines.at(line);
+    column = std::min(column, l.codes.size());
+    l.codes.insert(l.codes.begin() + column, code);
+    layout(l, column);
+    markLine(line, l.x[column], l.x.back());
+}
+
+void NeoScreen::erase(size_t line, size_t column) {
+    auto &l = m_lines.at(line);
+    if (column >= l.codes.size()) {
+        return;
+    }
+    int end = l.x.back();
+    l.codes.erase(l.codes.begin() + column);
+    layout(l, column);
+    markLine(line, l.x[column], end);
+}
+
+void NeoScreen::insertLine(size_t line, NeoSpan<const uint8_t> codes) {
+    line = std::min(line, m_lines.size());
+    auto l = Line{};
+    l.codes.assign(codes.begin(), codes.end());
+    layout(l, 0);
+    m_lines.insert(m_lines.begin() + line, std::move(l));
+
+    if (line < m_top) {
+        ++m_top; // Keep the same text on screen
+        return;
+    }
+    int row = visibleRow(line);
+    if (row < 0) {
+        return;
+    }
+    moveRows(row, row + 1, m_rows - row - 1);
+    m_framebuffer.clearRect(
+        0, row * m_height, m_framebuffer.width(), m_height);
+    m_dirty[row] = {};
+    markLine(line, 0, m_lines[line].x.back());
+}
+
+void NeoScreen::eraseLine(size_t line) {
+    if (line >= m_lines.size()) {
+        return;
+    }
+    if (m_lines.size() == 1) {
+        int end = m_lines[0].x.back();
+        m_lines[0] = {};
+        layout(m_lines[0], 0);
+        markLine(0, 0, end);
+        return;
+    }
+    m_lines.erase(m_lines.begin() + line);
+
+    if (line < m_top) {
+        --m_top;
+        return;
+    }
+    if (m_top == m_lines.size()) {
+        // The last line was at the top, show the one before it instead.
+        --m_top;
+        m_framebuffer.clear();
+        std::fill(m_dirty.begin(), m_dirty.end(), Dirty{});
+        markLine(m_top, 0, m_lines[m_top].x.back());
+        return;
+    }
+    int row = visibleRow(line);
+    if (row < 0) {
+        return;
+    }
+    moveRows(row + 1, row, m_rows - row - 1);
+
+    // The row at the bottom shows a line that was below the screen.
+    int last = m_rows - 1;
+    m_framebuffer.clearRect(
+        0, last * m_height, m_framebuffer.width(), m_height);
+    m_dirty[last] = {};
+    auto shown = m_top + last;
+    if (shown < m_lines.size()) {
+        markLine(shown, 0, m_lines[shown].x.back());
+    }
+}
+
+void NeoScreen::splitLine(size_t line, size_t column) {
+    auto &l = m_lines.at(line);
+    column = std::min(column, l.codes.size());
+    auto tail = std::vector<uint8_t>(l.codes.begin() + column, l.codes.end());
+    int end = l.x.back();
+    l.codes.resize(column);
+    layout(l, column);
+    markLine(line, l.x[column], end);
+    insertLine(line + 1, tail);
+}
+
+void NeoScreen::joinLine(size_t line) {
+    if (line + 1 >= m_lines.size()) {
+        return;
+    }
+    auto &l = m_lines[line];
+    auto &next = m_lines[line + 1];
+    auto column = l.codes.size();
+    l.codes.insert(l.codes.end(), next.codes.begin(), next.codes.end());
+    layout(l, column);
+    markLine(line, l.x[column], l.x.back());
+    eraseLine(line + 1);
+}
+
+void NeoScreen::scrollTo(size_t top) {
+    top = std::min(top, m_lines.size() - 1);
+    if (top == m_top) {
+        return;
+    }
+
+    bool down = top > m_top;
+    auto distance = down ? top - m_top : m_top - top;
+    int shift = static_cast<int>(
+        std::min(distance, static_cast<size_t>(m_rows)));
+    int kept = m_rows - shift;
+    if (down) {
+        moveRows(shift, 0, kept);
+    }
+    else {
+        moveRows(0, shift, kept);
+    }
+    m_top = top;
+
+    // Rows that came in to view are redrawn from scratch.
+    int first = down ? kept : 0;
+    for (int row = first; row < first + shift; ++row) {
+        m_framebuffer.clearRect(
+            0, row * m_height, m_framebuffer.width(), m_height);
+        m_dirty[row] = {};
+        auto line = m_top + row;
+        if (line < m_lines.size()) {
+            markLine(line, 0, m_lines[line].x.back());
+        }
+    }
+}
+
+void NeoScreen::invalidate() {
+    m_glyphs.invalidate();
+    if (m_font.height() != m_height) {
+        m_height = m_font.height();
+        m_framebuffer.resize(m_framebuffer.width(), m_rows * m_height);
+    }
+    m_framebuffer.clear();
+    std::fill(m_dirty.begin(), m_dirty.end(), Dirty{});
+    for (auto &line : m_lines) {
+        layout(line, 0);
+    }
+    for (int row = 0; row < m_rows; ++row) {
+        auto line = m_top + row;
+        if (line < m_lines.size()) {
+            markLine(line, 0, m_lines[line].x.back());
+        }
+    }
+}
+
+void NeoScreen::invalidate(const NeoFontChanges &changes) {
+    if (changes.characters.any() || changes.height) {
+        invalidate();
+    }
+}
+
+int NeoScreen::render() {
+    int drawn = 0;
+    for (int row = 0; row < m_rows; ++row) {
+        auto &dirty = m_dirty[row];
+        if (dirty.from >= dirty.to) {
+            continue;
+        }
+        int y = row * m_height;
+        m_framebuffer.clearRect(
+            dirty.from, y, dirty.to - dirty.from, m_height);
+
+        auto line = m_top + row;
+        if (line < m_lines.size()) {
+            auto &l = m_lines[line];
+            // Start with the first character that ends inside the span.
+            auto end = std::upper_bound(l.x.begin() + 1, l.x.end(), dirty.from);
+            auto i = static_cast<size_t>(end - l.x.begin()) - 1;
+            for (; i < l.codes.size() && l.x[i] < dirty.to; ++i) {
+                m_glyphs.draw(m_framebuffer, l.codes[i], l.x[i], y);
+                ++drawn;
+            }
+        }
+        dirty = {};
+    }
+    return drawn;
+}
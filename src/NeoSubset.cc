@@ -0,0 +1,192 @@
+/** @file       NeoSubset.cc
+ *  @brief      Reduction of a font to the characters used by a text corpus.
+ */
+
+#include "neofontlib/NeoSubset.h"
+#include "neofontlib/NeoCharacterEncoding.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t kHighBits = 0x8080808080808080ull;
+
+/** Add n to the count of every Neo character showing a code point.
+ */
+bool countCodepoint(const NeoCodePage &codePage,
+                    uint32_t codepoint,
+                    NeoCharacterHistogram &histogram,
+                    uint64_t n = 1) {
+    if (codepoint > 0xffff) {
+        return false;
+    }
+    int codes[8];
+    auto count = codePage.fromUTF16(
+        static_cast<uint16_t>(codepoint), codes, sizeof codes / sizeof *codes);
+    for (size_t i = 0; i < count && i < sizeof codes / sizeof *codes; ++i) {
+        histogram[codes[i]] += n;
+    }
+    return count != 0;
+}
+
+} // namespace
+
+NeoCorpusScanner::NeoCorpusScanner(const NeoCodePage &codePage)
+    : m_codePage(&codePage) {
+    for (uint32_t c = 0x80; c < m_twoByte.size(); ++c) {
+        int code;
+        if (codePage.fromUTF16(static_cast<uint16_t>(c), &code, 1) == 1) {
+            m_twoByte[c] = static_cast<uint8_t>(code + 1);
+        }
+    }
+}
+
+void NeoCorpusScanner::addCodepoint(uint32_t codepoint) {
+    ++m_otherCount;
+    if (codepoint < m_twoByte.size()) {
+        if (auto code = m_twoByte[codepoint]) {
+            ++m_other[code - 1];
+            return;
+        }
+    }
+    if (!countCodepoint(*m_codePage, codepoint, m_other)) {
+        ++m_unmapped;
+    }
+}
+
+void NeoCorpusScanner::add(NeoSpan<const char> text) {
+    auto p = reinterpret_cast<const uint8_t *>(text.data());
+    auto end = p + text.size();
+
+    while (p < end) {
+        // Finish or skip a multi byte sequence.
+        if (m_pending) {
+            if ((*p & 0xc0) != 0x80) {
+                m_pending = 0; // Truncated sequence, resync here
+                ++m_unmapped;
+                continue;
+            }
+            m_partial = (m_partial << 6) | (*p++ & 0x3f);
+            if (--m_pending == 0) {
+                addCodepoint(m_partial);
+            }
+            continue;
+        }
+
+        // Eight ASCII bytes at a time while the high bits are all clear.
+        while (end - p >= 16) {
+            uint64_t a;
+            uint64_t b;
+            memcpy(&a, p, sizeof a);
+            memcpy(&b, p + 8, sizeof b);
+            if ((a | b) & kHighBits) {
+                break;
+            }
+            for (size_t i = 0; i < 16; i += banks) {
+                ++m_ascii[0][p[i]];
+                ++m_ascii[1][p[i + 1]];
+                ++m_ascii[2][p[i + 2]];
+                ++m_ascii[3][p[i + 3]];
+            }
+            p += 16;
+        }
+        if (p == end) {
+            break;
+        }
+
+        auto c = *p++;
+        if (c < 0x80) {
+            ++m_ascii[0][c];
+        }
+        else if ((c & 0xe0) == 0xc0) {
+            m_partial = c & 0x1f;
+            m_pending = 1;
+        }
+        else if ((c & 0xf0) == 0xe0) {
+            m_partial = c & 0x0f;
+            m_pending = 2;
+        }
+        else if ((c & 0xf8) == 0xf0) {
+            m_partial = c & 0x07;
+            m_pending = 3;
+        }
+        else {
+            ++m_unmapped; // Stray continuation or invalid byte
+        }
+    }
+}
+
+NeoCharacterHistogram NeoCorpusScanner::histogram() const {
+    auto result = m_other;
+    for (uint32_t c = 0; c < 128; ++c) {
+        uint64_t sum = 0;
+        for (auto &bank : m_ascii) {
+            sum += bank[c];
+        }
+        if (sum) {
+            countCodepoint(*m_codePage, c, result, sum);
+        }
+    }
+    return result;
+}
+
+uint64_t NeoCorpusScanner::unmapped() const {
+    uint64_t sum = m_unmapped;
+    for (uint32_t c = 0; c < 128; ++c) {
+        if (m_codePage->fromUTF16(static_cast<uint16_t>(c)) < 0) {
+            for (auto &bank : m_ascii) {
+                sum += bank[c];
+            }
+        }
+    }
+    return sum;
+}
+
+uint64_t NeoCorpusScanner::codepoints() const {
+    uint64_t sum = m_otherCount;
+    for (auto &bank : m_ascii) {
+        for (auto n : bank) {
+            sum += n;
+        }
+    }
+    return sum;
+}
+
+bool scanCorpusFile(const char *path, NeoCorpusScanner &scanner) {
+    auto file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    char buffer[1 << 16];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        scanner.add({buffer, n});
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+NeoSubsetReport subsetFont(NeoFont &font,
+                           const NeoCharacterHistogram &usage,
+                           uint64_t minCount) {
+    auto report = NeoSubsetReport{};
+    report.sizeBefore = font.appletSize();
+
+    int height = font.height();
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        if (usage[i] >= minCount) {
+            ++report.kept;
+            continue;
+        }
+        auto &c = font.character(i);
+        c.setWidth(NeoCharacter::minWidth);
+        for (int y = 0; y < height; ++y) {
+            memset(c.row(y), 0, NeoCharacter::rowBytes);
+        }
+        ++report.removed;
+    }
+
+    report.sizeAfter = font.appletSize();
+    return report;
+}
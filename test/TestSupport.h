@@ -0,0 +1,66 @@
+/** @file       TestSupport.h
+ *  @brief      Failure reports and glyph helpers shared by the tests.
+ */
+
+#pragma once
+
+#include "neofontlib/NeoCharacter.h"
+#include <cstring>
+#include <iostream>
+#include <random>
+
+/** Reports failed checks of one test program on stderr, as
+ * "<test>: <message> (<label> <index>)", and gives its exit status.
+ */
+struct TestFailure {
+    const char *test;
+    const char *label = nullptr; /**< What the index counts, e.g. "round". */
+
+    /// @return 1, for main() to return. A negative index is not printed.
+    int operator()(const char *message, int index = -1) const {
+        return (*this)(nullptr, message, index);
+    }
+
+    /// The same, with the operation that failed before the message.
+    int operator()(const char *operation,
+                   const char *message,
+                   int index) const {
+        std::cerr << test << ": ";
+        if (operation) {
+            std::cerr << operation << ": ";
+        }
+        std::cerr << message;
+        if (label && index >= 0) {
+            std::cerr << " (" << label << " " << index << ")";
+        }
+        std::cerr << "\n";
+        return 1;
+    }
+};
+
+/** Give a character random pixels, each set with a probability of density
+ * in 8, and a random width from 1 to maxWidth. The pixels right of the new
+ * width are random too, since code reading the character must ignore them.
+ */
+inline void randomGlyph(NeoCharacter &c,
+                        std::mt19937 &rng,
+                        int maxWidth = NeoCharacter::maxWidth,
+                        int density = 2) {
+    c.setWidth(NeoCharacter::maxWidth);
+    for (int y = 0; y < c.height(); ++y) {
+        for (int x = 0; x < c.width(); ++x) {
+            c.changePixel(x, y, static_cast<int>(rng() % 8) < density);
+        }
+    }
+    c.setWidth(1 + static_cast<int>(rng() % maxWidth));
+}
+
+/// Every stored byte of the rows in use, including bits right of the width.
+inline bool sameRows(const NeoCharacter &a, const NeoCharacter &b) {
+    for (int y = 0; y < a.height(); ++y) {
+        if (memcmp(a.row(y), b.row(y), NeoCharacter::rowBytes)) {
+            return false;
+        }
+    }
+    return true;
+}
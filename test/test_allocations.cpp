@@ -0,0 +1,99 @@
+// Checks that steady state encode and decode through the span based API and
+// NeoAppletBuffer do not allocate.
+
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoFont.h"
+#include <cstdlib>
+#include <memory>
+#include <iostream>
+#include <new>
+#include <vector>
+
+namespace {
+
+size_t allocationCount = 0;
+
+} // namespace
+
+void *operator new(size_t size) {
+    ++allocationCount;
+    if (auto p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+int fail(const char *message) {
+    std::cerr << "test_allocations: " << message << "\n";
+    return 1;
+}
+
+int main() {
+    auto source = std::make_unique<NeoFont>();
+    source->setHeight(20);
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &c = source->character(i);
+        c.setWidth(4 + i % 12);
+        c.setPixel(i % c.width(), i % c.height());
+    }
+
+    auto decoded = std::make_unique<NeoFont>();
+    auto buffer = NeoAppletBuffer{};
+    auto raw = std::vector<uint8_t>(source->appletSize());
+
+    // Warm up: lets the buffer reach its final size.
+    buffer.encode(*source);
+    if (!buffer.decode(*decoded)) {
+        return fail("warm up decode failed");
+    }
+
+    auto before = allocationCount;
+    for (int i = 0; i < 100; ++i) {
+        if (buffer.encode(*source).empty()) {
+            return fail("encode failed");
+        }
+        if (!buffer.decode(*decoded)) {
+            return fail("decode failed");
+        }
+        if (source->encodeApplet(NeoSpan<uint8_t>{raw}) != raw.size()) {
+            return fail("span encode failed");
+        }
+        if (!decoded->decodeApplet(NeoSpan<const uint8_t>{raw})) {
+            return fail("span decode failed");
+        }
+    }
+    auto allocations = allocationCount - before;
+
+    if (allocations != 0) {
+        std::cerr << "test_allocations: " << allocations
+                  << " allocations in steady state\n";
+        return 1;
+    }
+
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &c = source->character(i);
+        auto &d = decoded->character(i);
+        if (d.width() != c.width() ||
+            !d.getPixel(i % c.width(), i % c.height())) {
+            return fail("round trip mismatch");
+        }
+    }
+
+    auto tooSmall = std::vector<uint8_t>(raw.size() - 1);
+    if (source->encodeApplet(NeoSpan<uint8_t>{tooSmall}) != 0) {
+        return fail("encode in to a short buffer should fail");
+    }
+    if (decoded->decodeApplet(NeoSpan<const uint8_t>{raw}.first(100))) {
+        return fail("decode of a truncated applet should fail");
+    }
+
+    return 0;
+}
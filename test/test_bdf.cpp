@@ -0,0 +1,148 @@
+// Checks that a BDF export imports back to the same font, from a stream or
+// from memory, including Neo codes that share a Unicode value, and that BBX
+// offsets are applied.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoBdf.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoImport.h"
+#include <memory>
+#include <random>
+#include <sstream>
+
+namespace {
+
+const auto fail = TestFailure{"test_bdf", "code"};
+
+bool samePixels(const NeoCharacter &a, const NeoCharacter &b) {
+    if (a.width() != b.width() || a.height() != b.height()) {
+        return false;
+    }
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            if (a.getPixel(x, y) != b.getPixel(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int testRoundTrip(NeoCodePageId codePage, unsigned seed) {
+    auto rng = std::mt19937{seed};
+    auto source = std::make_unique<NeoFont>();
+    source->setCodePage(codePage);
+    source->setHeight(3 + rng() % 20);
+    for (auto &c : *source) {
+        randomGlyph(c, rng, 40, 3);
+    }
+
+    auto text = std::stringstream{};
+    if (!exportBdf(*source, text)) {
+        return fail("export failed");
+    }
+    auto imported = std::make_unique<NeoFont>();
+    imported->setCodePage(codePage);
+    auto info = NeoBdfInfo{};
+    if (!importBdf(text, *imported, &info)) {
+        return fail("import failed");
+    }
+    if (imported->height() != source->height()) {
+        return fail("height differs");
+    }
+    if (info.glyphCount != static_cast<int>(NeoFont::charCount) ||
+        info.mappedCharacters != static_cast<int>(NeoFont::charCount)) {
+        return fail("not every glyph was mapped");
+    }
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        if (!samePixels(source->character(i), imported->character(i))) {
+            return fail("round trip mismatch", i);
+        }
+    }
+
+    // The same text read from memory, as the tools do, after detecting the
+    // format from the contents.
+    auto bytes = text.str();
+    auto data = NeoSpan<const uint8_t>{
+        reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size()};
+    auto applet = source->encodeApplet();
+    auto appletData = NeoSpan<const uint8_t>{
+        reinterpret_cast<const uint8_t *>(applet.data()), applet.size()};
+    if (detectFontFormat(data) != NeoFontFormat::Bdf ||
+        detectFontFormat(appletData) != NeoFontFormat::Applet) {
+        return fail("format not detected");
+    }
+    auto fromMemory = std::make_unique<NeoFont>();
+    fromMemory->setCodePage(codePage);
+    if (!importFont(data, NeoFontFormat::Bdf, *fromMemory)) {
+        return fail("import from memory failed");
+    }
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        if (!samePixels(source->character(i), fromMemory->character(i))) {
+            return fail("round trip from memory mismatch", i);
+        }
+    }
+    return 0;
+}
+
+int testOffsets() {
+    // Glyph 'A' is 4 pixels wide, its bitmap is moved 2 columns left, so
+    // only the right half is left. Glyph 'B' is moved 3 columns right.
+    auto text = std::stringstream{"STARTFONT 2.1\n"
+                                  "FONTBOUNDINGBOX 8 2 0 0\n"
+                                  "FONT_ASCENT 2\n"
+                                  "FONT_DESCENT 0\n"
+                                  "CHARS 2\n"
+                                  "STARTCHAR A\n"
+                                  "ENCODING 65\n"
+                                  "DWIDTH 4 0\n"
+                                  "BBX 4 2 -2 0\n"
+                                  "BITMAP\n"
+                                  "A0\n"
+                                  "50\n"
+                                  "ENDCHAR\n"
+                                  "STARTCHAR B\n"
+                                  "ENCODING 66\n"
+                                  "DWIDTH 8 0\n"
+                                  "BBX 4 1 3 1\n"
+                                  "BITMAP\n"
+                                  "90\n"
+                                  "ENDCHAR\n"
+                                  "ENDFONT\n"};
+    auto font = std::make_unique<NeoFont>();
+    if (!importBdf(text, *font)) {
+        return fail("offset import failed");
+    }
+    // Rows of 'A' are 1010 and 0101 before cropping.
+    const char *expectA[] = {"1000", "0100"};
+    auto &a = font->character('A');
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            if (a.getPixel(x, y) != (expectA[y][x] == '1')) {
+                return fail("negative x offset not cropped");
+            }
+        }
+    }
+    const char *expectB[] = {"00010010", "00000000"};
+    auto &b = font->character('B');
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            if (b.getPixel(x, y) != (expectB[y][x] == '1')) {
+                return fail("positive x offset misplaced");
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    for (unsigned seed = 1; seed <= 4; ++seed) {
+        if (testRoundTrip(neoCodePageNeo, seed) ||
+            testRoundTrip(neoCodePageControl, seed)) {
+            return 1;
+        }
+    }
+    return testOffsets();
+}
@@ -0,0 +1,115 @@
+// Runs neo_font_daemon on a temporary socket and checks, through
+// DaemonClient, that a render too large for one response is refused while
+// the connection stays usable.
+
+#include "Client.h"
+#include "TestSupport.h"
+#include "neofontlib/NeoFont.h"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const auto fail = TestFailure{"test_daemon"};
+
+/// Start the daemon and connect to it once it listens.
+pid_t startDaemon(const char *path,
+                  const std::string &socket,
+                  DaemonClient &client) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(path,
+              path,
+              "--socket",
+              socket.c_str(),
+              static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    for (int attempt = 0; pid > 0 && attempt < 500; ++attempt) {
+        if (client.connect(socket)) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pid;
+}
+
+bool request(DaemonClient &client, DaemonResponse &response) {
+    return client.flush() && client.receive(response);
+}
+
+int run(DaemonClient &client) {
+    // The widest characters at the greatest height.
+    auto font = std::make_unique<NeoFont>();
+    font->setHeight(NeoCharacter::maxHexght);
+    for (auto &c : *font) {
+        c.setWidth(NeoCharacter::maxWidth);
+        c.setPixel(0, 0);
+    }
+    auto applet = font->encodeApplet();
+    auto source = std::vector<uint8_t>(applet.begin(), applet.end());
+
+    uint64_t key = 0;
+    client.decode("wide", source, &key);
+    auto response = DaemonResponse{};
+    if (!request(client, response) || !response.ok()) {
+        return fail("decode failed");
+    }
+
+    // A line under the 0xffff pixel width limit, and enough lines to go
+    // over daemonMaxPayload.
+    auto codes = std::vector<uint8_t>(511, 'A');
+    int lines = static_cast<int>(daemonMaxPayload / (511 * 16) /
+                                 NeoCharacter::maxHexght) +
+                2;
+    for (int line = 1; line < lines; ++line) {
+        codes.push_back(10);
+        codes.push_back('A');
+    }
+    client.render(key, codes);
+    if (!request(client, response)) {
+        return fail("connection dropped by a large render");
+    }
+    if (response.header.status != DaemonStatus::BadRequest) {
+        return fail("large render was not refused");
+    }
+
+    codes.assign(3, 'A');
+    client.render(key, codes);
+    if (!request(client, response) || !response.ok() ||
+        response.payload.size() != 4 + 48 * NeoCharacter::maxHexght) {
+        return fail("render after a refused render failed");
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: test_daemon <neo_font_daemon>\n";
+        return 2;
+    }
+    auto socket = std::string{"/tmp/neo_font_daemon_test."} +
+                  std::to_string(getpid()) + ".sock";
+    auto client = DaemonClient{};
+    pid_t pid = startDaemon(argv[1], socket, client);
+    if (pid < 0) {
+        return fail("could not start the daemon");
+    }
+
+    int result = client.connected() ? run(client) : fail("could not connect");
+    client.close();
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    unlink(socket.c_str());
+    return result;
+}
@@ -0,0 +1,112 @@
+// Checks that font and applet deltas reproduce the new version exactly and
+// are refused by any other base.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoDelta.h"
+#include "neofontlib/NeoFont.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const auto fail = TestFailure{"test_delta", "round"};
+
+/** Edit a copy of a font: a few glyphs, widths, pixels and sometimes the
+ * height or the metadata.
+ */
+void mutate(NeoFont &font, std::mt19937 &rng) {
+    for (int n = rng() % 8; n > 0; --n) {
+        auto &c = font.character(rng() % NeoFont::charCount);
+        switch (rng() % 3) {
+        case 0:
+            randomGlyph(c, rng, 24);
+            break;
+        case 1:
+            c.setWidth(1 + rng() % 24);
+            break;
+        default:
+            c.flipPixel(rng() % c.width(), rng() % c.height());
+            break;
+        }
+    }
+    if (rng() % 8 == 0) {
+        font.setHeight(4 + rng() % 16);
+    }
+    if (rng() % 8 == 0) {
+        font.setFontName(rng() % 2 ? "Renamed" : "Other name");
+        font.setIdent(static_cast<int>(0xa000 + rng() % 256));
+    }
+}
+
+bool sameApplet(const NeoFont &a, const NeoFont &b) {
+    return a.encodeApplet() == b.encodeApplet();
+}
+
+} // namespace
+
+int main() {
+    auto rng = std::mt19937{36};
+    auto from = std::make_unique<NeoFont>();
+    from->setHeight(12);
+    for (auto &c : *from) {
+        randomGlyph(c, rng, 24);
+    }
+
+    auto to = std::make_unique<NeoFont>();
+    auto patched = std::make_unique<NeoFont>();
+    auto other = std::make_unique<NeoFont>();
+    auto buffer = NeoAppletBuffer{};
+    for (int round = 0; round < 200; ++round) {
+        *to = *from;
+        mutate(*to, rng);
+        auto delta = makeFontDelta(*from, *to);
+
+        *patched = *from;
+        if (!applyFontDelta(*patched, delta) ||
+            !diffFonts(*patched, *to).empty() || !sameApplet(*patched, *to)) {
+            return fail("font delta did not reproduce the new font", round);
+        }
+
+        auto applet = from->encodeApplet();
+        auto bytes = NeoSpan<const uint8_t>{
+            reinterpret_cast<const uint8_t *>(applet.data()), applet.size()};
+        auto expected = to->encodeApplet();
+        auto result = NeoSpan<const uint8_t>{};
+        if (!applyAppletDelta(bytes, delta, buffer) ||
+            (result = buffer.bytes()).size() != expected.size() ||
+            memcmp(result.data(), expected.data(), expected.size())) {
+            return fail("applet delta did not reproduce the new applet",
+                        round);
+        }
+
+        // Any other base is refused and left as it was.
+        *other = *from;
+        other->character(rng() % NeoFont::charCount).flipPixel(0, 0);
+        auto before = other->encodeApplet();
+        if (applyFontDelta(*other, delta) || other->encodeApplet() != before) {
+            return fail("delta applied to the wrong base", round);
+        }
+        if (delta.size() > 4) {
+            auto truncated = NeoSpan<const uint8_t>{delta}.first(
+                delta.size() - 1 - rng() % (delta.size() - 4));
+            *patched = *from;
+            if (applyFontDelta(*patched, truncated) ||
+                !sameApplet(*patched, *from)) {
+                return fail("truncated delta was applied", round);
+            }
+        }
+
+        *from = *to;
+    }
+
+    // An empty change still makes a delta that applies.
+    auto delta = makeFontDelta(*from, *from);
+    *patched = *from;
+    if (!applyFontDelta(*patched, delta) || !sameApplet(*patched, *from)) {
+        return fail("empty delta failed");
+    }
+    return 0;
+}
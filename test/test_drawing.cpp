@@ -0,0 +1,206 @@
+// Checks the row based drawing primitives of NeoCharacter, and the rows they
+// report as changed, against per pixel reference implementations.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoCharacter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const auto fail = TestFailure{"test_drawing", "step"};
+
+/** Changes pixels one at a time and records the rows of the pixels inside
+ * the character, as the primitives report them.
+ */
+struct Reference {
+    NeoCharacter &c;
+    NeoRowRange dirty;
+
+    void change(int x, int y, int v) {
+        if (x >= 0 && x < c.width() && y >= 0 && y < c.height()) {
+            c.changePixel(x, y, v);
+            dirty.include(y);
+        }
+    }
+
+    void line(int x0, int y0, int x1, int y1, int v) {
+        int dx = abs(x1 - x0);
+        int dy = -abs(y1 - y0);
+        int sx = x0 < x1 ? 1 : -1;
+        int sy = y0 < y1 ? 1 : -1;
+        int err = dx + dy;
+        for (;;) {
+            change(x0, y0, v);
+            if (x0 == x1 && y0 == y1) {
+                break;
+            }
+            int e2 = 2 * err;
+            if (e2 >= dy) {
+                err += dy;
+                x0 += sx;
+            }
+            if (e2 <= dx) {
+                err += dx;
+                y0 += sy;
+            }
+        }
+    }
+
+    void rect(int x, int y, int w, int h, int v, bool fill) {
+        for (int py = y; py < y + h; ++py) {
+            for (int px = x; px < x + w; ++px) {
+                bool edge = px == x || px == x + w - 1 || py == y ||
+                            py == y + h - 1;
+                if (fill || edge) {
+                    change(px, py, v);
+                }
+            }
+        }
+    }
+
+    void flood(int x, int y, int v) {
+        if (x < 0 || x >= c.width() || y < 0 || y >= c.height()) {
+            return;
+        }
+        int value = c.getPixel(x, y);
+        int target = v > 0 ? 1 : v == 0 ? 0 : !value;
+        if (target == value) {
+            return;
+        }
+        auto stack = std::vector<std::pair<int, int>>{{x, y}};
+        while (!stack.empty()) {
+            auto [px, py] = stack.back();
+            stack.pop_back();
+            if (px < 0 || px >= c.width() || py < 0 || py >= c.height() ||
+                c.getPixel(px, py) != value) {
+                continue;
+            }
+            change(px, py, target);
+            stack.push_back({px - 1, py});
+            stack.push_back({px + 1, py});
+            stack.push_back({px, py - 1});
+            stack.push_back({px, py + 1});
+        }
+    }
+
+    void paste(const NeoCharacter &source,
+               int sx,
+               int sy,
+               int w,
+               int h,
+               int x,
+               int y) {
+        // Read the source first, it may be the same character.
+        auto copy = source;
+        for (int j = 0; j < h; ++j) {
+            for (int i = 0; i < w; ++i) {
+                int px = sx + i;
+                int py = sy + j;
+                if (px >= 0 && px < copy.width() && py >= 0 &&
+                    py < copy.height()) {
+                    change(x + i, y + j, copy.getPixel(px, py));
+                }
+            }
+        }
+    }
+};
+
+/** A character of random size with random pixels, also outside its width,
+ * where the primitives must not write.
+ */
+void randomCharacter(NeoCharacter &c, std::mt19937 &rng) {
+    c.setHeight(NeoCharacter::maxHexght);
+    int density = 1 + static_cast<int>(rng() % 4);
+    randomGlyph(c, rng, NeoCharacter::maxWidth, density);
+    c.setHeight(1 + rng() % NeoCharacter::maxHexght);
+}
+
+bool sameRange(NeoRowRange a, NeoRowRange b) {
+    return a.empty() ? b.empty() : a.from == b.from && a.to == b.to;
+}
+
+} // namespace
+
+int main() {
+    auto rng = std::mt19937{43};
+    auto c = NeoCharacter{};
+    auto expected = NeoCharacter{};
+    auto source = NeoCharacter{};
+    const char *names[] = {
+        "drawLine", "drawRect", "fillRect", "floodFill", "paste", "paste self"};
+
+    for (int step = 0; step < 20000; ++step) {
+        if (step % 16 == 0) {
+            randomCharacter(c, rng);
+        }
+        expected = c;
+        auto reference = Reference{expected, {}};
+
+        // Coordinates reach past every edge, so clipping is covered too.
+        auto coord = [&](int size) {
+            return static_cast<int>(rng() % (size + 20)) - 10;
+        };
+        int v = static_cast<int>(rng() % 3) - 1;
+        int operation = static_cast<int>(rng() % 6);
+        auto dirty = NeoRowRange{};
+        switch (operation) {
+        case 0: {
+            int x0 = coord(c.width());
+            int y0 = coord(c.height());
+            int x1 = coord(c.width());
+            int y1 = coord(c.height());
+            dirty = c.drawLine(x0, y0, x1, y1, v);
+            reference.line(x0, y0, x1, y1, v);
+            break;
+        }
+        case 1:
+        case 2: {
+            int x = coord(c.width());
+            int y = coord(c.height());
+            int w = static_cast<int>(rng() % (c.width() + 10)) - 2;
+            int h = static_cast<int>(rng() % (c.height() + 10)) - 2;
+            bool fill = operation == 2;
+            dirty = fill ? c.fillRect(x, y, w, h, v)
+                         : c.drawRect(x, y, w, h, v);
+            reference.rect(x, y, w, h, v, fill);
+            break;
+        }
+        case 3: {
+            int x = coord(c.width());
+            int y = coord(c.height());
+            dirty = c.floodFill(x, y, v);
+            reference.flood(x, y, v);
+            break;
+        }
+        default: {
+            bool self = operation == 5;
+            if (!self) {
+                randomCharacter(source, rng);
+            }
+            auto &from = self ? c : source;
+            int sx = coord(from.width());
+            int sy = coord(from.height());
+            int w = static_cast<int>(rng() % (from.width() + 10)) - 2;
+            int h = static_cast<int>(rng() % (from.height() + 10)) - 2;
+            int x = coord(c.width());
+            int y = coord(c.height());
+            // The reference reads the source before expected is changed.
+            reference.paste(self ? expected : source, sx, sy, w, h, x, y);
+            dirty = c.paste(from, sx, sy, w, h, x, y);
+            break;
+        }
+        }
+
+        if (!sameRows(c, expected)) {
+            return fail(names[operation], "pixels differ", step);
+        }
+        if (!sameRange(dirty, reference.dirty)) {
+            return fail(names[operation], "changed rows differ", step);
+        }
+    }
+    return 0;
+}
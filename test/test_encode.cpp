@@ -0,0 +1,102 @@
+// Checks the applet bitmap packing against a per pixel reference packer, for
+// every font height and character width, serially and with threads.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoFont.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const auto fail = TestFailure{"test_encode", "height"};
+
+/** The applet bitmap of one character, a pixel at a time: for each band of
+ * eight rows, one byte per column with the top row of the band in bit 0.
+ */
+void referencePack(const NeoCharacter &c,
+                   int height,
+                   std::vector<uint8_t> &out) {
+    int width = c.width();
+    int bands = (height + 7) / 8;
+    for (int byte = 0; byte < bands * width; ++byte) {
+        unsigned b = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            int x = byte % width;
+            int y = bit + byte / width * 8;
+            if (y < height && c.getPixel(x, y)) {
+                b |= 1u << bit;
+            }
+        }
+        out.push_back(static_cast<uint8_t>(b));
+    }
+}
+
+uint32_t bigEndian32(const uint8_t *p) {
+    return uint32_t{p[0]} << 24 | uint32_t{p[1]} << 16 | uint32_t{p[2]} << 8 |
+           p[3];
+}
+
+/** A font of the given height where character i is 1 + (i + seed) % 128
+ * wide, so all widths occur. Pixels are also set outside the final width
+ * and height, which the packer must ignore.
+ */
+void randomFont(NeoFont &font, int height, unsigned seed) {
+    auto rng = std::mt19937{seed};
+    font.setHeight(NeoCharacter::maxHexght);
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &c = font.character(i);
+        randomGlyph(c, rng, NeoCharacter::maxWidth, 3);
+        c.setWidth(1 + (i + seed) % NeoCharacter::maxWidth);
+    }
+    font.setHeight(height);
+}
+
+} // namespace
+
+int main() {
+    auto font = std::make_unique<NeoFont>();
+    auto serial = NeoEncodeOptions{};
+    serial.threads = 1;
+    auto threaded = NeoEncodeOptions{};
+    threaded.threads = 4;
+    threaded.parallelThreshold = 0;
+
+    for (int height = 1; height <= static_cast<int>(NeoCharacter::maxHexght);
+         ++height) {
+        randomFont(*font, height, static_cast<unsigned>(height));
+
+        auto expected = std::vector<uint8_t>{};
+        for (auto &c : *font) {
+            referencePack(c, height, expected);
+        }
+
+        for (auto &options : {serial, threaded}) {
+            auto applet = std::vector<uint8_t>(font->appletSize());
+            if (font->encodeApplet(NeoSpan<uint8_t>{applet}, options) !=
+                applet.size()) {
+                return fail("encode failed", height);
+            }
+            // The font information table is followed by the 4 byte magic,
+            // the offset of the bitmaps is its last field.
+            auto info = applet.data() + applet.size() - 20;
+            auto bitmaps = bigEndian32(info + 12);
+            if (bitmaps + expected.size() > applet.size() ||
+                !std::equal(expected.begin(),
+                            expected.end(),
+                            applet.begin() + bitmaps)) {
+                return fail(options.threads == 1
+                                ? "serial packing differs from reference"
+                                : "threaded packing differs from reference",
+                            height);
+            }
+        }
+
+        auto serialApplet = font->encodeApplet(serial);
+        if (font->encodeApplet(threaded) != serialApplet) {
+            return fail("threaded applet differs from serial", height);
+        }
+    }
+    return 0;
+}
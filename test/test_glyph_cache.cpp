@@ -0,0 +1,69 @@
+// Checks that text drawn through NeoGlyphCache matches
+// NeoBitmap::drawCharacter(), including clipping, atlas evictions and
+// invalidated characters.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoBitmap.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoGlyphCache.h"
+#include <cstring>
+#include <memory>
+#include <random>
+
+namespace {
+
+const auto fail = TestFailure{"test_glyph_cache", "round"};
+
+/// Some glyphs are blank, others have ink only in a few rows.
+void randomSparseGlyph(NeoCharacter &c, std::mt19937 &rng) {
+    randomGlyph(c, rng, 40, static_cast<int>(rng() % 4) * 2);
+    int top = rng() % c.height();
+    int bottom = top + rng() % (c.height() - top);
+    for (int y = 0; y < c.height(); ++y) {
+        if (y < top || y > bottom) {
+            memset(c.row(y), 0, NeoCharacter::rowBytes);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    auto rng = std::mt19937{45};
+    auto font = std::make_unique<NeoFont>();
+    font->setHeight(14);
+    for (auto &c : *font) {
+        randomSparseGlyph(c, rng);
+    }
+
+    // A small atlas, so that it fills up and starts over.
+    auto cache = NeoGlyphCache{*font, 4096};
+    for (int round = 0; round < 8000; ++round) {
+        int width = 1 + rng() % 200;
+        int height = 1 + rng() % 40;
+        auto drawn = NeoBitmap{width, height};
+        auto expected = NeoBitmap{width, height};
+        for (int n = rng() % 12; n > 0; --n) {
+            int code = rng() % NeoFont::charCount;
+            int x = static_cast<int>(rng() % (width + 60)) - 45;
+            int y = static_cast<int>(rng() % (height + 30)) - 16;
+            cache.draw(drawn, code, x, y);
+            expected.drawCharacter(font->character(code), x, y);
+        }
+        if (drawn.data() != expected.data()) {
+            return fail("cached drawing differs from drawCharacter", round);
+        }
+
+        if (round % 50 == 0) {
+            int code = rng() % NeoFont::charCount;
+            randomSparseGlyph(font->character(code), rng);
+            cache.invalidate(code);
+        }
+    }
+
+    auto stats = cache.stats();
+    if (!stats.hits || !stats.misses || !stats.evictions) {
+        return fail("the atlas was not exercised", -1);
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Checks NeoBitmap::extractCharacter() against a per pixel reference,
+// including rectangles partly or wholly outside the image, and that glyphs
+// drawn in to a sheet are imported unchanged.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoBitmap.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoGlyphSheet.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+
+namespace {
+
+const auto fail = TestFailure{"test_glyph_sheet", "round"};
+
+/// What extractCharacter() should do, a pixel at a time.
+void referenceExtract(
+    const NeoBitmap &image, int x, int y, int w, int h, NeoCharacter &c) {
+    w = std::min(w, c.width());
+    h = std::min(h, c.height());
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    for (int cy = 0; cy < h; ++cy) {
+        memset(c.row(cy), 0, NeoCharacter::rowBytes);
+        for (int cx = 0; cx < w; ++cx) {
+            int sx = x + cx;
+            int sy = y + cy;
+            if (sx >= 0 && sx < image.width() && sy >= 0 &&
+                sy < image.height() && image.getPixel(sx, sy)) {
+                c.setPixel(cx, cy);
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    auto rng = std::mt19937{31};
+    auto c = NeoCharacter{};
+    auto expected = NeoCharacter{};
+    for (int round = 0; round < 20000; ++round) {
+        auto image = NeoBitmap{1 + static_cast<int>(rng() % 100),
+                               1 + static_cast<int>(rng() % 40)};
+        for (int y = 0; y < image.height(); ++y) {
+            for (int x = 0; x < image.width(); ++x) {
+                if (rng() % 3 == 0) {
+                    image.setPixel(x, y);
+                }
+            }
+        }
+
+        // Pixels left from earlier rounds, which rows outside the
+        // rectangle must keep.
+        c.setWidth(1 + rng() % NeoCharacter::maxWidth);
+        c.setHeight(1 + rng() % NeoCharacter::maxHexght);
+        expected = c;
+
+        // Rectangles reach past every edge, and start far enough left that
+        // whole bytes of them lie outside the image.
+        int x = static_cast<int>(rng() % (image.width() + 160)) - 140;
+        int y = static_cast<int>(rng() % (image.height() + 80)) - 70;
+        int w = static_cast<int>(rng() % 160) - 20;
+        int h = static_cast<int>(rng() % 80) - 6;
+        image.extractCharacter(x, y, w, h, c);
+        referenceExtract(image, x, y, w, h, expected);
+        if (!sameRows(c, expected)) {
+            return fail("extracted pixels differ from reference", round);
+        }
+    }
+
+    // Glyphs drawn in to the cells of a sheet come back unchanged.
+    auto font = std::make_unique<NeoFont>();
+    font->setHeight(11);
+    for (auto &glyph : *font) {
+        randomGlyph(glyph, rng, 14);
+    }
+    auto options = NeoGlyphSheetOptions{};
+    options.cellWidth = 16;
+    options.cellHeight = font->height();
+    options.rightBearing = 0;
+    auto sheet = NeoBitmap{options.columns * options.cellWidth,
+                           options.rows * options.cellHeight};
+    for (int code = 0; code < static_cast<int>(NeoFont::charCount); ++code) {
+        sheet.drawCharacter(font->character(code),
+                            code % options.columns * options.cellWidth,
+                            code / options.columns * options.cellHeight);
+    }
+    auto imported = std::make_unique<NeoFont>();
+    if (!importGlyphSheet(sheet, *imported, options) ||
+        imported->height() != font->height()) {
+        return fail("sheet was not imported");
+    }
+    for (int code = 0; code < static_cast<int>(NeoFont::charCount); ++code) {
+        auto &a = font->character(code);
+        auto &b = imported->character(code);
+        int ink = a.inkWidth();
+        if (b.width() != (ink ? ink : options.cellWidth / 2)) {
+            return fail("imported width is not the ink width");
+        }
+        for (int y = 0; y < a.height(); ++y) {
+            for (int x = 0; x < ink; ++x) {
+                if (a.getPixel(x, y) != b.getPixel(x, y)) {
+                    return fail("imported glyph differs");
+                }
+            }
+        }
+    }
+    return 0;
+}
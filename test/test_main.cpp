@@ -1,21 +1,9 @@
+#include "neofontlib/NeoAppletBuffer.h"
 #include "neofontlib/NeoFont.h"
-#include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 
-std::vector<char> loadFile(std::filesystem::path path) {
-    auto file = std::ifstream{path};
-
-    return std::vector<char>{std::istreambuf_iterator<char>{file}, {}};
-}
-
-template <typename T>
-void saveFile(std::filesystem::path path, const T &data) {
-    std::ofstream{path, std::ios::binary}.write(data.data(), data.size());
-}
-
 void printChar(NeoCharacter &character) {
     auto width = character.width();
     auto height = character.height();
@@ -35,13 +23,13 @@ int main(int argc, char *argv[]) {
 
     auto path = args.at(1);
 
-    auto content = loadFile(path);
-    if (content.empty()) {
+    auto buffer = NeoAppletBuffer{};
+    if (!buffer.load(path.c_str()) || !buffer.size()) {
         std::cerr << "could not load file " << path << "\n";
         return 1;
     }
 
-    font.decodeApplet(content);
+    buffer.decode(font);
 
     for (size_t i = 0; i < font.characters().size(); ++i) {
         std::cout << "character " << i << " " << static_cast<char>(i) << "\n";
@@ -49,9 +37,8 @@ int main(int argc, char *argv[]) {
         printChar(c);
     }
 
-    auto data = font.encodeApplet();
-
-    saveFile("test-output", data);
+    buffer.encode(font);
+    buffer.save("test-output");
 
     return 0;
 }
@@ -0,0 +1,97 @@
+// Checks that going over the memory cap asks the largest consumers to
+// release their memory, and the growing one last.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoMemory.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const auto fail = TestFailure{"test_memory"};
+
+class TestConsumer : public NeoMemoryConsumer {
+public:
+    TestConsumer()
+        : NeoMemoryConsumer("test") {}
+
+    using NeoMemoryConsumer::releaseRequested;
+    using NeoMemoryConsumer::setMemoryCharged;
+};
+
+} // namespace
+
+int main() {
+    setNeoMemoryCap(1000);
+    {
+        auto a = TestConsumer{};
+        auto b = TestConsumer{};
+        auto c = TestConsumer{};
+        a.setMemoryCharged(200);
+        b.setMemoryCharged(500);
+        c.setMemoryCharged(250);
+        if (a.releaseRequested() || b.releaseRequested() ||
+            c.releaseRequested()) {
+            return fail("release requested within the cap");
+        }
+
+        // a grows past the cap: b is the largest of the others and enough.
+        a.setMemoryCharged(400);
+        if (a.releaseRequested() || !b.releaseRequested() ||
+            c.releaseRequested()) {
+            return fail("the largest other consumer was not asked first");
+        }
+        b.setMemoryCharged(0);
+
+        // Releasing every other consumer is not enough, so a is asked too.
+        a.setMemoryCharged(1200);
+        if (!c.releaseRequested() || !a.releaseRequested()) {
+            return fail("the growing consumer was not asked last");
+        }
+        a.setMemoryCharged(0);
+        c.setMemoryCharged(0);
+
+        auto usage = neoMemoryUsage();
+        if (usage.total != 0 || usage.cap != 1000 ||
+            usage.groups.size() != 1 || strcmp(usage.groups[0].name, "test") ||
+            usage.groups[0].consumers != 3 || usage.releaseRequests != 3) {
+            return fail("usage totals are wrong");
+        }
+    }
+
+    // A single consumer going over the cap on its own must release.
+    {
+        auto only = TestConsumer{};
+        only.setMemoryCharged(1500);
+        if (!only.releaseRequested()) {
+            return fail("a single consumer over the cap was not asked");
+        }
+    }
+
+    // Consumers changing their sizes while others go over the cap.
+    {
+        auto consumers = std::vector<TestConsumer>(8);
+        auto threads = std::vector<std::thread>{};
+        for (size_t t = 0; t < consumers.size(); ++t) {
+            threads.emplace_back([&, t] {
+                auto &consumer = consumers[t];
+                for (size_t i = 0; i < 20000; ++i) {
+                    if (consumer.releaseRequested()) {
+                        consumer.setMemoryCharged(0);
+                    }
+                    consumer.setMemoryCharged((i * (t + 1)) % 400);
+                }
+                consumer.setMemoryCharged(0);
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    if (neoMemoryUsage().total != 0) {
+        return fail("total is not zero after every consumer released");
+    }
+    setNeoMemoryCap(0);
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Checks that NeoFont::patchApplet() after glyph edits gives the same bytes
+// as encoding the font again, and that it refuses the changes it cannot
+// patch in place.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoFont.h"
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const auto fail = TestFailure{"test_patch", "round"};
+
+bool sameBytes(NeoSpan<const uint8_t> applet, const std::vector<char> &fresh) {
+    auto same = [](uint8_t a, char b) { return a == static_cast<uint8_t>(b); };
+    return applet.size() == fresh.size() &&
+           std::equal(applet.begin(), applet.end(), fresh.begin(), same);
+}
+
+std::vector<uint8_t> encoded(const NeoFont &font) {
+    auto applet = std::vector<uint8_t>(font.appletSize());
+    font.encodeApplet(NeoSpan<uint8_t>{applet});
+    return applet;
+}
+
+/** Flip some pixels of a character, also right of its width where they
+ * are not encoded.
+ */
+NeoFontChanges editGlyph(NeoFont &font, int code, std::mt19937 &rng) {
+    return font.batch([&](NeoFontTransaction &tx) {
+        auto &c = tx.character(code);
+        for (int n = 1 + rng() % 8; n > 0; --n) {
+            c.flipPixel(rng() % (c.width() + 4), rng() % c.height());
+        }
+    });
+}
+
+} // namespace
+
+int main() {
+    auto rng = std::mt19937{47};
+    auto font = std::make_unique<NeoFont>();
+    font->setHeight(13);
+    for (auto &c : *font) {
+        randomGlyph(c, rng, 24);
+    }
+
+    auto applet = encoded(*font);
+    for (int round = 0; round < 2000; ++round) {
+        auto changes = editGlyph(*font, rng() % NeoFont::charCount, rng);
+        if (round % 10 == 0) {
+            // Several glyphs changed at once.
+            auto more = editGlyph(*font, rng() % NeoFont::charCount, rng);
+            changes.characters |= more.characters;
+        }
+        if (!font->patchApplet(NeoSpan<uint8_t>{applet}, changes)) {
+            return fail("glyph edit was not patched", round);
+        }
+        if (!sameBytes(NeoSpan<const uint8_t>{applet}, font->encodeApplet())) {
+            return fail("patched applet differs from a fresh encode", round);
+        }
+    }
+
+    // Edits that change the layout of the applet are refused, leaving the
+    // applet as it was, and NeoAppletBuffer encodes again instead.
+    auto buffer = NeoAppletBuffer{};
+    buffer.encode(*font);
+    for (int round = 0; round < 300; ++round) {
+        int code = rng() % NeoFont::charCount;
+        NeoFontChanges changes;
+        switch (round % 3) {
+        case 0: {
+            int width = font->character(code).width();
+            changes = font->batch([&](NeoFontTransaction &tx) {
+                tx.setWidth(code, 1 + (width + rng() % 20) % 24);
+            });
+            break;
+        }
+        case 1: {
+            int height = font->height();
+            changes = font->batch([&](NeoFontTransaction &tx) {
+                tx.setHeight(height % 16 + 1 + rng() % 3);
+            });
+            break;
+        }
+        default:
+            changes = font->batch([&](NeoFontTransaction &tx) {
+                tx.setIdent(1000 + round);
+            });
+            break;
+        }
+
+        auto before = applet;
+        if (font->patchApplet(NeoSpan<uint8_t>{applet}, changes)) {
+            return fail("layout change was patched", round);
+        }
+        if (applet != before) {
+            return fail("refused patch changed the applet", round);
+        }
+
+        bool patched = true;
+        auto bytes = buffer.update(*font, changes, &patched);
+        if (patched || !sameBytes(bytes, font->encodeApplet())) {
+            return fail("buffer was not encoded again", round);
+        }
+        applet = encoded(*font);
+    }
+
+    // An applet of another size is refused.
+    auto changes = editGlyph(*font, 'A', rng);
+    for (auto size : {applet.size() - 1, applet.size() + 1}) {
+        auto other = applet;
+        other.resize(size);
+        auto before = other;
+        if (font->patchApplet(NeoSpan<uint8_t>{other}, changes) ||
+            other != before) {
+            return fail("applet of the wrong size was patched");
+        }
+    }
+    return 0;
+}
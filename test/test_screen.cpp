@@ -0,0 +1,121 @@
+// Checks that the incremental redraw of NeoScreen matches a screen drawn from
+// scratch after every edit of a random script.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoScreen.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int screenWidth = 200;
+constexpr int screenRows = 6;
+
+const auto fail = TestFailure{"test_screen", "step"};
+
+/** Draw the document of a screen on a new screen. Codes are kept away from
+ * the line break, so the text can be split again.
+ */
+bool matchesFreshScreen(const NeoFont &font, const NeoScreen &screen) {
+    auto text = std::vector<uint8_t>{};
+    for (size_t i = 0; i < screen.lineCount(); ++i) {
+        if (i) {
+            text.push_back('\n');
+        }
+        auto line = screen.line(i);
+        text.insert(text.end(), line.begin(), line.end());
+    }
+    auto fresh = NeoScreen{font, screenWidth, screenRows};
+    fresh.assign(text);
+    fresh.scrollTo(screen.top());
+    fresh.render();
+
+    auto &a = screen.framebuffer();
+    auto &b = fresh.framebuffer();
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            if (a.getPixel(x, y) != b.getPixel(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    auto rng = std::mt19937{39};
+    auto font = std::make_unique<NeoFont>();
+    font->setHeight(9);
+    for (auto &c : *font) {
+        randomGlyph(c, rng, 11, 3);
+    }
+
+    auto screen = NeoScreen{*font, screenWidth, screenRows};
+    auto code = [&] { return static_cast<uint8_t>(32 + rng() % 200); };
+    for (int step = 0; step < 3000; ++step) {
+        auto lines = screen.lineCount();
+        auto line = rng() % lines;
+        auto column = rng() % (screen.line(line).size() + 1);
+        switch (rng() % 8) {
+        case 0:
+        case 1:
+        case 2:
+            screen.insert(line, column, code());
+            break;
+        case 3:
+            screen.erase(line, column);
+            break;
+        case 4:
+            screen.splitLine(line, column);
+            break;
+        case 5:
+            if (rng() % 2) {
+                screen.joinLine(line);
+            }
+            else {
+                screen.eraseLine(line);
+            }
+            break;
+        case 6: {
+            auto codes = std::vector<uint8_t>(rng() % 30);
+            for (auto &c : codes) {
+                c = code();
+            }
+            screen.insertLine(rng() % (lines + 1), codes);
+            break;
+        }
+        default:
+            screen.scrollTo(rng() % (lines + 2));
+            break;
+        }
+
+        if (screen.top() >= screen.lineCount()) {
+            return fail("scrolled past the last line", step);
+        }
+        screen.render();
+        if (!matchesFreshScreen(*font, screen)) {
+            return fail("incremental redraw differs", step);
+        }
+    }
+
+    // Erasing the last line while it is at the top.
+    screen.assign(NeoSpan<const uint8_t>{});
+    for (int i = 0; i < 3; ++i) {
+        auto codes = std::vector<uint8_t>(5, code());
+        screen.insertLine(screen.lineCount(), codes);
+    }
+    screen.scrollTo(screen.lineCount() - 1);
+    screen.eraseLine(screen.lineCount() - 1);
+    if (screen.top() >= screen.lineCount()) {
+        return fail("top left past the last line");
+    }
+    screen.render();
+    if (!matchesFreshScreen(*font, screen)) {
+        return fail("redraw after erasing the top line differs");
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+// Checks that edits made through NeoFont::batch() give the same font as the
+// same edits made one call at a time, and that the reported changes bring
+// caches of the font up to date.
+
+#include "TestSupport.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoHash.h"
+#include "neofontlib/NeoScreen.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const auto fail = TestFailure{"test_transaction", "script"};
+
+enum class Op {
+    Height,
+    Width,
+    Clear,
+    Pixel,
+    Name,
+    Ident,
+};
+
+struct Edit {
+    Op op;
+    int code;
+    int a;
+    int b;
+};
+
+std::vector<Edit> randomScript(std::mt19937 &rng) {
+    auto script = std::vector<Edit>(1 + rng() % 40);
+    for (auto &e : script) {
+        // Mostly pixel and width edits, as an editor would make.
+        static const Op ops[] = {Op::Height,
+                                 Op::Width,
+                                 Op::Width,
+                                 Op::Clear,
+                                 Op::Pixel,
+                                 Op::Pixel,
+                                 Op::Pixel,
+                                 Op::Pixel,
+                                 Op::Name,
+                                 Op::Ident};
+        e.op = ops[rng() % (sizeof ops / sizeof *ops)];
+        if (e.op == Op::Clear && rng() % 4) {
+            e.op = Op::Pixel;
+        }
+        e.code = rng() % NeoFont::charCount;
+        e.a = static_cast<int>(rng() % 140) - 4;
+        e.b = static_cast<int>(rng() % 72) - 2;
+    }
+    return script;
+}
+
+const char *names[] = {"Alpha", "Beta", "Gamma"};
+
+void applyDirect(NeoFont &font, const std::vector<Edit> &script) {
+    for (auto &e : script) {
+        switch (e.op) {
+        case Op::Height:
+            font.setHeight(e.b);
+            break;
+        case Op::Width:
+            font.character(e.code).setWidth(e.a);
+            break;
+        case Op::Clear:
+            font.clear();
+            break;
+        case Op::Pixel:
+            font.character(e.code).flipPixel(e.a, e.b);
+            break;
+        case Op::Name:
+            font.setFontName(names[e.code % 3]);
+            break;
+        case Op::Ident:
+            font.setIdent(e.a);
+            break;
+        }
+    }
+}
+
+void applyBatched(NeoFontTransaction &tx, const std::vector<Edit> &script) {
+    for (auto &e : script) {
+        switch (e.op) {
+        case Op::Height:
+            tx.setHeight(e.b);
+            break;
+        case Op::Width:
+            tx.setWidth(e.code, e.a);
+            break;
+        case Op::Clear:
+            tx.clear();
+            break;
+        case Op::Pixel:
+            tx.character(e.code).flipPixel(e.a, e.b);
+            break;
+        case Op::Name:
+            tx.setFontName(names[e.code % 3]);
+            break;
+        case Op::Ident:
+            tx.setIdent(e.a);
+            break;
+        }
+    }
+}
+
+/// Same height, metadata, widths and visible pixels in every character.
+bool sameFont(const NeoFont &a, const NeoFont &b) {
+    if (a.height() != b.height() || strcmp(a.fontName(), b.fontName()) ||
+        a.ident() != b.ident()) {
+        return false;
+    }
+    for (int i = 0; i < static_cast<int>(NeoFont::charCount); ++i) {
+        auto &ca = a.character(i);
+        auto &cb = b.character(i);
+        if (ca.width() != cb.width() || ca.height() != a.height() ||
+            cb.height() != b.height()) {
+            return false;
+        }
+        for (int y = 0; y < a.height(); ++y) {
+            for (int x = 0; x < ca.width(); ++x) {
+                if (ca.getPixel(x, y) != cb.getPixel(x, y)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool sameScreen(const NeoFont &font,
+                const NeoScreen &screen,
+                NeoSpan<const uint8_t> text) {
+    auto fresh = NeoScreen{font, screen.framebuffer().width(), screen.rows()};
+    fresh.assign(text);
+    fresh.render();
+    return fresh.framebuffer().height() == screen.framebuffer().height() &&
+           fresh.framebuffer().data() == screen.framebuffer().data();
+}
+
+} // namespace
+
+int main() {
+    auto rng = std::mt19937{44};
+    auto direct = std::make_unique<NeoFont>();
+    direct->setHeight(12);
+    for (auto &c : *direct) {
+        randomGlyph(c, rng, 16);
+    }
+    auto batched = std::make_unique<NeoFont>(*direct);
+
+    const uint8_t text[] = "The quick brown fox\njumps over\nthe lazy dog";
+    auto textSpan = NeoSpan<const uint8_t>{text, sizeof text - 1};
+    auto hasher = NeoFontHasher{};
+    hasher.fingerprint(*batched);
+    auto screen = NeoScreen{*batched, 160, 3};
+    screen.assign(textSpan);
+    screen.render();
+
+    for (int script = 0; script < 300; ++script) {
+        auto edits = randomScript(rng);
+        applyDirect(*direct, edits);
+        auto changes = batched->batch(
+            [&](NeoFontTransaction &tx) { applyBatched(tx, edits); });
+        if (!sameFont(*direct, *batched) ||
+            direct->encodeApplet() != batched->encodeApplet()) {
+            return fail("batched edits differ from direct edits", script);
+        }
+
+        hasher.invalidate(changes);
+        if (hasher.fingerprint(*batched) != neoFontHash(*batched)) {
+            return fail("incremental fingerprint is stale", script);
+        }
+        screen.invalidate(changes);
+        screen.render();
+        if (!sameScreen(*batched, screen, textSpan)) {
+            return fail("screen is stale after invalidate(changes)", script);
+        }
+    }
+
+    // A throwing edit leaves the edits before it committed, and every
+    // character at the font height.
+    batched->setHeight(10);
+    bool thrown = false;
+    try {
+        batched->batch([&](NeoFontTransaction &tx) {
+            tx.setHeight(20);
+            tx.character('A').setPixel(0, 19);
+            tx.character(300);
+        });
+    }
+    catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    if (!thrown || batched->height() != 20 ||
+        !batched->character('A').getPixel(0, 19)) {
+        return fail("edits before an exception were not committed");
+    }
+    for (auto &c : *batched) {
+        if (c.height() != batched->height()) {
+            return fail("character height differs after an exception");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+/** @file       BoundedQueue.h
+ *  @brief      Blocking queue with a fixed capacity, used between pipeline
+ * stages.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/** Multi producer, multi consumer queue. push() blocks while the queue is
+ * full, which is what gives the pipeline its backpressure. After close() the
+ * remaining items are drained and pop() then returns nothing.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(capacity ? capacity : 1) {}
+
+    /// @return false if the queue was closed before the item could be added.
+    bool push(T value) {
+        auto lock = std::unique_lock{m_mutex};
+        m_notFull.wait(lock, [this] {
+            return m_closed || m_items.size() < m_capacity;
+        });
+        if (m_closed) {
+            return false;
+        }
+        m_items.push_back(std::move(value));
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop() {
+        auto lock = std::unique_lock{m_mutex};
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) {
+            return std::nullopt;
+        }
+        auto value = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return value;
+    }
+
+    /// Non blocking variant of pop().
+    std::optional<T> tryPop() {
+        auto lock = std::unique_lock{m_mutex};
+        if (m_items.empty()) {
+            return std::nullopt;
+        }
+        auto value = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return value;
+    }
+
+    void close() {
+        {
+            auto lock = std::lock_guard{m_mutex};
+            m_closed = true;
+        }
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<T> m_items;
+    size_t m_capacity;
+    bool m_closed = false;
+};
@@ -0,0 +1,383 @@
+/** @file       FileIo.cc
+ *  @brief      Read and write stages of the conversion pipeline.
+ */
+
+#include "FileIo.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#ifdef NEOFONT_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string errorText(const std::string &what, int error) {
+    return what + ": " + strerror(error);
+}
+
+std::string temporaryPath(const std::string &path) {
+    return path + ".tmp";
+}
+
+/** Open an input and size the job buffer for it.
+ *
+ *  @return     The file descriptor, or -1 with job.error set.
+ */
+int openInput(ConvertJob &job) {
+    int fd = ::open(job.input.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        job.error = errorText(job.input, errno);
+        return -1;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        job.error = errorText(job.input, errno);
+        ::close(fd);
+        return -1;
+    }
+    job.data.resize(static_cast<size_t>(st.st_size));
+    return fd;
+}
+
+/** Blocking read of the rest of a file, starting at offset.
+ */
+bool readRest(int fd, std::vector<uint8_t> &data, size_t offset) {
+    while (offset < data.size()) {
+        auto n =
+            ::pread(fd, data.data() + offset, data.size() - offset, offset);
+        if (n <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeRest(int fd, const std::vector<uint8_t> &data, size_t offset) {
+    while (offset < data.size()) {
+        auto n =
+            ::pwrite(fd, data.data() + offset, data.size() - offset, offset);
+        if (n <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+int openOutput(ConvertJob &job) {
+    auto tmp = temporaryPath(job.output);
+    int fd =
+        ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        job.error = errorText(tmp, errno);
+    }
+    return fd;
+}
+
+/** Close a written temporary file and move it in to place.
+ */
+void finishOutput(ConvertJob &job, int fd, bool ok) {
+    auto tmp = temporaryPath(job.output);
+    if (::close(fd) != 0 && ok) {
+        job.error = errorText(tmp, errno);
+        ok = false;
+    }
+    if (ok && ::rename(tmp.c_str(), job.output.c_str()) != 0) {
+        job.error = errorText(job.output, errno);
+        ok = false;
+    }
+    if (!ok) {
+        if (job.error.empty()) {
+            job.error = errorText(tmp, errno ? errno : EIO);
+        }
+        ::unlink(tmp.c_str());
+    }
+}
+
+void readWithThreads(std::vector<ConvertJob> &jobs,
+                     BoundedQueue<ConvertJob> &out,
+                     StageStats &stats,
+                     int threadCount) {
+    auto next = std::atomic<size_t>{0};
+    auto worker = [&] {
+        for (size_t i; (i = next++) < jobs.size();) {
+            auto &job = jobs[i];
+            auto start = Clock::now();
+            int fd = openInput(job);
+            if (fd >= 0) {
+                if (!readRest(fd, job.data, 0)) {
+                    job.error = errorText(job.input, errno ? errno : EIO);
+                }
+                ::close(fd);
+            }
+            stats.add(job.data.size(), Clock::now() - start);
+            out.push(std::move(job));
+        }
+    };
+
+    auto threads = std::vector<std::thread>{};
+    for (int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+void writeWithThreads(BoundedQueue<ConvertJob> &in,
+                      std::vector<ConvertJob> &results,
+                      StageStats &stats,
+                      int threadCount) {
+    auto worker = [&] {
+        while (auto job = in.pop()) {
+            auto start = Clock::now();
+            if (job->error.empty()) {
+                int fd = openOutput(*job);
+                if (fd >= 0) {
+                    finishOutput(*job, fd, writeRest(fd, job->data, 0));
+                }
+            }
+            stats.add(job->data.size(), Clock::now() - start);
+            job->data = {};
+            results.at(job->index) = std::move(*job);
+        }
+    };
+
+    auto threads = std::vector<std::thread>{};
+    for (int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+#ifdef NEOFONT_HAVE_LIBURING
+
+/** A request in flight on the ring.
+ */
+struct UringSlot {
+    explicit UringSlot(ConvertJob j)
+        : job(std::move(j))
+        , start(Clock::now()) {}
+
+    ConvertJob job;
+    int fd = -1;
+    Clock::time_point start;
+};
+
+void readWithUring(std::vector<ConvertJob> &jobs,
+                   BoundedQueue<ConvertJob> &out,
+                   StageStats &stats,
+                   int depth) {
+    io_uring ring;
+    if (io_uring_queue_init(static_cast<unsigned>(depth), &ring, 0) != 0) {
+        readWithThreads(jobs, out, stats, depth);
+        return;
+    }
+
+    size_t next = 0;
+    int inFlight = 0;
+    while (next < jobs.size() || inFlight) {
+        // Keep the ring full.
+        while (next < jobs.size() && inFlight < depth) {
+            auto slot = new UringSlot{std::move(jobs[next++])};
+            slot->fd = openInput(slot->job);
+            auto sqe = slot->fd < 0 ? nullptr : io_uring_get_sqe(&ring);
+            if (!sqe) {
+                if (slot->fd >= 0) {
+                    // Ring full, which should not happen at this depth
+                    readRest(slot->fd, slot->job.data, 0);
+                    ::close(slot->fd);
+                }
+                stats.add(slot->job.data.size(), Clock::now() - slot->start);
+                out.push(std::move(slot->job));
+                delete slot;
+                continue;
+            }
+            io_uring_prep_read(sqe,
+                               slot->fd,
+                               slot->job.data.data(),
+                               static_cast<unsigned>(slot->job.data.size()),
+                               0);
+            io_uring_sqe_set_data(sqe, slot);
+            ++inFlight;
+        }
+        io_uring_submit(&ring);
+
+        if (!inFlight) {
+            continue;
+        }
+
+        io_uring_cqe *cqe = nullptr;
+        if (io_uring_wait_cqe(&ring, &cqe) != 0) {
+            continue;
+        }
+        auto slot = static_cast<UringSlot *>(io_uring_cqe_get_data(cqe));
+        int res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+        --inFlight;
+
+        if (res < 0) {
+            slot->job.error = errorText(slot->job.input, -res);
+        }
+        else if (!readRest(
+                     slot->fd, slot->job.data, static_cast<size_t>(res))) {
+            // Short reads are completed synchronously
+            slot->job.error = errorText(slot->job.input, errno ? errno : EIO);
+        }
+        ::close(slot->fd);
+        stats.add(slot->job.data.size(), Clock::now() - slot->start);
+        out.push(std::move(slot->job));
+        delete slot;
+    }
+
+    io_uring_queue_exit(&ring);
+}
+
+void writeWithUring(BoundedQueue<ConvertJob> &in,
+                    std::vector<ConvertJob> &results,
+                    StageStats &stats,
+                    int depth) {
+    io_uring ring;
+    if (io_uring_queue_init(static_cast<unsigned>(depth), &ring, 0) != 0) {
+        writeWithThreads(in, results, stats, depth);
+        return;
+    }
+
+    auto complete = [&](UringSlot *slot, bool ok) {
+        if (slot->fd >= 0) {
+            finishOutput(slot->job, slot->fd, ok);
+        }
+        stats.add(slot->job.data.size(), Clock::now() - slot->start);
+        slot->job.data = {};
+        results.at(slot->job.index) = std::move(slot->job);
+        delete slot;
+    };
+
+    int inFlight = 0;
+    bool closed = false;
+    while (!closed || inFlight) {
+        // Only block on the queue when there is nothing to reap.
+        while (!closed && inFlight < depth) {
+            auto job = inFlight ? in.tryPop() : in.pop();
+            if (!job) {
+                closed = !inFlight;
+                break;
+            }
+            auto slot = new UringSlot{std::move(*job)};
+            if (!slot->job.error.empty() ||
+                (slot->fd = openOutput(slot->job)) < 0) {
+                complete(slot, false);
+                continue;
+            }
+            auto sqe = io_uring_get_sqe(&ring);
+            if (!sqe) {
+                complete(slot, writeRest(slot->fd, slot->job.data, 0));
+                continue;
+            }
+            io_uring_prep_write(sqe,
+                                slot->fd,
+                                slot->job.data.data(),
+                                static_cast<unsigned>(slot->job.data.size()),
+                                0);
+            io_uring_sqe_set_data(sqe, slot);
+            ++inFlight;
+        }
+        io_uring_submit(&ring);
+
+        if (!inFlight) {
+            continue;
+        }
+
+        io_uring_cqe *cqe = nullptr;
+        if (io_uring_wait_cqe(&ring, &cqe) != 0) {
+            continue;
+        }
+        auto slot = static_cast<UringSlot *>(io_uring_cqe_get_data(cqe));
+        int res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+        --inFlight;
+
+        if (res < 0) {
+            slot->job.error = errorText(temporaryPath(slot->job.output), -res);
+            complete(slot, false);
+        }
+        else {
+            complete(slot,
+                     writeRest(slot->fd,
+                               slot->job.data,
+                               static_cast<size_t>(res)));
+        }
+    }
+
+    io_uring_queue_exit(&ring);
+}
+
+#endif
+
+} // namespace
+
+bool uringAvailable() {
+#ifdef NEOFONT_HAVE_LIBURING
+    io_uring ring;
+    if (io_uring_queue_init(1, &ring, 0) != 0) {
+        return false;
+    }
+    io_uring_queue_exit(&ring);
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char *ioBackendName(IoBackend backend) {
+    return backend == IoBackend::Uring ? "io_uring" : "threads";
+}
+
+void readFiles(IoBackend backend,
+               std::vector<ConvertJob> jobs,
+               BoundedQueue<ConvertJob> &out,
+               StageStats &stats,
+               int depth) {
+    if (depth < 1) {
+        depth = 1;
+    }
+#ifdef NEOFONT_HAVE_LIBURING
+    if (backend == IoBackend::Uring) {
+        readWithUring(jobs, out, stats, depth);
+        return;
+    }
+#endif
+    (void)backend;
+    readWithThreads(jobs, out, stats, depth);
+}
+
+void writeFiles(IoBackend backend,
+                BoundedQueue<ConvertJob> &in,
+                std::vector<ConvertJob> &results,
+                StageStats &stats,
+                int depth) {
+    if (depth < 1) {
+        depth = 1;
+    }
+#ifdef NEOFONT_HAVE_LIBURING
+    if (backend == IoBackend::Uring) {
+        writeWithUring(in, results, stats, depth);
+        return;
+    }
+#endif
+    (void)backend;
+    writeWithThreads(in, results, stats, depth);
+}
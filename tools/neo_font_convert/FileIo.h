@@ -0,0 +1,39 @@
+/** @file       FileIo.h
+ *  @brief      Read and write stages of the conversion pipeline.
+ */
+
+#pragma once
+
+#include "BoundedQueue.h"
+#include "Pipeline.h"
+
+enum class IoBackend {
+    Threads, /**< Blocking POSIX calls on a small thread pool. */
+    Uring,   /**< io_uring, with several requests in flight. */
+};
+
+/// True if the tool was built with liburing and the kernel accepts a ring.
+bool uringAvailable();
+
+const char *ioBackendName(IoBackend backend);
+
+/** Read the input of every job and push it to out. Blocks until all jobs have
+ * been read, but does not close out.
+ *
+ *  @param  depth   Number of threads, or requests in flight for io_uring.
+ */
+void readFiles(IoBackend backend,
+               std::vector<ConvertJob> jobs,
+               BoundedQueue<ConvertJob> &out,
+               StageStats &stats,
+               int depth);
+
+/** Write jobs popped from in to their output path (through a temporary file
+ * and a rename) until in is closed and drained. Finished jobs, including
+ * failed ones, are stored in results by index.
+ */
+void writeFiles(IoBackend backend,
+                BoundedQueue<ConvertJob> &in,
+                std::vector<ConvertJob> &results,
+                StageStats &stats,
+                int depth);
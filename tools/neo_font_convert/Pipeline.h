@@ -0,0 +1,37 @@
+/** @file       Pipeline.h
+ *  @brief      Work items and statistics shared by the conversion stages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** One file travelling through the pipeline.
+ */
+struct ConvertJob {
+    size_t index = 0;
+    std::string input;
+    std::string output;
+    std::vector<uint8_t> data;
+    std::string error; /**< Non empty if a stage failed. */
+};
+
+/** Throughput counters for one stage. Updated concurrently by the stage
+ * threads.
+ */
+struct StageStats {
+    std::atomic<uint64_t> items{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> busyNs{0}; /**< Summed over all stage threads. */
+
+    void add(uint64_t byteCount, std::chrono::steady_clock::duration busy) {
+        items += 1;
+        bytes += byteCount;
+        busyNs += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count());
+    }
+};
@@ -0,0 +1,97 @@
+/** @file       Watch.cc
+ *  @brief      Waiting for source fonts to be saved, using inotify.
+ */
+
+#include "Watch.h"
+#include <cerrno>
+#include <climits>
+#include <filesystem>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+FileWatcher::FileWatcher()
+    : m_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+FileWatcher::~FileWatcher() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+bool FileWatcher::add(const std::string &path) {
+    auto ec = std::error_code{};
+    bool all = std::filesystem::is_directory(path, ec);
+    auto p = std::filesystem::path{path};
+    auto directory = all ? p : p.parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+
+    // Adding a directory twice gives the same descriptor.
+    int wd = inotify_add_watch(m_fd,
+                               directory.c_str(),
+                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd < 0) {
+        return false;
+    }
+    auto &d = m_directories[wd];
+    d.path = directory.string();
+    if (all) {
+        d.all = true;
+    }
+    else {
+        d.names.insert(p.filename().string());
+    }
+    return true;
+}
+
+/** Read the pending events and add the watched paths they name.
+ */
+void FileWatcher::read(std::set<std::string> &changed) {
+    alignas(inotify_event) char buffer[sizeof(inotify_event) + NAME_MAX + 1];
+    for (;;) {
+        auto n = ::read(m_fd, buffer, sizeof buffer);
+        if (n <= 0) {
+            return;
+        }
+        for (ssize_t i = 0; i < n;) {
+            auto event = reinterpret_cast<const inotify_event *>(buffer + i);
+            i += sizeof(inotify_event) + event->len;
+
+            auto d = m_directories.find(event->wd);
+            if (d == m_directories.end() || !event->len) {
+                continue;
+            }
+            auto name = std::string{event->name};
+            // Skip the temporary files written next to the outputs.
+            if (std::filesystem::path{name}.extension() == ".tmp") {
+                continue;
+            }
+            if (d->second.all || d->second.names.count(name)) {
+                changed.insert(
+                    (std::filesystem::path{d->second.path} / name).string());
+            }
+        }
+    }
+}
+
+std::vector<std::string> FileWatcher::wait(int settleMs,
+                                           Clock::time_point &first) {
+    auto changed = std::set<std::string>{};
+    auto pfd = pollfd{m_fd, POLLIN, 0};
+    while (changed.empty()) {
+        if (::poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return {};
+        }
+        first = Clock::now();
+        read(changed);
+    }
+    while (::poll(&pfd, 1, settleMs) > 0) {
+        read(changed);
+    }
+    return {changed.begin(), changed.end()};
+}
@@ -0,0 +1,55 @@
+/** @file       Watch.h
+ *  @brief      Waiting for source fonts to be saved, using inotify.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/** Watches files, and directories of files, for writes. Editors often save by
+ * writing a new file and renaming it over the old one, which replaces the
+ * inode, so the directory holding each file is watched rather than the file
+ * itself.
+ */
+class FileWatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FileWatcher();
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+    ~FileWatcher();
+
+    /// @return false if inotify is not available.
+    bool ok() const {
+        return m_fd >= 0;
+    }
+
+    /// Watch a file, or every file in a directory. @return false on failure.
+    bool add(const std::string &path);
+
+    /** Block until a watched file is written or replaced, then keep
+     * collecting changes until none arrive for settleMs, since a save is
+     * often several writes.
+     *
+     *  @param  first   Set to when the first change was seen.
+     *  @return         The changed paths, sorted, or nothing on error.
+     */
+    std::vector<std::string> wait(int settleMs, Clock::time_point &first);
+
+private:
+    struct Directory {
+        std::string path;
+        bool all = false;            /**< Every file, not just names. */
+        std::set<std::string> names; /**< Files watched in the directory. */
+    };
+
+    void read(std::set<std::string> &changed);
+
+    int m_fd = -1;
+    std::map<int, Directory> m_directories; /**< By watch descriptor. */
+};
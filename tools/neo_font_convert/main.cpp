@@ -0,0 +1,867 @@
+/** @file       main.cpp
+ *  @brief      neo_font_convert: batch applet conversion pipeline.
+ *
+ *  read -> [queue] -> decode/transform/encode (worker pool) -> [queue] -> write
+ *
+ *  Every queue is bounded so a slow stage throttles the ones before it.
+ */
+
+#include "BoundedQueue.h"
+#include "FileIo.h"
+#include "Pipeline.h"
+#include "Watch.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoAppletCache.h"
+#include "neofontlib/NeoDelta.h"
+#include "neofontlib/NeoFitWidths.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoHash.h"
+#include "neofontlib/NeoImport.h"
+#include "neofontlib/NeoResample.h"
+#include "neofontlib/NeoSubset.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<int> cacheHits{0};
+
+/** Applet sizes before and after a size reducing pass, summed over every
+ * converted font for the summary.
+ */
+struct SizeTotals {
+    std::atomic<int> fonts{0};
+    std::atomic<int> characters{0}; /**< Characters the pass changed. */
+    std::atomic<uint64_t> before{0};
+    std::atomic<uint64_t> after{0};
+
+    void add(unsigned int sizeBefore, unsigned int sizeAfter, int changed) {
+        ++fonts;
+        characters += changed;
+        before += sizeBefore;
+        after += sizeAfter;
+    }
+
+    void print(const char *name, const char *changed) const {
+        fprintf(stderr,
+                "%s: %d fonts, %d characters %s, %llu -> %llu bytes (%llu "
+                "saved)\n",
+                name,
+                fonts.load(),
+                characters.load(),
+                changed,
+                static_cast<unsigned long long>(before.load()),
+                static_cast<unsigned long long>(after.load()),
+                static_cast<unsigned long long>(before - after));
+    }
+};
+
+SizeTotals subsetTotals;
+SizeTotals fitTotals;
+
+/// How long a save may keep writing before the watch mode converts it.
+constexpr int watchSettleMs = 20;
+
+enum class Transform {
+    Bold,
+    FlipH,
+    FlipV,
+};
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::string outputDir;
+    int height = 0; /**< Zero keeps the source height. */
+    std::optional<NeoResampleMode> resample;
+    std::vector<Transform> transforms;
+    std::optional<NeoCharacterHistogram> subset;
+    std::string subsetFile;
+    NeoCodePageId codePage = neoCodePageNeo;
+    bool fitWidths = false;
+    std::optional<NeoAppletCache> cache;
+    int jobs = 0;
+    int queue = 16;
+    int ioDepth = 8;
+    IoBackend io = IoBackend::Threads;
+    bool ioForced = false;
+    bool verify = false;
+    bool serial = false;
+    bool watch = false;
+};
+
+void printUsage(FILE *out) {
+    fputs(
+        "usage: neo_font_convert [options] -o <dir> <input>...\n"
+        "\n"
+        "Inputs are font applets (.OS3KApp), console fonts (.psf, .psf.gz),\n"
+        "BDF fonts (.bdf) or directories containing them.\n"
+        "\n"
+        "  -o, --output <dir>   directory for the converted applets\n"
+        "  --height <n>         set the font height\n"
+        "  --resample <mode>    scale to --height instead of cropping, with\n"
+        "                       nearest, box or scale2x\n"
+        "  --bold               embolden every character\n"
+        "  --flip-h, --flip-v   mirror every character\n"
+        "  --code-page <page>   map Unicode with a built in code page (neo,\n"
+        "                       control) or a mapping file\n"
+        "  --subset <file>      blank characters not used in a UTF-8 text\n"
+        "  --fit-widths         trim blank columns right of every glyph\n"
+        "  --cache <dir>        reuse applets encoded by earlier runs\n"
+        "  -j, --jobs <n>       worker threads (default: all cores)\n"
+        "  --queue <n>          capacity of each stage queue (default: 16)\n"
+        "  --io <threads|uring> I/O backend (default: uring if available)\n"
+        "  --io-depth <n>       I/O threads or requests in flight (default: "
+        "8)\n"
+        "  --serial             convert one file at a time, without the "
+        "pipeline\n"
+        "  --verify             check the output against serial conversion\n"
+        "  --watch              convert, then keep converting inputs again "
+        "as they\n"
+        "                       are saved\n",
+        out);
+}
+
+bool parseArgs(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string{argv[i]};
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "missing value for %s\n", arg.c_str());
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage(stdout);
+            exit(0);
+        }
+        else if (arg == "-o" || arg == "--output") {
+            auto v = value();
+            if (!v) {
+                return false;
+            }
+            options.outputDir = v;
+        }
+        else if (arg == "--height" || arg == "-j" || arg == "--jobs" ||
+                 arg == "--queue" || arg == "--io-depth") {
+            auto v = value();
+            if (!v) {
+                return false;
+            }
+            int n = atoi(v);
+            if (arg == "--height") {
+                options.height = n;
+            }
+            else if (arg == "--queue") {
+                options.queue = n;
+            }
+            else if (arg == "--io-depth") {
+                options.ioDepth = n;
+            }
+            else {
+                options.jobs = n;
+            }
+        }
+        else if (arg == "--bold") {
+            options.transforms.push_back(Transform::Bold);
+        }
+        else if (arg == "--flip-h") {
+            options.transforms.push_back(Transform::FlipH);
+        }
+        else if (arg == "--flip-v") {
+            options.transforms.push_back(Transform::FlipV);
+        }
+        else if (arg == "--resample") {
+            auto v = value();
+            if (!v) {
+                return false;
+            }
+            if (!strcmp(v, "nearest")) {
+                options.resample = NeoResampleMode::Nearest;
+            }
+            else if (!strcmp(v, "box")) {
+                options.resample = NeoResampleMode::Box;
+            }
+            else if (!strcmp(v, "scale2x")) {
+                options.resample = NeoResampleMode::Scale2x;
+            }
+            else {
+                fprintf(stderr, "unknown resample mode %s\n", v);
+                return false;
+            }
+        }
+        else if (arg == "--cache") {
+            auto v = value();
+            if (!v) {
+                return false;
+            }
+            options.cache.emplace(v);
+        }
+        else if (arg == "--fit-widths") {
+            options.fitWidths = true;
+        }
+        else if (arg == "--code-page") {
+            auto v = value();
+            if (!v) {
+                return false;
+            }
+            int id = findNeoCodePage(v);
+            if (id < 0) {
+                id = loadNeoCodePage(v, v);
+            }
+            if (id < 0) {
+                fprintf(stderr, "could not load code page %s\n", v);
+                return false;
+            }
+            options.codePage = static_cast<NeoCodePageId>(id);
+        }
+        else if (arg == "--subset") {
+            auto v = value();
+            if (!v) {
+                return false;
+            }
+            options.subsetFile = v;
+        }
+        else if (arg == "--io") {
+            auto v = value();
+            if (!v) {
+                return false;
+            }
+            options.ioForced = true;
+            if (!strcmp(v, "uring")) {
+                options.io = IoBackend::Uring;
+            }
+            else if (!strcmp(v, "threads")) {
+                options.io = IoBackend::Threads;
+            }
+            else {
+                fprintf(stderr, "unknown io backend %s\n", v);
+                return false;
+            }
+        }
+        else if (arg == "--serial") {
+            options.serial = true;
+        }
+        else if (arg == "--verify") {
+            options.verify = true;
+        }
+        else if (arg == "--watch") {
+            options.watch = true;
+        }
+        else if (!arg.empty() && arg.front() == '-') {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+        else {
+            options.inputs.push_back(arg);
+        }
+    }
+
+    if (options.outputDir.empty() || options.inputs.empty()) {
+        printUsage(stderr);
+        return false;
+    }
+    if (!options.subsetFile.empty()) {
+        // Scanned last, since the text depends on the code page.
+        auto scanner = NeoCorpusScanner{neoCodePage(options.codePage)};
+        if (!scanCorpusFile(options.subsetFile.c_str(), scanner)) {
+            fprintf(stderr, "could not read %s\n", options.subsetFile.c_str());
+            return false;
+        }
+        options.subset = scanner.histogram();
+    }
+    if (options.jobs < 1) {
+        options.jobs = static_cast<int>(std::thread::hardware_concurrency());
+        if (options.jobs < 1) {
+            options.jobs = 1;
+        }
+    }
+    if (!options.ioForced && uringAvailable()) {
+        options.io = IoBackend::Uring;
+    }
+    if (options.io == IoBackend::Uring && !uringAvailable()) {
+        fprintf(stderr, "io_uring not available, using threads\n");
+        options.io = IoBackend::Threads;
+    }
+    return true;
+}
+
+bool endsWith(const std::string &s, const char *suffix) {
+    auto n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+/** File name without any source font extension, or an empty string if the
+ * path does not look like a PSF or BDF font.
+ */
+std::string sourceStem(const std::string &path) {
+    auto name = std::filesystem::path{path}.filename().string();
+    for (auto ext : {".psf.gz", ".psfu.gz", ".psf", ".psfu", ".bdf"}) {
+        if (endsWith(name, ext)) {
+            return name.substr(0, name.size() - strlen(ext));
+        }
+    }
+    return {};
+}
+
+std::string fontNameFor(const std::string &path) {
+    auto stem = sourceStem(path);
+    return stem.empty() ? std::filesystem::path{path}.stem().string() : stem;
+}
+
+/** Per worker scratch state, reused for every file the worker handles.
+ */
+struct Converter {
+    std::unique_ptr<NeoFont> font = std::make_unique<NeoFont>();
+    std::unique_ptr<const NeoFont> blank = std::make_unique<NeoFont>();
+    NeoAppletBuffer output;
+
+    /** Decode and transform one input in to font. This and convert() are
+     * the only places where conversion happens, so pipelined, serial and
+     * watched runs produce the same bytes.
+     */
+    bool build(const Options &options,
+               const ConvertJob &job,
+               const std::vector<uint8_t> &input,
+               std::string &error) {
+        auto format = detectFontFormat(input);
+        if (format != NeoFontFormat::Applet) {
+            *font = *blank;
+            font->setFontName(fontNameFor(job.input).c_str());
+            font->setCodePage(options.codePage);
+        }
+        if (!importFont(input, format, *font)) {
+            error = std::string{"not a valid "} + fontFormatName(format);
+            return false;
+        }
+
+        if (options.height > 0 && options.resample) {
+            // Files are already spread over the workers
+            auto resample = NeoResampleOptions{};
+            resample.mode = *options.resample;
+            resample.threads = 1;
+            resampleFont(*font, *font, options.height, resample);
+        }
+        else if (options.height > 0) {
+            font->setHeight(options.height);
+        }
+        for (auto transform : options.transforms) {
+            for (auto &c : *font) {
+                switch (transform) {
+                case Transform::Bold:
+                    c.transformBold();
+                    break;
+                case Transform::FlipH:
+                    c.transformFlipH();
+                    break;
+                case Transform::FlipV:
+                    c.transformFlipV();
+                    break;
+                }
+            }
+        }
+        if (options.subset) {
+            auto report = subsetFont(*font, *options.subset);
+            subsetTotals.add(
+                report.sizeBefore, report.sizeAfter, report.removed);
+        }
+        if (options.fitWidths) {
+            auto report = fitWidths(*font);
+            fitTotals.add(
+                report.sizeBefore, report.sizeAfter, report.narrowed);
+        }
+        return true;
+    }
+
+    /// Decode, transform and re-encode one input.
+    bool convert(const Options &options,
+                 const ConvertJob &job,
+                 const std::vector<uint8_t> &input,
+                 std::string &error) {
+        if (!build(options, job, input, error)) {
+            return false;
+        }
+
+        if (options.cache) {
+            bool hit = false;
+            if (options.cache->encode(*font, neoFontHash(*font), output, &hit)
+                    .empty()) {
+                error = "encoding failed";
+                return false;
+            }
+            cacheHits += hit;
+            return true;
+        }
+        if (output.encode(*font).empty()) {
+            error = "encoding failed";
+            return false;
+        }
+        return true;
+    }
+};
+
+/** Expand directories to the regular files inside them, in sorted order.
+ */
+std::vector<std::string> expandInputs(const std::vector<std::string> &inputs) {
+    auto files = std::vector<std::string>{};
+    for (auto &input : inputs) {
+        auto ec = std::error_code{};
+        if (!std::filesystem::is_directory(input, ec)) {
+            files.push_back(input);
+            continue;
+        }
+        auto first = files.size();
+        for (auto &entry : std::filesystem::directory_iterator{input, ec}) {
+            if (entry.is_regular_file(ec)) {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin() + first, files.end());
+    }
+    return files;
+}
+
+ConvertJob makeJob(const Options &options, size_t index, std::string input) {
+    auto job = ConvertJob{};
+    job.index = index;
+    job.input = std::move(input);
+    auto stem = sourceStem(job.input);
+    auto name = stem.empty() ? std::filesystem::path{job.input}.filename()
+                             : std::filesystem::path{stem + ".OS3KApp"};
+    job.output = (std::filesystem::path{options.outputDir} / name).string();
+    return job;
+}
+
+/** Paths are compared in normal form, since the watch mode builds them
+ * from the directory and the file name.
+ */
+std::string normalPath(const std::string &path) {
+    return std::filesystem::path{path}.lexically_normal().string();
+}
+
+/** Make a job for every input. Inputs of the same name in different
+ * directories would be written to the same output and temporary file, so
+ * they are reported and nothing is converted.
+ *
+ *  @return Logical true if every output is unique.
+ */
+bool makeJobs(const Options &options, std::vector<ConvertJob> &jobs) {
+    auto inputs = expandInputs(options.inputs);
+    jobs.clear();
+    jobs.reserve(inputs.size());
+    auto outputs = std::map<std::string, size_t>{};
+    bool ok = true;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        jobs.push_back(makeJob(options, i, std::move(inputs[i])));
+        auto &job = jobs.back();
+        auto [first, added] = outputs.emplace(normalPath(job.output), i);
+        if (!added) {
+            fprintf(stderr,
+                    "%s and %s would both be written to %s\n",
+                    jobs[first->second].input.c_str(),
+                    job.input.c_str(),
+                    job.output.c_str());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/** Write an applet through a temporary file and a rename, so that readers
+ * of the output never see a partial applet.
+ */
+bool saveAtomically(const NeoAppletBuffer &applet, const std::string &path) {
+    auto tmp = path + ".tmp";
+    return applet.save(tmp.c_str()) &&
+           std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+double seconds(uint64_t ns) {
+    return ns / 1e9;
+}
+
+void printStage(const char *name, const StageStats &stats, int threads) {
+    auto busy = seconds(stats.busyNs);
+    auto perThread = threads > 0 ? busy / threads : busy;
+    fprintf(stderr,
+            "%-8s %8llu %12llu %10.2f %12.0f %10.1f\n",
+            name,
+            static_cast<unsigned long long>(stats.items.load()),
+            static_cast<unsigned long long>(stats.bytes.load()),
+            busy * 1000.,
+            perThread > 0 ? stats.items / perThread : 0.,
+            perThread > 0 ? stats.bytes / perThread / 1e6 : 0.);
+}
+
+/** Run the three stage pipeline.
+ */
+std::vector<ConvertJob> runPipeline(const Options &options,
+                                    std::vector<ConvertJob> jobs,
+                                    StageStats &readStats,
+                                    StageStats &convertStats,
+                                    StageStats &writeStats) {
+    auto results = std::vector<ConvertJob>(jobs.size());
+
+    auto decodeQueue = BoundedQueue<ConvertJob>{size_t(options.queue)};
+    auto writeQueue = BoundedQueue<ConvertJob>{size_t(options.queue)};
+
+    auto reader = std::thread{[&, jobs = std::move(jobs)]() mutable {
+        readFiles(options.io,
+                  std::move(jobs),
+                  decodeQueue,
+                  readStats,
+                  options.ioDepth);
+        decodeQueue.close();
+    }};
+
+    auto writer = std::thread{[&] {
+        writeFiles(
+            options.io, writeQueue, results, writeStats, options.ioDepth);
+    }};
+
+    auto workers = std::vector<std::thread>{};
+    for (int i = 0; i < options.jobs; ++i) {
+        workers.emplace_back([&] {
+            auto converter = Converter{};
+            while (auto job = decodeQueue.pop()) {
+                auto start = Clock::now();
+                if (job->error.empty() &&
+                    converter.convert(options, *job, job->data, job->error)) {
+                    auto bytes = converter.output.bytes();
+                    job->data.assign(bytes.begin(), bytes.end());
+                }
+                else {
+                    job->data.clear();
+                }
+                convertStats.add(job->data.size(), Clock::now() - start);
+                writeQueue.push(std::move(*job));
+            }
+        });
+    }
+
+    reader.join();
+    for (auto &w : workers) {
+        w.join();
+    }
+    writeQueue.close();
+    writer.join();
+
+    return results;
+}
+
+/** Convert everything on the calling thread, one stage after the other.
+ */
+std::vector<ConvertJob> runSerial(const Options &options,
+                                  std::vector<ConvertJob> jobs,
+                                  StageStats &readStats,
+                                  StageStats &convertStats,
+                                  StageStats &writeStats) {
+    auto converter = Converter{};
+    auto buffer = NeoAppletBuffer{};
+    for (auto &job : jobs) {
+        auto start = Clock::now();
+        if (!buffer.load(job.input.c_str())) {
+            job.error = job.input + ": could not read";
+            readStats.add(0, Clock::now() - start);
+            continue;
+        }
+        readStats.add(buffer.size(), Clock::now() - start);
+
+        start = Clock::now();
+        auto bytes = buffer.bytes();
+        job.data.assign(bytes.begin(), bytes.end());
+        bool ok = converter.convert(options, job, job.data, job.error);
+        convertStats.add(ok ? converter.output.size() : 0,
+                         Clock::now() - start);
+        if (!ok) {
+            continue;
+        }
+
+        start = Clock::now();
+        if (!saveAtomically(converter.output, job.output)) {
+            job.error = job.output + ": could not write";
+        }
+        writeStats.add(converter.output.size(), Clock::now() - start);
+        job.data = {};
+    }
+    return jobs;
+}
+
+/** Compare every written output with a fresh serial conversion of its input.
+ */
+int verify(const Options &options, const std::vector<ConvertJob> &results) {
+    auto converter = Converter{};
+    auto input = NeoAppletBuffer{};
+    auto written = NeoAppletBuffer{};
+    int mismatches = 0;
+    for (auto &job : results) {
+        if (!job.error.empty()) {
+            continue;
+        }
+        auto error = std::string{};
+        auto data = std::vector<uint8_t>{};
+        if (input.load(job.input.c_str())) {
+            auto bytes = input.bytes();
+            data.assign(bytes.begin(), bytes.end());
+        }
+        bool ok = converter.convert(options, job, data, error) &&
+                  written.load(job.output.c_str()) &&
+                  written.size() == converter.output.size() &&
+                  !memcmp(written.bytes().data(),
+                          converter.output.bytes().data(),
+                          written.size());
+        if (!ok) {
+            fprintf(stderr, "verify: %s differs\n", job.output.c_str());
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+/** An input in watch mode, with the font and applet of its last conversion
+ * so that a save only has to repack the characters that changed.
+ */
+struct WatchedFont {
+    ConvertJob job;
+    std::unique_ptr<NeoFont> font = std::make_unique<NeoFont>();
+    NeoAppletBuffer applet;
+    bool converted = false;
+};
+
+/** Convert a watched input again, copy the characters that changed in to
+ * its resident font and patch its applet, or encode it if the layout
+ * changed. The output is replaced atomically.
+ *
+ *  @param  saved   When the save was seen, for the latency report.
+ */
+void updateWatched(const Options &options,
+                   Converter &converter,
+                   WatchedFont &watched,
+                   Clock::time_point saved) {
+    auto start = Clock::now();
+    auto &job = watched.job;
+    auto error = std::string{};
+    if (!converter.output.load(job.input.c_str())) {
+        fprintf(stderr, "%s: could not read\n", job.input.c_str());
+        return;
+    }
+    auto bytes = converter.output.bytes();
+    job.data.assign(bytes.begin(), bytes.end());
+    if (!converter.build(options, job, job.data, error)) {
+        fprintf(stderr, "%s: %s\n", job.input.c_str(), error.c_str());
+        return;
+    }
+
+    auto &font = *converter.font;
+    auto diff = diffFonts(*watched.font, font);
+    if (watched.converted && diff.empty()) {
+        fprintf(stderr, "%s: unchanged\n", job.input.c_str());
+        return;
+    }
+    auto changes = NeoFontChanges{};
+    if (!watched.converted || diff.heightChanged || diff.metadataChanged) {
+        *watched.font = font;
+        changes.characters.set();
+        changes.height = true;
+        changes.metadata = true;
+    }
+    else {
+        changes = watched.font->batch([&](NeoFontTransaction &tx) {
+            for (auto codes : {&diff.changedGlyphs, &diff.changedWidths}) {
+                for (auto code : *codes) {
+                    tx.character(code) = font.character(code);
+                }
+            }
+        });
+    }
+
+    bool patched = false;
+    if (watched.applet.update(*watched.font, changes, &patched).empty() ||
+        !saveAtomically(watched.applet, job.output)) {
+        fprintf(stderr, "%s: could not write\n", job.output.c_str());
+        watched.converted = false;
+        return;
+    }
+    watched.converted = true;
+
+    auto end = Clock::now();
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    fprintf(stderr,
+            "%s: %s %zu of %zu characters in %.2f ms, %.2f ms after the "
+            "save\n",
+            job.output.c_str(),
+            patched ? "patched" : "encoded",
+            changes.characters.count(),
+            NeoFont::charCount,
+            ms(end - start),
+            ms(end - saved));
+}
+
+/** Convert every input, then convert inputs again whenever they are saved,
+ * until the process is stopped. Files added to an input directory are
+ * picked up too.
+ */
+int runWatch(const Options &options, std::vector<ConvertJob> jobs) {
+    auto watcher = FileWatcher{};
+    if (!watcher.ok()) {
+        fprintf(stderr, "inotify is not available\n");
+        return 1;
+    }
+    for (auto &input : options.inputs) {
+        if (!watcher.add(input)) {
+            fprintf(stderr, "could not watch %s\n", input.c_str());
+            return 1;
+        }
+    }
+
+    auto fonts = std::map<std::string, WatchedFont>{};
+    auto outputs = std::set<std::string>{};
+    auto converter = Converter{};
+    for (auto &job : jobs) {
+        auto &watched = fonts[normalPath(job.input)];
+        outputs.insert(normalPath(job.output));
+        watched.job = std::move(job);
+        updateWatched(options, converter, watched, Clock::now());
+    }
+    fprintf(stderr, "watching %zu inputs\n", fonts.size());
+
+    for (;;) {
+        auto saved = Clock::time_point{};
+        auto changed = watcher.wait(watchSettleMs, saved);
+        if (changed.empty()) {
+            fprintf(stderr, "watching failed\n");
+            return 1;
+        }
+        for (auto &path : changed) {
+            auto k = normalPath(path);
+            // Outputs written in to a watched directory are not inputs, and
+            // files renamed away since the event are gone.
+            auto ec = std::error_code{};
+            if (outputs.count(k) ||
+                !std::filesystem::is_regular_file(path, ec)) {
+                continue;
+            }
+            auto found = fonts.find(k);
+            if (found == fonts.end()) {
+                auto job = makeJob(options, fonts.size(), path);
+                if (!outputs.insert(normalPath(job.output)).second) {
+                    fprintf(stderr,
+                            "%s: not converted, %s is the output of another "
+                            "input\n",
+                            path.c_str(),
+                            job.output.c_str());
+                    continue;
+                }
+                found = fonts.emplace(k, WatchedFont{}).first;
+                found->second.job = std::move(job);
+            }
+            updateWatched(options, converter, found->second, saved);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+    if (!parseArgs(argc, argv, options)) {
+        return 2;
+    }
+
+    auto jobs = std::vector<ConvertJob>{};
+    if (!makeJobs(options, jobs)) {
+        return 1;
+    }
+
+    auto ec = std::error_code{};
+    std::filesystem::create_directories(options.outputDir, ec);
+    if (options.watch) {
+        return runWatch(options, std::move(jobs));
+    }
+
+    auto readStats = StageStats{};
+    auto convertStats = StageStats{};
+    auto writeStats = StageStats{};
+
+    auto start = Clock::now();
+    auto results =
+        options.serial
+            ? runSerial(
+                  options, std::move(jobs), readStats, convertStats, writeStats)
+            : runPipeline(options,
+                          std::move(jobs),
+                          readStats,
+                          convertStats,
+                          writeStats);
+    auto wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+    int failures = 0;
+    for (auto &job : results) {
+        if (!job.error.empty()) {
+            fprintf(stderr, "%s: %s\n", job.input.c_str(), job.error.c_str());
+            ++failures;
+        }
+    }
+
+    int ioThreads = options.io == IoBackend::Uring ? 1 : options.ioDepth;
+    fprintf(stderr,
+            "%-8s %8s %12s %10s %12s %10s\n",
+            "stage",
+            "items",
+            "bytes",
+            "busy_ms",
+            "items/s",
+            "MB/s");
+    printStage("read", readStats, options.serial ? 1 : ioThreads);
+    printStage("convert", convertStats, options.serial ? 1 : options.jobs);
+    printStage("write", writeStats, options.serial ? 1 : ioThreads);
+    fprintf(stderr,
+            "%zu files in %.1f ms (%.0f files/s), %d failed, %s, io: %s, "
+            "%d workers\n",
+            results.size(),
+            wall * 1000.,
+            wall > 0 ? results.size() / wall : 0.,
+            failures,
+            options.serial ? "serial" : "pipelined",
+            ioBackendName(options.io),
+            options.jobs);
+
+    if (options.subset) {
+        subsetTotals.print("subset", "blanked");
+    }
+    if (options.fitWidths) {
+        fitTotals.print("fit-widths", "narrowed");
+    }
+    if (options.cache) {
+        fprintf(stderr,
+                "cache: %d hits in %s\n",
+                cacheHits.load(),
+                options.cache->directory().c_str());
+    }
+
+    if (options.verify) {
+        int mismatches = verify(options, results);
+        fprintf(stderr, "verify: %d mismatches\n", mismatches);
+        if (mismatches) {
+            return 1;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+/** @file       Client.cc
+ *  @brief      Client library for neo_font_daemon.
+ */
+
+#include "Client.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+DaemonClient::~DaemonClient() {
+    close();
+}
+
+bool DaemonClient::connect(const std::string &path) {
+    close();
+    auto address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof address.sun_path) {
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    m_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        return false;
+    }
+    if (::connect(m_fd,
+                  reinterpret_cast<const sockaddr *>(&address),
+                  sizeof address) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void DaemonClient::close() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_pending = 0;
+    m_out.clear();
+    m_in.clear();
+    m_inStart = 0;
+}
+
+uint32_t DaemonClient::queue(DaemonOp op,
+                             const std::vector<uint8_t> &payload) {
+    auto header = DaemonRequestHeader{};
+    header.op = op;
+    header.id = m_nextId++;
+    header.payload = static_cast<uint32_t>(payload.size());
+    daemonPutHeader(m_out, header);
+    m_out.insert(m_out.end(), payload.begin(), payload.end());
+    ++m_pending;
+    return header.id;
+}
+
+uint32_t DaemonClient::decode(const char *name,
+                              NeoSpan<const uint8_t> source,
+                              uint64_t *key) {
+    auto length = std::min<size_t>(strlen(name), 255);
+    m_scratch.clear();
+    m_scratch.push_back(static_cast<uint8_t>(length));
+    m_scratch.insert(m_scratch.end(), name, name + length);
+    m_scratch.insert(m_scratch.end(), source.begin(), source.end());
+    if (key) {
+        *key = daemonDecodeKey(m_scratch);
+    }
+    return queue(DaemonOp::Decode, m_scratch);
+}
+
+uint32_t DaemonClient::encode(uint64_t key) {
+    m_scratch.clear();
+    daemonPut(m_scratch, key, 8);
+    return queue(DaemonOp::Encode, m_scratch);
+}
+
+uint32_t DaemonClient::transform(uint64_t key,
+                                 NeoSpan<const DaemonTransform> transforms,
+                                 uint64_t *result) {
+    m_scratch.clear();
+    daemonPut(m_scratch, key, 8);
+    for (auto &t : transforms) {
+        daemonPut(m_scratch, static_cast<uint8_t>(t.op), 1);
+        daemonPut(m_scratch, t.mode, 1);
+        daemonPut(m_scratch, t.value, 2);
+    }
+    if (result) {
+        *result = daemonTransformKey(m_scratch);
+    }
+    return queue(DaemonOp::Transform, m_scratch);
+}
+
+uint32_t DaemonClient::render(uint64_t key,
+                              NeoSpan<const uint8_t> codes,
+                              int maxWidth) {
+    m_scratch.clear();
+    daemonPut(m_scratch, key, 8);
+    daemonPut(m_scratch, static_cast<uint16_t>(maxWidth), 2);
+    m_scratch.insert(m_scratch.end(), codes.begin(), codes.end());
+    return queue(DaemonOp::Render, m_scratch);
+}
+
+uint32_t DaemonClient::stats() {
+    m_scratch.clear();
+    return queue(DaemonOp::Stats, m_scratch);
+}
+
+/** Read whatever has arrived in to m_in.
+ */
+bool DaemonClient::readSome() {
+    if (m_inStart) {
+        m_in.erase(m_in.begin(), m_in.begin() + m_inStart);
+        m_inStart = 0;
+    }
+    auto used = m_in.size();
+    m_in.resize(used + 64 * 1024);
+    auto n = ::read(m_fd, m_in.data() + used, m_in.size() - used);
+    m_in.resize(used + (n > 0 ? static_cast<size_t>(n) : 0));
+    return n > 0 || (n < 0 && (errno == EINTR || errno == EAGAIN));
+}
+
+/** Write the queued requests. Responses are read in to m_in meanwhile, so a
+ * large batch can not fill both socket buffers and stall.
+ */
+bool DaemonClient::flush() {
+    size_t done = 0;
+    while (m_fd >= 0 && done < m_out.size()) {
+        pollfd pfd = {m_fd, POLLIN | POLLOUT, 0};
+        if (::poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if ((pfd.revents & POLLIN) && !readSome()) {
+            break;
+        }
+        if (pfd.revents & POLLOUT) {
+            auto n = ::send(m_fd,
+                            m_out.data() + done,
+                            m_out.size() - done,
+                            MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                break;
+            }
+            done += n > 0 ? static_cast<size_t>(n) : 0;
+        }
+        else if (pfd.revents & (POLLERR | POLLHUP)) {
+            break;
+        }
+    }
+    bool ok = done == m_out.size();
+    m_out.clear();
+    if (!ok) {
+        close();
+    }
+    return ok;
+}
+
+/// Make sure at least bytes unconsumed bytes are in m_in.
+bool DaemonClient::fill(size_t bytes) {
+    while (m_fd >= 0 && m_in.size() - m_inStart < bytes) {
+        if (!readSome()) {
+            close();
+            return false;
+        }
+    }
+    return m_fd >= 0;
+}
+
+bool DaemonClient::receive(DaemonResponse &response) {
+    if (!m_pending || !fill(DaemonResponseHeader::size) ||
+        !daemonGetHeader(m_in.data() + m_inStart, response.header) ||
+        response.header.payload > daemonMaxPayload) {
+        return false;
+    }
+    m_inStart += DaemonResponseHeader::size;
+    if (!fill(response.header.payload)) {
+        return false;
+    }
+    auto data = m_in.data() + m_inStart;
+    response.payload.assign(data, data + response.header.payload);
+    m_inStart += response.header.payload;
+    --m_pending;
+    return true;
+}
+
+bool DaemonClient::wait(std::vector<DaemonResponse> &responses) {
+    if (!flush()) {
+        return false;
+    }
+    responses.resize(m_pending);
+    for (auto &response : responses) {
+        if (!receive(response)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+/** @file       Client.h
+ *  @brief      Client library for neo_font_daemon.
+ */
+
+#pragma once
+
+#include "Protocol.h"
+#include <string>
+#include <vector>
+
+struct DaemonResponse {
+    DaemonResponseHeader header;
+    std::vector<uint8_t> payload;
+
+    bool ok() const {
+        return header.status == DaemonStatus::Ok;
+    }
+};
+
+/** Connection to a neo_font_daemon. Requests are queued and sent together
+ * by flush(), so a batch costs one write and the daemon answers it with one
+ * write. Responses come back in request order.
+ *
+ * A client is not thread safe; use one per thread.
+ */
+class DaemonClient {
+public:
+    DaemonClient() = default;
+    DaemonClient(const DaemonClient &) = delete;
+    DaemonClient &operator=(const DaemonClient &) = delete;
+    ~DaemonClient();
+
+    bool connect(const std::string &path);
+    void close();
+
+    bool connected() const {
+        return m_fd >= 0;
+    }
+
+    /** Queue requests. Each returns the id the response will carry. The
+     * keys that decode() and transform() results are cached under are known
+     * up front, so later requests in the same batch can use them.
+     */
+    uint32_t decode(const char *name,
+                    NeoSpan<const uint8_t> source,
+                    uint64_t *key = nullptr);
+    uint32_t encode(uint64_t key);
+    uint32_t transform(uint64_t key,
+                       NeoSpan<const DaemonTransform> transforms,
+                       uint64_t *result = nullptr);
+    uint32_t render(uint64_t key,
+                    NeoSpan<const uint8_t> codes,
+                    int maxWidth = 0);
+    uint32_t stats();
+
+    /// Requests queued or sent that have not been received yet.
+    size_t pending() const {
+        return m_pending;
+    }
+
+    /// Send the queued requests. @return false if the connection failed.
+    bool flush();
+
+    /// Wait for the next response. @return false if the connection failed.
+    bool receive(DaemonResponse &response);
+
+    /// Flush and receive every pending response.
+    bool wait(std::vector<DaemonResponse> &responses);
+
+private:
+    uint32_t queue(DaemonOp op, const std::vector<uint8_t> &payload);
+    bool fill(size_t bytes);
+    bool readSome();
+
+    int m_fd = -1;
+    uint32_t m_nextId = 1;
+    size_t m_pending = 0;
+    std::vector<uint8_t> m_out;
+    std::vector<uint8_t> m_in;
+    size_t m_inStart = 0; /**< Bytes of m_in already consumed. */
+    std::vector<uint8_t> m_scratch;
+};
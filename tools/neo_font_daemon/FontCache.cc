@@ -0,0 +1,58 @@
+/** @file       FontCache.cc
+ *  @brief      Decoded fonts kept by neo_font_daemon between requests.
+ */
+
+#include "FontCache.h"
+
+FontCache::FontCache(size_t capacity)
+    : NeoMemoryConsumer("font_cache")
+    , m_capacity(capacity ? capacity : 1) {
+    m_stats.capacity = m_capacity;
+}
+
+FontCache::Font FontCache::find(uint64_t key) {
+    auto lock = std::lock_guard{m_mutex};
+    if (releaseRequested()) {
+        shrink(m_order.size() / 2);
+    }
+    auto found = m_index.find(key);
+    if (found == m_index.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    m_order.splice(m_order.begin(), m_order, found->second);
+    return found->second->second;
+}
+
+void FontCache::insert(uint64_t key, Font font) {
+    auto lock = std::lock_guard{m_mutex};
+    auto found = m_index.find(key);
+    if (found != m_index.end()) {
+        // Another request decoded the same data first.
+        m_order.splice(m_order.begin(), m_order, found->second);
+        return;
+    }
+    m_order.emplace_front(key, std::move(font));
+    m_index[key] = m_order.begin();
+    shrink(m_capacity);
+}
+
+/** Drop the least recently used fonts until at most the given number are
+ * left. Requests still using a dropped font keep it alive until they finish.
+ */
+void FontCache::shrink(size_t fonts) {
+    while (m_order.size() > fonts) {
+        m_index.erase(m_order.back().first);
+        m_order.pop_back();
+        ++m_stats.evictions;
+    }
+    setMemoryCharged(m_order.size() * sizeof(NeoFont));
+}
+
+FontCacheStats FontCache::stats() const {
+    auto lock = std::lock_guard{m_mutex};
+    auto stats = m_stats;
+    stats.fonts = m_order.size();
+    return stats;
+}
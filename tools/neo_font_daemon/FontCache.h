@@ -0,0 +1,54 @@
+/** @file       FontCache.h
+ *  @brief      Decoded fonts kept by neo_font_daemon between requests.
+ */
+
+#pragma once
+
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoMemory.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+struct FontCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0; /**< Fonts dropped for space. */
+    size_t fonts = 0;
+    size_t capacity = 0;
+};
+
+/** Least recently used cache of decoded fonts, keyed by a hash of the data
+ * they were made from. Cached fonts are never changed, so requests share
+ * them without holding the lock.
+ *
+ * The cache is the "font_cache" NeoMemoryConsumer. When the memory cap asks
+ * for memory back, the least recently used half of the fonts is dropped.
+ */
+class FontCache : public NeoMemoryConsumer {
+public:
+    using Font = std::shared_ptr<const NeoFont>;
+
+    /// @param  capacity    Number of fonts kept.
+    explicit FontCache(size_t capacity);
+
+    /// The font cached under a key, or null.
+    Font find(uint64_t key);
+
+    void insert(uint64_t key, Font font);
+
+    FontCacheStats stats() const;
+
+private:
+    using Order = std::list<std::pair<uint64_t, Font>>;
+
+    void shrink(size_t fonts);
+
+    mutable std::mutex m_mutex;
+    size_t m_capacity;
+    Order m_order; /**< Most recently used first. */
+    std::unordered_map<uint64_t, Order::iterator> m_index;
+    FontCacheStats m_stats;
+};
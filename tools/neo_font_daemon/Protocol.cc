@@ -0,0 +1,58 @@
+/** @file       Protocol.cc
+ *  @brief      Wire format between neo_font_daemon and its clients.
+ */
+
+#include "Protocol.h"
+
+const char *daemonOpName(DaemonOp op) {
+    switch (op) {
+    case DaemonOp::Decode:
+        return "decode";
+    case DaemonOp::Encode:
+        return "encode";
+    case DaemonOp::Transform:
+        return "transform";
+    case DaemonOp::Render:
+        return "render";
+    case DaemonOp::Stats:
+        return "stats";
+    }
+    return "unknown";
+}
+
+void daemonPutHeader(std::vector<uint8_t> &out,
+                     const DaemonRequestHeader &header) {
+    daemonPut(out, header.magic, 4);
+    daemonPut(out, static_cast<uint16_t>(header.op), 2);
+    daemonPut(out, 0, 2);
+    daemonPut(out, header.id, 4);
+    daemonPut(out, header.payload, 4);
+}
+
+void daemonPutHeader(std::vector<uint8_t> &out,
+                     const DaemonResponseHeader &header) {
+    daemonPut(out, header.magic, 4);
+    daemonPut(out, static_cast<uint16_t>(header.op), 2);
+    daemonPut(out, static_cast<uint16_t>(header.status), 2);
+    daemonPut(out, header.id, 4);
+    daemonPut(out, header.payload, 4);
+    daemonPut(out, header.serverNs, 8);
+}
+
+bool daemonGetHeader(const uint8_t *data, DaemonRequestHeader &header) {
+    header.magic = static_cast<uint32_t>(daemonGet(data, 4));
+    header.op = static_cast<DaemonOp>(daemonGet(data + 4, 2));
+    header.id = static_cast<uint32_t>(daemonGet(data + 8, 4));
+    header.payload = static_cast<uint32_t>(daemonGet(data + 12, 4));
+    return header.magic == daemonMagic;
+}
+
+bool daemonGetHeader(const uint8_t *data, DaemonResponseHeader &header) {
+    header.magic = static_cast<uint32_t>(daemonGet(data, 4));
+    header.op = static_cast<DaemonOp>(daemonGet(data + 4, 2));
+    header.status = static_cast<DaemonStatus>(daemonGet(data + 6, 2));
+    header.id = static_cast<uint32_t>(daemonGet(data + 8, 4));
+    header.payload = static_cast<uint32_t>(daemonGet(data + 12, 4));
+    header.serverNs = daemonGet(data + 16, 8);
+    return header.magic == daemonMagic;
+}
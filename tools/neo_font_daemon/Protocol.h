@@ -0,0 +1,134 @@
+/** @file       Protocol.h
+ *  @brief      Wire format between neo_font_daemon and its clients.
+ *
+ *  Every message is a fixed header followed by a payload. Numbers are little
+ *  endian. A client may send any number of requests before reading the
+ *  responses; the daemon answers each batch of requests it has received with
+ *  one write, in the order they were sent.
+ *
+ *  Request payloads:
+ *
+ *    Decode     u8 name length, name, source bytes (applet, PSF or BDF). The
+ *               name is used for PSF and BDF fonts. The font is cached under
+ *               the key daemonDecodeKey() of the payload, so a client can
+ *               compute it and skip sending fonts the daemon already has.
+ *    Encode     u64 key.
+ *    Transform  u64 key, then DaemonTransform records of 4 bytes: u8 op,
+ *               u8 mode, u16 value. The result is cached under
+ *               daemonTransformKey() of the payload.
+ *    Render     u64 key, u16 maximum line width (zero for one line), Neo
+ *               character codes. Code 10 starts a new line.
+ *    Stats      empty.
+ *
+ *  Response payloads, when the status is Ok:
+ *
+ *    Decode     u64 key, u8 height, font name.
+ *    Encode     the applet.
+ *    Transform  u64 key of the result, u8 height.
+ *    Render     u16 width, u16 height, rows of (width + 7) / 8 bytes, the
+ *               leftmost pixel in the top bit. Text whose image would not
+ *               fit in daemonMaxPayload is refused with BadRequest.
+ *    Stats      text: request latencies and memory use.
+ *
+ *  Other statuses carry an error message as the payload.
+ */
+
+#pragma once
+
+#include "neofontlib/NeoHash.h"
+#include "neofontlib/NeoSpan.h"
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t daemonMagic = 0x3144464e; // "NFD1"
+
+/// Payloads larger than this are refused and close the connection.
+constexpr uint32_t daemonMaxPayload = 16 * 1024 * 1024;
+
+enum class DaemonOp : uint16_t {
+    Decode = 1,
+    Encode = 2,
+    Transform = 3,
+    Render = 4,
+    Stats = 5,
+};
+
+/// Number of DaemonOp values plus one, for tables indexed by op.
+constexpr size_t daemonOpCount = 6;
+
+const char *daemonOpName(DaemonOp op);
+
+enum class DaemonStatus : uint16_t {
+    Ok = 0,
+    NotFound = 1,   /**< The key is not cached; send the font again. */
+    BadRequest = 2, /**< The payload could not be parsed. */
+    Failed = 3,     /**< The font could not be decoded or encoded. */
+};
+
+struct DaemonRequestHeader {
+    static constexpr size_t size = 16;
+
+    uint32_t magic = daemonMagic;
+    DaemonOp op = DaemonOp::Stats;
+    uint32_t id = 0;
+    uint32_t payload = 0;
+};
+
+struct DaemonResponseHeader {
+    static constexpr size_t size = 24;
+
+    uint32_t magic = daemonMagic;
+    DaemonOp op = DaemonOp::Stats;
+    DaemonStatus status = DaemonStatus::Ok;
+    uint32_t id = 0;
+    uint32_t payload = 0;
+    uint64_t serverNs = 0; /**< Time the daemon spent on the request. */
+};
+
+enum class DaemonTransformOp : uint8_t {
+    Bold = 1,
+    FlipH = 2,
+    FlipV = 3,
+    Height = 4,    /**< Crop or pad to value rows. */
+    Resample = 5,  /**< Scale to value rows, mode is a NeoResampleMode. */
+    FitWidths = 6, /**< value is the right bearing. */
+};
+
+struct DaemonTransform {
+    DaemonTransformOp op = DaemonTransformOp::Bold;
+    uint8_t mode = 0;
+    uint16_t value = 0;
+};
+
+inline uint64_t daemonDecodeKey(NeoSpan<const uint8_t> payload) {
+    return neoDataHash(payload, static_cast<uint64_t>(DaemonOp::Decode));
+}
+
+inline uint64_t daemonTransformKey(NeoSpan<const uint8_t> payload) {
+    return neoDataHash(payload, static_cast<uint64_t>(DaemonOp::Transform));
+}
+
+/// Append little endian values to a message.
+inline void daemonPut(std::vector<uint8_t> &out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+/// Read a little endian value. The caller checks the bounds.
+inline uint64_t daemonGet(const uint8_t *data, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes; i-- > 0;) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+void daemonPutHeader(std::vector<uint8_t> &out,
+                     const DaemonRequestHeader &header);
+void daemonPutHeader(std::vector<uint8_t> &out,
+                     const DaemonResponseHeader &header);
+
+/// @return false if the magic number is wrong.
+bool daemonGetHeader(const uint8_t *data, DaemonRequestHeader &header);
+bool daemonGetHeader(const uint8_t *data, DaemonResponseHeader &header);
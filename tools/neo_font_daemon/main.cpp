@@ -0,0 +1,533 @@
+/** @file       main.cpp
+ *  @brief      neo_font_daemon: conversion server with a warm font cache.
+ *
+ *  Listens on a Unix domain socket and serves the requests described in
+ *  Protocol.h, one thread per connection. Decoded fonts are kept in a
+ *  FontCache shared by all connections, so fonts used by many builds are
+ *  only decoded once.
+ */
+
+#include "FontCache.h"
+#include "Protocol.h"
+#include "neofontlib/NeoBitmap.h"
+#include "neofontlib/NeoFitWidths.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoImport.h"
+#include "neofontlib/NeoMemory.h"
+#include "neofontlib/NeoResample.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socket = "/tmp/neo_font_daemon.sock";
+    size_t cacheFonts = 64;
+    size_t memoryCap = 0; /**< Bytes, zero for none. */
+};
+
+void printUsage(FILE *out) {
+    fputs("usage: neo_font_daemon [options]\n"
+          "\n"
+          "  --socket <path>      Unix socket to listen on (default:\n"
+          "                       /tmp/neo_font_daemon.sock)\n"
+          "  --cache <n>          decoded fonts kept (default: 64)\n"
+          "  --memory-cap <MiB>   memory cap for caches (default: none)\n",
+          out);
+}
+
+bool parseArgs(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string{argv[i]};
+        if (arg == "-h" || arg == "--help") {
+            printUsage(stdout);
+            exit(0);
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+        auto v = argv[++i];
+        if (arg == "--socket") {
+            options.socket = v;
+        }
+        else if (arg == "--cache") {
+            options.cacheFonts = strtoul(v, nullptr, 10);
+        }
+        else if (arg == "--memory-cap") {
+            options.memoryCap = strtoul(v, nullptr, 10) * 1024 * 1024;
+        }
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Latency of one kind of request, in power of two buckets of nanoseconds
+ * so that percentiles can be estimated without keeping every sample.
+ */
+struct Latency {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::array<std::atomic<uint64_t>, 64> buckets = {};
+
+    void add(uint64_t ns) {
+        ++count;
+        totalNs += ns;
+        auto max = maxNs.load();
+        while (ns > max && !maxNs.compare_exchange_weak(max, ns)) {
+        }
+        ++buckets[ns ? 64 - __builtin_clzll(ns) : 0];
+    }
+
+    /// Upper bound of the bucket holding the given fraction of samples.
+    double percentileUs(double fraction) const {
+        auto target = static_cast<uint64_t>(count * fraction);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            seen += buckets[b];
+            if (seen > target) {
+                auto bound = std::min(uint64_t{1} << b, maxNs.load());
+                return static_cast<double>(bound) / 1000.;
+            }
+        }
+        return 0.;
+    }
+};
+
+std::array<Latency, daemonOpCount> latencies;
+
+/** One request being answered. handle() fills in the status and payload.
+ */
+struct Exchange {
+    DaemonRequestHeader request;
+    NeoSpan<const uint8_t> payload;
+    DaemonStatus status = DaemonStatus::Ok;
+    std::vector<uint8_t> &out;
+
+    bool fail(DaemonStatus s, const char *message) {
+        status = s;
+        out.insert(out.end(), message, message + strlen(message));
+        return false;
+    }
+};
+
+class Server {
+public:
+    explicit Server(const Options &options)
+        : m_cache(options.cacheFonts) {}
+
+    void serve(int fd);
+
+private:
+    bool handle(Exchange &x);
+    bool decode(Exchange &x);
+    bool encode(Exchange &x);
+    bool transform(Exchange &x);
+    bool render(Exchange &x);
+    bool stats(Exchange &x);
+
+    /// Look up the font named by the key at the start of the payload.
+    FontCache::Font font(Exchange &x);
+
+    FontCache m_cache;
+};
+
+FontCache::Font Server::font(Exchange &x) {
+    if (x.payload.size() < 8) {
+        x.fail(DaemonStatus::BadRequest, "missing key");
+        return nullptr;
+    }
+    auto font = m_cache.find(daemonGet(x.payload.data(), 8));
+    if (!font) {
+        x.fail(DaemonStatus::NotFound, "font not cached");
+    }
+    return font;
+}
+
+bool Server::decode(Exchange &x) {
+    auto key = daemonDecodeKey(x.payload);
+    auto font = m_cache.find(key);
+    if (!font) {
+        if (x.payload.empty() || x.payload.size() < 1u + x.payload[0]) {
+            return x.fail(DaemonStatus::BadRequest, "short name");
+        }
+        auto nameEnd = x.payload.begin() + 1 + x.payload[0];
+        auto name = std::string{x.payload.begin() + 1, nameEnd};
+        auto data = x.payload.subspan(1 + x.payload[0]);
+
+        // Plain NeoFont is too large for the stack of a connection thread.
+        auto decoded = std::make_shared<NeoFont>();
+        auto format = detectFontFormat(data);
+        if (format != NeoFontFormat::Applet) {
+            decoded->setFontName(name.c_str());
+        }
+        if (!importFont(data, format, *decoded)) {
+            return x.fail(DaemonStatus::Failed, "not a valid font");
+        }
+        font = decoded;
+        m_cache.insert(key, font);
+    }
+
+    daemonPut(x.out, key, 8);
+    daemonPut(x.out, font->height(), 1);
+    auto name = font->fontName();
+    x.out.insert(x.out.end(), name, name + strlen(name));
+    return true;
+}
+
+bool Server::encode(Exchange &x) {
+    auto f = font(x);
+    if (!f) {
+        return false;
+    }
+    auto options = NeoEncodeOptions{};
+    options.threads = 1; // Connections already run in parallel
+    auto start = x.out.size();
+    x.out.resize(start + f->appletSize());
+    auto size = f->encodeApplet(
+        NeoSpan<uint8_t>{x.out.data() + start, x.out.size() - start}, options);
+    x.out.resize(start + size);
+    return size ? true : x.fail(DaemonStatus::Failed, "encoding failed");
+}
+
+bool Server::transform(Exchange &x) {
+    auto key = daemonTransformKey(x.payload);
+    auto result = m_cache.find(key);
+    if (!result) {
+        auto source = font(x);
+        if (!source) {
+            return false;
+        }
+        if ((x.payload.size() - 8) % 4) {
+            return x.fail(DaemonStatus::BadRequest, "bad transform list");
+        }
+        auto target = std::make_shared<NeoFont>(*source);
+        for (size_t i = 8; i < x.payload.size(); i += 4) {
+            auto op = static_cast<DaemonTransformOp>(x.payload[i]);
+            auto mode = x.payload[i + 1];
+            auto value = static_cast<int>(daemonGet(&x.payload[i + 2], 2));
+            switch (op) {
+            case DaemonTransformOp::Bold:
+            case DaemonTransformOp::FlipH:
+            case DaemonTransformOp::FlipV:
+                for (auto &c : *target) {
+                    if (op == DaemonTransformOp::Bold) {
+                        c.transformBold();
+                    }
+                    else if (op == DaemonTransformOp::FlipH) {
+                        c.transformFlipH();
+                    }
+                    else {
+                        c.transformFlipV();
+                    }
+                }
+                break;
+            case DaemonTransformOp::Height:
+                target->setHeight(value);
+                break;
+            case DaemonTransformOp::Resample: {
+                if (mode > static_cast<uint8_t>(NeoResampleMode::Scale2x)) {
+                    return x.fail(DaemonStatus::BadRequest, "bad mode");
+                }
+                auto resample = NeoResampleOptions{};
+                resample.mode = static_cast<NeoResampleMode>(mode);
+                resample.threads = 1;
+                resampleFont(*target, *target, value, resample);
+                break;
+            }
+            case DaemonTransformOp::FitWidths: {
+                auto fit = NeoFitWidthsOptions{};
+                fit.rightBearing = value;
+                fitWidths(*target, fit);
+                break;
+            }
+            default:
+                return x.fail(DaemonStatus::BadRequest, "unknown transform");
+            }
+        }
+        result = target;
+        m_cache.insert(key, result);
+    }
+
+    daemonPut(x.out, key, 8);
+    daemonPut(x.out, result->height(), 1);
+    return true;
+}
+
+bool Server::render(Exchange &x) {
+    auto f = font(x);
+    if (!f) {
+        return false;
+    }
+    if (x.payload.size() < 10) {
+        return x.fail(DaemonStatus::BadRequest, "missing width");
+    }
+    int maxWidth = static_cast<int>(daemonGet(&x.payload[8], 2));
+    auto codes = x.payload.subspan(10);
+
+    // Break in to lines first, to size the bitmap.
+    auto breaks = std::vector<size_t>{};
+    int width = 0;
+    int lineWidth = 0;
+    for (size_t i = 0; i < codes.size(); ++i) {
+        int w = codes[i] == 10 ? 0 : f->character(codes[i]).width();
+        bool full = maxWidth && lineWidth && lineWidth + w > maxWidth;
+        if (codes[i] == 10 || full) {
+            breaks.push_back(i);
+            lineWidth = 0;
+        }
+        lineWidth += w;
+        width = std::max(width, lineWidth);
+    }
+    breaks.push_back(codes.size());
+    int height = static_cast<int>(breaks.size()) * f->height();
+    if (width > 0xffff || height > 0xffff) {
+        return x.fail(DaemonStatus::BadRequest, "text too large");
+    }
+    // Clients refuse responses over the payload limit and drop the
+    // connection, so refuse the request instead.
+    auto bytes = static_cast<size_t>((width + 7) / 8) * height + 4;
+    if (bytes > daemonMaxPayload) {
+        return x.fail(DaemonStatus::BadRequest, "image too large");
+    }
+
+    auto bitmap = NeoBitmap{width, height};
+    size_t i = 0;
+    for (size_t line = 0; line < breaks.size(); ++line) {
+        int px = 0;
+        if (i < codes.size() && codes[i] == 10) {
+            ++i;
+        }
+        for (; i < breaks[line]; ++i) {
+            auto &c = f->character(codes[i]);
+            bitmap.drawCharacter(c, px, static_cast<int>(line) * f->height());
+            px += c.width();
+        }
+    }
+
+    daemonPut(x.out, width, 2);
+    daemonPut(x.out, height, 2);
+    for (int y = 0; y < height; ++y) {
+        auto row = bitmap.row(y);
+        x.out.insert(x.out.end(), row, row + bitmap.stride());
+    }
+    return true;
+}
+
+bool Server::stats(Exchange &x) {
+    char *text = nullptr;
+    size_t size = 0;
+    auto out = open_memstream(&text, &size);
+    if (!out) {
+        return x.fail(DaemonStatus::Failed, "out of memory");
+    }
+    fprintf(out,
+            "%-10s %10s %10s %10s %10s %10s\n",
+            "request",
+            "count",
+            "mean_us",
+            "p50_us",
+            "p99_us",
+            "max_us");
+    for (size_t op = 1; op < daemonOpCount; ++op) {
+        auto &l = latencies[op];
+        uint64_t count = l.count;
+        fprintf(out,
+                "%-10s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+                daemonOpName(static_cast<DaemonOp>(op)),
+                static_cast<unsigned long long>(count),
+                count ? l.totalNs / 1000. / count : 0.,
+                l.percentileUs(0.5),
+                l.percentileUs(0.99),
+                l.maxNs / 1000.);
+    }
+    auto cache = m_cache.stats();
+    fprintf(out,
+            "cache: %zu of %zu fonts, %llu hits, %llu misses, %llu "
+            "evictions\n",
+            cache.fonts,
+            cache.capacity,
+            static_cast<unsigned long long>(cache.hits),
+            static_cast<unsigned long long>(cache.misses),
+            static_cast<unsigned long long>(cache.evictions));
+    neoMemoryUsage().print(out);
+    fclose(out);
+    x.out.insert(x.out.end(), text, text + size);
+    free(text);
+    return true;
+}
+
+bool Server::handle(Exchange &x) {
+    switch (x.request.op) {
+    case DaemonOp::Decode:
+        return decode(x);
+    case DaemonOp::Encode:
+        return encode(x);
+    case DaemonOp::Transform:
+        return transform(x);
+    case DaemonOp::Render:
+        return render(x);
+    case DaemonOp::Stats:
+        return stats(x);
+    }
+    return x.fail(DaemonStatus::BadRequest, "unknown request");
+}
+
+bool writeAll(int fd, const std::vector<uint8_t> &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        auto n = ::send(
+            fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/** Answer requests on one connection until it is closed. Every complete
+ * request that has arrived is handled before the responses are written
+ * together, which batches both the reads and the writes.
+ */
+void Server::serve(int fd) {
+    auto in = std::vector<uint8_t>{};
+    auto out = std::vector<uint8_t>{};
+    size_t used = 0;
+    for (;;) {
+        if (in.size() - used < 64 * 1024) {
+            in.resize(used + 64 * 1024);
+        }
+        auto n = ::read(fd, in.data() + used, in.size() - used);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        used += static_cast<size_t>(n);
+
+        size_t offset = 0;
+        bool bad = false;
+        while (used - offset >= DaemonRequestHeader::size) {
+            auto x = Exchange{{}, {}, DaemonStatus::Ok, out};
+            if (!daemonGetHeader(in.data() + offset, x.request) ||
+                x.request.payload > daemonMaxPayload) {
+                bad = true;
+                break;
+            }
+            auto size = DaemonRequestHeader::size + x.request.payload;
+            if (used - offset < size) {
+                // Wait for the rest, with room for all of it.
+                in.resize(std::max(in.size(), offset + size));
+                break;
+            }
+            x.payload = {in.data() + offset + DaemonRequestHeader::size,
+                         x.request.payload};
+
+            auto start = Clock::now();
+            auto headerAt = out.size();
+            out.resize(headerAt + DaemonResponseHeader::size);
+            handle(x);
+            auto ns = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - start)
+                    .count());
+            auto op = static_cast<size_t>(x.request.op);
+            latencies[op < daemonOpCount ? op : 0].add(ns);
+
+            auto header = DaemonResponseHeader{};
+            header.op = x.request.op;
+            header.status = x.status;
+            header.id = x.request.id;
+            header.payload = static_cast<uint32_t>(
+                out.size() - headerAt - DaemonResponseHeader::size);
+            header.serverNs = ns;
+            auto bytes = std::vector<uint8_t>{};
+            daemonPutHeader(bytes, header);
+            std::copy(bytes.begin(), bytes.end(), out.begin() + headerAt);
+            offset += size;
+        }
+
+        if (!out.empty() && !writeAll(fd, out)) {
+            break;
+        }
+        out.clear();
+        if (bad) {
+            break;
+        }
+        // Keep the start of a partial request.
+        std::copy(in.begin() + offset, in.begin() + used, in.begin());
+        used -= offset;
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+    if (!parseArgs(argc, argv, options)) {
+        return 2;
+    }
+    setNeoMemoryCap(options.memoryCap);
+
+    auto address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (options.socket.size() >= sizeof address.sun_path) {
+        fprintf(stderr, "socket path too long\n");
+        return 2;
+    }
+    memcpy(address.sun_path, options.socket.c_str(), options.socket.size() + 1);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ::unlink(options.socket.c_str());
+    if (listener < 0 ||
+        ::bind(listener,
+               reinterpret_cast<const sockaddr *>(&address),
+               sizeof address) != 0 ||
+        ::listen(listener, 128) != 0) {
+        fprintf(stderr,
+                "could not listen on %s: %s\n",
+                options.socket.c_str(),
+                strerror(errno));
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "listening on %s\n", options.socket.c_str());
+
+    auto server = Server{options};
+    for (;;) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            fprintf(stderr, "accept failed: %s\n", strerror(errno));
+            return 1;
+        }
+        std::thread{[&server, fd] { server.serve(fd); }}.detach();
+    }
+}
@@ -0,0 +1,278 @@
+/** @file       main.cpp
+ *  @brief      neo_font_loadgen: load generator for neo_font_daemon.
+ *
+ *  Each client thread uploads the fonts once, then sends batches of encode,
+ *  transform and render requests for random fonts and measures the time
+ *  until each batch is answered.
+ */
+
+#include "Client.h"
+#include "neofontlib/NeoAppletBuffer.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string socket = "/tmp/neo_font_daemon.sock";
+    std::vector<std::string> fonts;
+    int clients = 4;
+    int batches = 1000;
+    int batchSize = 8;
+};
+
+void printUsage(FILE *out) {
+    fputs("usage: neo_font_loadgen [options] <font>...\n"
+          "\n"
+          "  --socket <path>      daemon socket (default:\n"
+          "                       /tmp/neo_font_daemon.sock)\n"
+          "  -c, --clients <n>    concurrent connections (default: 4)\n"
+          "  -n, --batches <n>    batches per connection (default: 1000)\n"
+          "  -b, --batch <n>      requests per batch (default: 8)\n",
+          out);
+}
+
+bool parseArgs(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        auto arg = std::string{argv[i]};
+        if (arg == "-h" || arg == "--help") {
+            printUsage(stdout);
+            exit(0);
+        }
+        else if (arg.front() != '-') {
+            options.fonts.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return false;
+        }
+        auto v = argv[++i];
+        if (arg == "--socket") {
+            options.socket = v;
+        }
+        else if (arg == "-c" || arg == "--clients") {
+            options.clients = std::max(1, atoi(v));
+        }
+        else if (arg == "-n" || arg == "--batches") {
+            options.batches = std::max(1, atoi(v));
+        }
+        else if (arg == "-b" || arg == "--batch") {
+            options.batchSize = std::max(1, atoi(v));
+        }
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (options.fonts.empty()) {
+        printUsage(stderr);
+        return false;
+    }
+    return true;
+}
+
+struct Source {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+/** Samples from all clients, in microseconds.
+ */
+struct Results {
+    std::mutex mutex;
+    std::vector<double> batchUs;  /**< Round trip of each batch. */
+    std::vector<double> serverUs; /**< Daemon time of each request. */
+    uint64_t failed = 0;
+    uint64_t resent = 0; /**< Fonts uploaded again after eviction. */
+};
+
+/** Upload the fonts, then run batches. @return false if the connection
+ * failed.
+ */
+bool runClient(const Options &options,
+               const std::vector<Source> &sources,
+               unsigned seed,
+               Results &results) {
+    auto client = DaemonClient{};
+    if (!client.connect(options.socket)) {
+        fprintf(stderr, "could not connect to %s\n", options.socket.c_str());
+        return false;
+    }
+
+    // Decoding is answered from the cache when another client was first.
+    auto keys = std::vector<uint64_t>(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        client.decode(sources[i].name.c_str(), sources[i].data, &keys[i]);
+    }
+    auto responses = std::vector<DaemonResponse>{};
+    if (!client.wait(responses)) {
+        return false;
+    }
+
+    auto rng = std::mt19937{seed};
+    const auto bold = std::array<DaemonTransform, 1>{
+        DaemonTransform{DaemonTransformOp::Bold, 0, 0}};
+    const uint8_t text[] = "The quick brown fox jumps over the lazy dog";
+    auto batchUs = std::vector<double>{};
+    auto serverUs = std::vector<double>{};
+    uint64_t failed = 0;
+    uint64_t resent = 0;
+    auto used = std::vector<size_t>{};
+    auto evicted = std::vector<size_t>{};
+    for (int b = 0; b < options.batches; ++b) {
+        // Fonts the daemon no longer had go first, as a build would do.
+        for (auto i : evicted) {
+            client.decode(sources[i].name.c_str(), sources[i].data);
+            used.push_back(i);
+        }
+        resent += evicted.size();
+        evicted.clear();
+        for (int r = 0; r < options.batchSize; ++r) {
+            auto i = rng() % keys.size();
+            auto key = keys[i];
+            used.push_back(i);
+            switch (rng() % 3) {
+            case 0:
+                client.encode(key);
+                break;
+            case 1:
+                client.transform(key, bold);
+                break;
+            default:
+                client.render(key, {text, sizeof text - 1}, 120);
+                break;
+            }
+        }
+        auto start = Clock::now();
+        if (!client.wait(responses)) {
+            return false;
+        }
+        batchUs.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count());
+        for (size_t r = 0; r < responses.size(); ++r) {
+            auto status = responses[r].header.status;
+            serverUs.push_back(responses[r].header.serverNs / 1000.);
+            if (status == DaemonStatus::NotFound) {
+                if (std::find(evicted.begin(), evicted.end(), used[r]) ==
+                    evicted.end()) {
+                    evicted.push_back(used[r]);
+                }
+            }
+            else if (status != DaemonStatus::Ok) {
+                ++failed;
+            }
+        }
+        used.clear();
+    }
+
+    auto lock = std::lock_guard{results.mutex};
+    results.batchUs.insert(
+        results.batchUs.end(), batchUs.begin(), batchUs.end());
+    results.serverUs.insert(
+        results.serverUs.end(), serverUs.begin(), serverUs.end());
+    results.failed += failed;
+    results.resent += resent;
+    return true;
+}
+
+void printLatency(const char *name, std::vector<double> &us) {
+    if (us.empty()) {
+        return;
+    }
+    std::sort(us.begin(), us.end());
+    auto at = [&](double fraction) {
+        return us[std::min(us.size() - 1,
+                           static_cast<size_t>(us.size() * fraction))];
+    };
+    fprintf(stderr,
+            "%-8s %10zu %10.1f %10.1f %10.1f %10.1f\n",
+            name,
+            us.size(),
+            at(0.5),
+            at(0.9),
+            at(0.99),
+            us.back());
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    auto options = Options{};
+    if (!parseArgs(argc, argv, options)) {
+        return 2;
+    }
+
+    auto sources = std::vector<Source>{};
+    auto buffer = NeoAppletBuffer{};
+    for (auto &path : options.fonts) {
+        if (!buffer.load(path.c_str())) {
+            fprintf(stderr, "could not read %s\n", path.c_str());
+            return 1;
+        }
+        auto bytes = buffer.bytes();
+        sources.push_back({path, {bytes.begin(), bytes.end()}});
+    }
+
+    auto results = Results{};
+    auto threads = std::vector<std::thread>{};
+    auto ok = std::vector<char>(options.clients);
+    auto start = Clock::now();
+    for (int i = 0; i < options.clients; ++i) {
+        threads.emplace_back([&, i] {
+            ok[i] = runClient(options, sources, i + 1, results);
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    auto wall = std::chrono::duration<double>(Clock::now() - start).count();
+    if (std::count(ok.begin(), ok.end(), 0)) {
+        fprintf(stderr, "some connections failed\n");
+        return 1;
+    }
+
+    auto requests = results.serverUs.size();
+    fprintf(stderr,
+            "%zu requests in %.2f s (%.0f requests/s), %llu failed, %llu "
+            "fonts sent again after eviction\n",
+            requests,
+            wall,
+            wall > 0 ? requests / wall : 0.,
+            static_cast<unsigned long long>(results.failed),
+            static_cast<unsigned long long>(results.resent));
+    fprintf(stderr,
+            "%-8s %10s %10s %10s %10s %10s\n",
+            "us",
+            "samples",
+            "p50",
+            "p90",
+            "p99",
+            "max");
+    printLatency("batch", results.batchUs);
+    printLatency("server", results.serverUs);
+
+    // The daemon's own view, including its cache and memory use.
+    auto client = DaemonClient{};
+    auto responses = std::vector<DaemonResponse>{};
+    if (client.connect(options.socket)) {
+        client.stats();
+        if (client.wait(responses) && responses.front().ok()) {
+            auto &text = responses.front().payload;
+            fwrite(text.data(), 1, text.size(), stderr);
+        }
+    }
+    return results.failed ? 1 : 0;
+}
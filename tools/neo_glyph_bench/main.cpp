@@ -0,0 +1,161 @@
+/** @file       main.cpp
+ *  @brief      neo_glyph_bench: glyph codec against the raw archive format.
+ *
+ *  For every font given, the characters are stored both with
+ *  NeoCharacter::saveArchive() and with encodeGlyph(), then loaded back
+ *  repeatedly. Sizes and throughput are printed per font and in total.
+ *  Throughput is counted in raw archive bytes, so the two columns compare
+ *  the time to produce the same characters.
+ */
+
+#include "neofontlib/NeoAppletBuffer.h"
+#include "neofontlib/NeoFont.h"
+#include "neofontlib/NeoGlyphCodec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    size_t rawBytes = 0;
+    size_t codecBytes = 0;
+    double rawLoadNs = 0;
+    double codecEncodeNs = 0;
+    double codecDecodeNs = 0;
+};
+
+template <typename Function>
+double timeNs(int repeat, Function fn) {
+    auto start = Clock::now();
+    for (int i = 0; i < repeat; ++i) {
+        fn();
+    }
+    auto ns = std::chrono::duration<double, std::nano>(Clock::now() - start);
+    return ns.count() / repeat;
+}
+
+bool run(const NeoFont &font, int repeat, Result &result) {
+    auto &first = *font.begin();
+    auto archiveSize = first.archiveSize();
+    auto raw = std::vector<uint8_t>(archiveSize * NeoFont::charCount);
+    for (size_t i = 0; i < NeoFont::charCount; ++i) {
+        font.character(i).saveArchive(raw.data() + i * archiveSize);
+    }
+
+    auto packed = std::vector<uint8_t>{};
+    result.codecEncodeNs += timeNs(repeat, [&] {
+        packed.clear();
+        encodeFontGlyphs(font, packed);
+    });
+
+    auto decoded = std::make_unique<NeoFont>();
+    result.rawLoadNs += timeNs(repeat, [&] {
+        for (size_t i = 0; i < NeoFont::charCount; ++i) {
+            decoded->character(i).loadArchive(raw.data() + i * archiveSize);
+        }
+    });
+    result.codecDecodeNs +=
+        timeNs(repeat, [&] { decodeFontGlyphs(packed, *decoded); });
+
+    // Every pixel inside each character must survive the round trip.
+    for (size_t i = 0; i < NeoFont::charCount; ++i) {
+        auto &a = font.character(i);
+        auto &b = decoded->character(i);
+        if (a.width() != b.width()) {
+            return false;
+        }
+        for (int y = 0; y < font.height(); ++y) {
+            for (int x = 0; x < a.width(); ++x) {
+                if (a.getPixel(x, y) != b.getPixel(x, y)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    result.rawBytes += raw.size();
+    result.codecBytes += packed.size();
+    return true;
+}
+
+double gbPerSecond(size_t bytes, double ns) {
+    return ns > 0 ? bytes / ns : 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int repeat = 200;
+    auto paths = std::vector<std::string>{};
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            repeat = std::max(1, atoi(argv[++i]));
+        }
+        else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        fputs("usage: neo_glyph_bench [-n repeat] <applet>...\n", stderr);
+        return 2;
+    }
+
+    printf("%-32s %10s %10s %7s %10s %10s %10s\n",
+           "font",
+           "raw",
+           "codec",
+           "ratio",
+           "raw GB/s",
+           "dec GB/s",
+           "enc GB/s");
+
+    auto total = Result{};
+    auto buffer = NeoAppletBuffer{};
+    auto font = std::make_unique<NeoFont>();
+    int failed = 0;
+    for (auto &path : paths) {
+        if (!buffer.load(path.c_str()) || !buffer.decode(*font)) {
+            fprintf(stderr, "%s: not a valid font applet\n", path.c_str());
+            ++failed;
+            continue;
+        }
+        auto result = Result{};
+        if (!run(*font, repeat, result)) {
+            fprintf(stderr, "%s: round trip failed\n", path.c_str());
+            ++failed;
+            continue;
+        }
+        printf("%-32s %10zu %10zu %6.1fx %10.2f %10.2f %10.2f\n",
+               path.c_str(),
+               result.rawBytes,
+               result.codecBytes,
+               double(result.rawBytes) / result.codecBytes,
+               gbPerSecond(result.rawBytes, result.rawLoadNs),
+               gbPerSecond(result.rawBytes, result.codecDecodeNs),
+               gbPerSecond(result.rawBytes, result.codecEncodeNs));
+        total.rawBytes += result.rawBytes;
+        total.codecBytes += result.codecBytes;
+        total.rawLoadNs += result.rawLoadNs;
+        total.codecDecodeNs += result.codecDecodeNs;
+        total.codecEncodeNs += result.codecEncodeNs;
+    }
+
+    if (total.codecBytes) {
+        printf("%-32s %10zu %10zu %6.1fx %10.2f %10.2f %10.2f\n",
+               "total",
+               total.rawBytes,
+               total.codecBytes,
+               double(total.rawBytes) / total.codecBytes,
+               gbPerSecond(total.rawBytes, total.rawLoadNs),
+               gbPerSecond(total.rawBytes, total.codecDecodeNs),
+               gbPerSecond(total.rawBytes, total.codecEncodeNs));
+    }
+    return failed ? 1 : 0;
+}